@@ -34,7 +34,7 @@
 #define NITER_LONG   25
 #define NITER_SHORT  200
 #define NITER_THRESH 131072
-int elements=100;
+long elements=100;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
@@ -48,7 +48,7 @@ static void init_sendbuf (double *sendbuf, int count, int mynode)
 static void init_recvbuf (double *recvbuf, int count)
 {
     for (int i = 0; i < count; i++) {
-        recvbuf[i] = 0.0;
+        recvbuf[i] = -1.0;
     }
 }
 
@@ -81,6 +81,8 @@ int main (int argc, char *argv[])
     int root = 0;
     std::chrono::high_resolution_clock::time_point t1s, t1e;
     double t1;
+    double t2;
+    bool res, fret=true;
     double *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
 
     bind_device();
@@ -91,12 +93,12 @@ int main (int argc, char *argv[])
 
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    int max_elements = elements;
+    long max_elements = elements;
 
     if (rank == 0 ) {
         printf("Benchmark: %s %c %c - %d processes\n\n", argv[0],  sendbuf->get_memchar(), recvbuf->get_memchar(), size);
-        printf("No. of elems \t msg. length \t time\n");
-        printf("================================================================\n");
+        printf("No. of elems \t msg. length \t time \t\t check time \t result\n");
+        printf("================================================================================\n");
     }
 
     for (elements=1; elements<=max_elements; elements *=2 ) {
@@ -123,31 +125,36 @@ int main (int argc, char *argv[])
         // execute the allreduce test
         MPI_Barrier(MPI_COMM_WORLD);
         t1s = std::chrono::high_resolution_clock::now();
+        hip_mpitest_pagefaults_begin();
         ret = allreduce_test (sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
                               MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, niter);
         if (MPI_SUCCESS != ret) {
             fprintf(stderr, "Error in allreduce_test. Aborting\n");
             goto out;
         }
+        hip_mpitest_pagefaults_end();
         t1e = std::chrono::high_resolution_clock::now();
         t1 = std::chrono::duration<double>(t1e-t1s).count();
 
-#if 0
-        // verify results
-        bool res, fret;
-        res = true;
-        if (recvbuf->NeedsStagingBuffer()) {
-            HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*sizeof(double)));
-            res = check_recvbuf(tmp_recvbuf, size, rank, elements);
-        }
-        else {
-            res = check_recvbuf((double*) recvbuf->get_buffer(), size, rank, elements);
+        // verify results outside of the timed loop
+        ret = bench_verify (MPI_COMM_WORLD,
+                            [&]() { return bench_reset_recvbuf(recvbuf, tmp_recvbuf, elements,
+                                                               init_recvbuf); },
+                            [&]() { return allreduce_test (sendbuf->get_buffer(),
+                                                           recvbuf->get_buffer(), elements,
+                                                           MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD,
+                                                           1); },
+                            [&]() {
+                                double *b = bench_host_data(recvbuf, tmp_recvbuf, elements);
+                                return NULL != b && check_recvbuf(b, size, rank, elements); },
+                            &res, &t2);
+        if (MPI_SUCCESS != ret) {
+            fprintf(stderr, "Error in allreduce_test. Aborting\n");
+            goto out;
         }
 
-        fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
-#endif
-        bench_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
-                           elements, (size_t)(elements * sizeof(double)), niter, t1);
+        fret &= bench_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
+                                   elements, (size_t)(elements * sizeof(double)), niter, t1, t2, res);
 
         //Free buffers
         FREE_BUFFER(sendbuf, tmp_sendbuf);
@@ -162,7 +169,10 @@ int main (int argc, char *argv[])
     delete (recvbuf);
 
     MPI_Finalize ();
-    return ret;
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    return fret ? 0 : 1;
 }
 
 
@@ -30,38 +30,39 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 #include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
 
 #define NITER_LONG   50
 #define NITER_SHORT  500
 #define NITER_THRESH 131072
-int elements=100;
+long elements=100;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (double *sendbuf, int count, int mynode)
+static void init_sendbuf (double *sendbuf, long first, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = (double)mynode+1;
     }
 }
 
-static void init_recvbuf (double *recvbuf, int count)
+static void init_recvbuf (double *recvbuf, long first, long count)
 {
-    for (int i = 0; i < count; i++) {
-        recvbuf[i] = 0.0;
+    for (long i = 0; i < count; i++) {
+        recvbuf[i] = -1.0;
     }
 }
 
-static bool check_recvbuf(double *recvbuf, int nprocs, int root, int count)
+static bool check_recvbuf(const double *recvbuf, long first, long count, int root)
 {
     bool res=true;
     double result = (double) root+1;
 
-    for (int i=0; i<count; i++) {
+    for (long i=0; i<count; i++) {
         if (recvbuf[i] != result) {
             res = false;
 #ifdef VERBOSE
-            printf("recvbuf[%d] = %d\n", i, recvbuf[i]);
+            printf("recvbuf[%ld] = %lf\n", first+i, recvbuf[i]);
 #endif
         }
     }
@@ -70,17 +71,19 @@ static bool check_recvbuf(double *recvbuf, int nprocs, int root, int count)
 }
 
 #define ROOT 0
-int bcast_test (void *sendbuf, int count, MPI_Datatype datatype, MPI_Comm comm,
+int bcast_test (void *sendbuf, long count, MPI_Datatype datatype, MPI_Comm comm,
                 int niterations);
 
 int main (int argc, char *argv[])
 {
-    int ret;
+    int ret = MPI_SUCCESS;
     int rank, size;
     int root = 0;
     std::chrono::high_resolution_clock::time_point t1s, t1e;
     double t1;
-    double *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
+    double t2;
+    bool res, fret=true;
+    hip_mpitest_typed_buffer<double> buf;
 
     bind_device();
 
@@ -88,27 +91,31 @@ int main (int argc, char *argv[])
     MPI_Comm_size (MPI_COMM_WORLD, &size);
     MPI_Comm_rank (MPI_COMM_WORLD, &rank);
 
+    hip_mpitest_max_elements = LONG_MAX;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    int max_elements = elements;
+    long max_elements = elements;
 
     if (rank == 0 ) {
         printf("Benchmark: %s %c %c - %d processes\n\n", argv[0],  sendbuf->get_memchar(), recvbuf->get_memchar(), size);
-        printf("No. of elems \t msg. length \t time\n");
-        printf("================================================================\n");
+        printf("No. of elems \t msg. length \t time \t\t check time \t result\n");
+        printf("================================================================================\n");
     }
 
     for (elements=1; elements<=max_elements; elements *=2 ) {
         int niter = elements >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
-        tmp_sendbuf = NULL;
-        tmp_recvbuf = NULL;
 
         // Initialise send buffer
-        ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, double, elements, sizeof(double),
-                            rank, MPI_COMM_WORLD, init_sendbuf, out);
+        if (buf.Allocate(sendbuf, elements) != hipSuccess ||
+            buf.Generate([rank](double *b, long first, long n) {
+                             init_sendbuf(b, first, n, rank); }) != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        buf.Report(MPI_COMM_WORLD, "Sendbuf");
 
         //Warmup
-        ret = bcast_test (sendbuf->get_buffer(), elements, MPI_DOUBLE, MPI_COMM_WORLD, 1);
+        ret = bcast_test (buf.get_buffer(), elements, MPI_DOUBLE, MPI_COMM_WORLD, 1);
         if (MPI_SUCCESS != ret) {
             fprintf(stderr, "Error in bcast_test. Aborting\n");
             goto out;
@@ -117,52 +124,57 @@ int main (int argc, char *argv[])
         // execute the allreduce test
         MPI_Barrier(MPI_COMM_WORLD);
         t1s = std::chrono::high_resolution_clock::now();
-        ret = bcast_test (sendbuf->get_buffer(), elements, MPI_DOUBLE, MPI_COMM_WORLD, niter);
+        hip_mpitest_pagefaults_begin();
+        ret = bcast_test (buf.get_buffer(), elements, MPI_DOUBLE, MPI_COMM_WORLD, niter);
         if (MPI_SUCCESS != ret) {
             fprintf(stderr, "Error in bcast_test. Aborting\n");
             return ret;
         }
+        hip_mpitest_pagefaults_end();
         t1e = std::chrono::high_resolution_clock::now();
         t1 = std::chrono::duration<double>(t1e-t1s).count();
 
-#if 0
-        // verify results
-        bool res, fret;
-        res = true;
-        if (sendbuf->NeedsStagingBuffer()) {
-            HIP_CHECK(sendbuf->CopyFrom(tmp_sendbuf, elements*sizeof(double)));
-            res = check_recvbuf(tmp_sendbuf, size, ROOT, elements);
-        }
-        else {
-            res = check_recvbuf((double*) sendbuf->get_buffer(), size, ROOT, elements);
+        // verify results outside of the timed loop, the buffer of the root
+        // holds the data to broadcast and is not reset
+        ret = bench_verify (MPI_COMM_WORLD,
+                            [&]() { return rank == ROOT ||
+                                           buf.Generate(init_recvbuf) == hipSuccess; },
+                            [&]() { return bcast_test (buf.get_buffer(), elements, MPI_DOUBLE,
+                                                       MPI_COMM_WORLD, 1); },
+                            [&]() { return buf.Verify([](const double *b, long first, long n) {
+                                                          return check_recvbuf(b, first, n,
+                                                                               ROOT); }); },
+                            &res, &t2);
+        if (MPI_SUCCESS != ret) {
+            fprintf(stderr, "Error in bcast_test. Aborting\n");
+            goto out;
         }
 
-        fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
-#endif
-        bench_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
-                           elements, (size_t)(elements * sizeof(double)), niter, t1);
+        fret &= bench_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
+                                   elements, (size_t)(elements * sizeof(double)), niter, t1, t2, res);
 
         //Free buffers
-        FREE_BUFFER(sendbuf, tmp_sendbuf);
+        HIP_CHECK(buf.Free());
     }
  out:
-    if (ret != MPI_SUCCESS) {
-        FREE_BUFFER(sendbuf, tmp_sendbuf);
-    }
+    HIP_CHECK(buf.Free());
     delete (sendbuf);
 
     MPI_Finalize ();
-    return ret;
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    return fret ? 0 : 1;
 }
 
 
-int bcast_test ( void *sendbuf, int count, MPI_Datatype datatype, MPI_Comm comm,
+int bcast_test ( void *sendbuf, long count, MPI_Datatype datatype, MPI_Comm comm,
                  int niterations)
 {
     int ret;
 
     for (int i=0; i<niterations; i++) {
-        ret = MPI_Bcast (sendbuf, count, datatype, ROOT, comm);
+        ret = hip_mpitest_bcast (sendbuf, count, datatype, ROOT, comm);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
@@ -0,0 +1,374 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Cost of buffered sends. Process 0 sends a window of messages to
+** process 1, which acknowledges the window once all messages arrived,
+** with
+**   bsend: MPI_Bsend through an attached buffer of 25%, 50%, 100% and 200%
+**          of the space required for all messages of the window
+**   isend: MPI_Isend followed by MPI_Waitall
+**   ssend: MPI_Ssend
+** for message sizes of 1 byte up to -n bytes and windows of 1 up to
+** --bsend-window messages, both growing by a factor of 4. The time spent
+** in the send calls shows the cost of copying the data into the attached
+** buffer compared to MPI_Isend. Every message takes its packed size plus
+** MPI_BSEND_OVERHEAD bytes of the attached buffer. If the next message of
+** a window does not fit, the buffer runs out of space and is drained by
+** detaching it, which waits for the buffered messages to be transmitted,
+** before it is attached again. The acknowledgement of a window empties
+** the buffer for the next one. Messages larger than the whole buffer are
+** sent with MPI_Send, and reported as "send (no fit)" without a copy
+** overhead. Without the MPI-4 large-count interface, rows whose attached
+** buffer exceeds INT_MAX bytes are skipped.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
+
+#define NITER_LONG   10
+#define NITER_SHORT  100
+#define NITER_THRESH 131072
+long elements=4194304;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+enum HIP_MPITEST_SENDMODE {
+      HIP_MPITEST_SENDMODE_BSEND=0,
+      HIP_MPITEST_SENDMODE_ISEND,
+      HIP_MPITEST_SENDMODE_SSEND,
+      HIP_MPITEST_SENDMODE_LAST
+};
+
+const char *const hip_mpitest_sendmode_names[HIP_MPITEST_SENDMODE_LAST] = {
+    "bsend", "isend", "ssend"};
+
+// Size of the attached buffer in percent of the space required for a window
+#define NUM_ATTACH 4
+static const int attach_percent[NUM_ATTACH] = {25, 50, 100, 200};
+
+// Buffer attached by process 0 for the buffered sends
+struct bsend_attach {
+    char *buf;
+    long  size;
+    long  msgsize;    // space taken by a message
+    long  used;       // space taken since the buffer was attached or drained
+};
+
+// Sends niter windows of window messages of len bytes from process 0 to
+// process 1 in the given mode. Returns on process 0 the time spent in the
+// send calls, the total time and the number of times the attached buffer
+// ran out of space.
+static int window_test (int mode, char *sbuf, char *rbuf, long len, int window, int niter,
+                        bsend_attach *att, MPI_Request *reqs, MPI_Comm comm, double *tcall,
+                        double *ttotal, long *nfull)
+{
+    std::chrono::high_resolution_clock::time_point ts, te, tcs, tce;
+    int rank, ret=MPI_SUCCESS;
+    int tag=271, acktag=272;
+
+    MPI_Comm_rank (comm, &rank);
+    *tcall  = 0.0;
+    *nfull  = 0;
+    ret = MPI_Barrier (comm);
+    ts = std::chrono::high_resolution_clock::now();
+    for (int iter=0; iter<niter && MPI_SUCCESS == ret; iter++) {
+        if (rank == 1) {
+            for (int i=0; i<window && MPI_SUCCESS == ret; i++) {
+                ret = hip_mpitest_irecv (rbuf + i * len, len, MPI_CHAR, 0, tag, comm, &reqs[i]);
+            }
+            if (MPI_SUCCESS == ret) {
+                ret = MPI_Waitall (window, reqs, MPI_STATUSES_IGNORE);
+            }
+            if (MPI_SUCCESS == ret) {
+                ret = MPI_Send (NULL, 0, MPI_CHAR, 0, acktag, comm);
+            }
+            continue;
+        }
+
+        for (int i=0; i<window && MPI_SUCCESS == ret; i++) {
+            char *buf = sbuf + i * len;
+
+            tcs = std::chrono::high_resolution_clock::now();
+            switch (mode) {
+            case HIP_MPITEST_SENDMODE_BSEND :
+                if (att->msgsize > att->size) {
+                    ret = hip_mpitest_send (buf, len, MPI_CHAR, 1, tag, comm);
+                    break;
+                }
+                if (att->used + att->msgsize > att->size) {
+                    (*nfull)++;
+                    ret = hip_mpitest_buffer_detach ();
+                    if (MPI_SUCCESS == ret) {
+                        ret = hip_mpitest_buffer_attach (att->buf, att->size);
+                    }
+                    att->used = 0;
+                    if (MPI_SUCCESS != ret) {
+                        break;
+                    }
+                }
+                ret = hip_mpitest_bsend (buf, len, MPI_CHAR, 1, tag, comm);
+                att->used += att->msgsize;
+                break;
+            case HIP_MPITEST_SENDMODE_ISEND :
+                ret = hip_mpitest_isend (buf, len, MPI_CHAR, 1, tag, comm, &reqs[i]);
+                break;
+            case HIP_MPITEST_SENDMODE_SSEND :
+                ret = hip_mpitest_ssend (buf, len, MPI_CHAR, 1, tag, comm);
+                break;
+            }
+            tce = std::chrono::high_resolution_clock::now();
+            *tcall += std::chrono::duration<double>(tce-tcs).count();
+        }
+        if (MPI_SUCCESS == ret && HIP_MPITEST_SENDMODE_ISEND == mode) {
+            ret = MPI_Waitall (window, reqs, MPI_STATUSES_IGNORE);
+        }
+        if (MPI_SUCCESS == ret) {
+            ret = MPI_Recv (NULL, 0, MPI_CHAR, 1, acktag, comm, MPI_STATUS_IGNORE);
+        }
+        if (NULL != att) {
+            // the ack confirms that all messages of the window were delivered,
+            // hence the attached buffer is empty again
+            att->used = 0;
+        }
+    }
+    te = std::chrono::high_resolution_clock::now();
+    *ttotal = std::chrono::duration<double>(te-ts).count();
+    return ret;
+}
+
+// Runs the timed windows and a separate window into a reset receive
+// buffer for the verification, and prints a row of results on process 0.
+// Returns the time per send call in usec in call.
+static int bench_row (int mode, int attach, hip_mpitest_typed_buffer<char> &sbuf,
+                      hip_mpitest_typed_buffer<char> &rbuf, long len, int window,
+                      bsend_attach *att, MPI_Request *reqs, MPI_Comm comm, double isend_call,
+                      double *call, bool *fret)
+{
+    int rank, ret, pret, gret;
+    int niter = len >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+    double tcall, ttotal, tc, tt;
+    long nfull, nf;
+    bool res;
+
+    MPI_Comm_rank (comm, &rank);
+    ret = window_test (mode, sbuf.get_buffer(), rbuf.get_buffer(), len, window, niter, att,
+                       reqs, comm, &tcall, &ttotal, &nfull);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    if (rbuf.Generate(bench_init_recvbuf) != hipSuccess) {
+        return MPI_ERR_OTHER;
+    }
+    ret = window_test (mode, sbuf.get_buffer(), rbuf.get_buffer(), len, window, 1, att,
+                       reqs, comm, &tc, &tt, &nf);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    // the receive buffer is a single slice holding a window of messages of process 0
+    long slice = rbuf.get_count();
+    int sender = 0;
+    res = rank != 1 || rbuf.Verify([slice, len, window, &sender](const char *b, long first,
+                                                                  long n) {
+                                       return bench_check_recvbuf(b, first, n, slice,
+                                                                  len * window, &sender); });
+    pret = res ? 1 : 0;
+    MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, comm);
+
+    *call = tcall / ((double)niter * window) * 1e6;
+    if (rank == 0) {
+        double nmsgs = (double)niter * window;
+        // a message larger than the attached buffer is sent with MPI_Send
+        bool nofit = HIP_MPITEST_SENDMODE_BSEND == mode && att->msgsize > att->size;
+        printf("%10ld \t %6d \t %-6s \t ", len, window,
+               nofit ? "send (no fit)" : hip_mpitest_sendmode_names[mode]);
+        if (HIP_MPITEST_SENDMODE_BSEND == mode) {
+            printf("%4d%% \t ", attach_percent[attach]);
+        }
+        else {
+            printf("%5s \t ", "-");
+        }
+        printf("%lf \t %lf \t ", *call, nmsgs * len / ttotal / (1024 * 1024));
+        if (HIP_MPITEST_SENDMODE_BSEND == mode && !nofit) {
+            printf("%lf \t %7ld \t ", *call - isend_call, nfull);
+        }
+        else {
+            printf("%8s \t %7s \t ", "-", "-");
+        }
+        printf("%s\n", gret != 0 ? "SUCCESS" : "FAILED");
+    }
+    *fret &= (gret != 0);
+    return MPI_SUCCESS;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size;
+    bool fret=true;
+    int maxwindow;
+    hip_mpitest_typed_buffer<char> sbuf, rbuf;
+    MPI_Request *reqs=NULL;
+    MPI_Comm comm=MPI_COMM_WORLD;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+#ifdef HIP_MPITEST_HAVE_MPI_COUNT
+    hip_mpitest_max_elements = LONG_MAX;
+#else
+    hip_mpitest_max_elements = INT_MAX - MPI_BSEND_OVERHEAD;
+#endif
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    if (size != 2) {
+        printf("This benchmark requires exactly two processes!\n");
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    maxwindow = hip_mpitest_bsend_window;
+
+    reqs = (MPI_Request *) malloc (maxwindow * sizeof(MPI_Request));
+    if (NULL == reqs) {
+        fprintf(stderr, "Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    // every message of a window uses its own part of the buffers
+    if (sbuf.Allocate(sendbuf, maxwindow * elements) != hipSuccess ||
+        sbuf.Generate([rank, maxwindow](char *b, long first, long n) {
+                          bench_init_sendbuf(b, first, n, maxwindow * elements,
+                                             rank); }) != hipSuccess ||
+        rbuf.Allocate(recvbuf, maxwindow * elements) != hipSuccess) {
+        fprintf(stderr, "Could not allocate buffers. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    sbuf.Report(MPI_COMM_WORLD, "Sendbuf");
+    rbuf.Report(MPI_COMM_WORLD, "Recvbuf");
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes, windows of up to %d messages\n\n", argv[0],
+               sendbuf->get_memchar(), recvbuf->get_memchar(), size, maxwindow);
+        printf("Time per send call and copy overhead (bsend - isend call) in usec, throughput in MB/s,\n"
+               "attach buffer in percent of the space required for a window, out of space being\n"
+               "the number of times the attached buffer had to be drained for the next message\n");
+        printf("msg. length \t window \t mode \t attach \t send call \t throughput \t copy overhead \t out of space \t result\n");
+        printf("=================================================================================================================================\n");
+    }
+
+    for (long len=1; len<=elements; len*=4) {
+        for (int window=1; window<=maxwindow; window*=4) {
+            double isend_call=0.0, call;
+            bsend_attach att;
+
+            // Reference modes, the time of the isend calls is the baseline
+            // of the copy overhead
+            for (int mode=HIP_MPITEST_SENDMODE_ISEND; mode<HIP_MPITEST_SENDMODE_LAST; mode++) {
+                ret = bench_row (mode, 0, sbuf, rbuf, len, window, NULL, reqs, comm, isend_call,
+                                 &call, &fret);
+                if (HIP_MPITEST_SENDMODE_ISEND == mode) {
+                    isend_call = call;
+                }
+                if (MPI_SUCCESS != ret) {
+                    fprintf(stderr, "Error in window_test. Aborting\n");
+                    goto out;
+                }
+            }
+
+            ret = hip_mpitest_bsend_size (len, MPI_CHAR, comm, &att.msgsize);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in hip_mpitest_bsend_size. Aborting\n");
+                goto out;
+            }
+            for (int attach=0; attach<NUM_ATTACH; attach++) {
+                att.size = att.msgsize * window * attach_percent[attach] / 100;
+#ifndef HIP_MPITEST_HAVE_MPI_COUNT
+                // MPI_Buffer_attach takes at most INT_MAX bytes without the
+                // large-count interface
+                if (att.size > INT_MAX) {
+                    if (rank == 0) {
+                        printf("%10ld \t %6d \t %-6s \t %4d%% \t skipped, attach buffer above "
+                               "INT_MAX bytes\n", len, window,
+                               hip_mpitest_sendmode_names[HIP_MPITEST_SENDMODE_BSEND],
+                               attach_percent[attach]);
+                    }
+                    continue;
+                }
+#endif
+                att.buf  = NULL;
+                att.used = 0;
+                if (rank == 0) {
+                    att.buf = (char *) malloc (att.size);
+                    if (NULL == att.buf) {
+                        fprintf(stderr, "Could not allocate memory. Aborting\n");
+                        ret = MPI_ERR_OTHER;
+                        goto out;
+                    }
+                    ret = hip_mpitest_buffer_attach (att.buf, att.size);
+                    if (MPI_SUCCESS != ret) {
+                        fprintf(stderr, "Error in MPI_Buffer_attach. Aborting\n");
+                        free (att.buf);
+                        goto out;
+                    }
+                }
+                ret = bench_row (HIP_MPITEST_SENDMODE_BSEND, attach, sbuf, rbuf, len, window,
+                                 &att, reqs, comm, isend_call, &call, &fret);
+                if (rank == 0) {
+                    // waits for the buffered messages to be transmitted
+                    hip_mpitest_buffer_detach ();
+                    free (att.buf);
+                }
+                if (MPI_SUCCESS != ret) {
+                    fprintf(stderr, "Error in window_test. Aborting\n");
+                    goto out;
+                }
+            }
+        }
+    }
+
+ out:
+    sbuf.Free();
+    rbuf.Free();
+    free (reqs);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
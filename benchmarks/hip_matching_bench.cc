@@ -0,0 +1,218 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Cost of matching a message as the unexpected message queue grows.
+** Every process posts depth messages across --tags tags to process 0
+** before it starts receiving, for depth = 1, 2, 4, ... --queue-depth.
+** Process 0 drains the messages with specific, wildcard and matched
+** probe receives, and the time of draining divided by the number of
+** messages is reported for each way of receiving. The data received is
+** verified after the timed drain.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
+#include "hip_mpitest_matching.h"
+
+#define NITER_LONG   5
+#define NITER_SHORT  50
+#define NITER_THRESH 1024
+long elements=1;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+// Executes niter rounds of flooding process root with depth messages per
+// process and draining them in the given mode. Returns the time process
+// root spent draining and whether the messages of the last round were
+// received correctly.
+static int match_test (int mode, int depth, int ntags, int niter, int rank, int root,
+                       hip_mpitest_typed_buffer<int> &sbuf, hip_mpitest_typed_buffer<int> &rbuf,
+                       MPI_Request *reqs, int *sources, int *tags, int *expected,
+                       MPI_Comm comm, double *time, bool *res)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int nprocs, ret=MPI_SUCCESS;
+
+    MPI_Comm_size (comm, &nprocs);
+    *time = 0.0;
+    *res  = true;
+    for (int iter=0; iter<niter && MPI_SUCCESS == ret; iter++) {
+        if (rank != root) {
+            ret = hip_mpitest_match_flood (sbuf.get_buffer(), elements, root, depth, ntags,
+                                           comm, reqs);
+        }
+        else if (rbuf.Generate(hip_mpitest_match_init_recvbuf) != hipSuccess) {
+            // reset outside of the timed drain, such that the data of earlier
+            // rounds can not satisfy the check of the last one
+            ret = MPI_ERR_OTHER;
+        }
+        // all messages are sent before the receiver starts matching
+        MPI_Barrier (comm);
+        if (MPI_SUCCESS != ret) {
+            break;
+        }
+        if (rank == root) {
+            ts = std::chrono::high_resolution_clock::now();
+            ret = hip_mpitest_match_drain (mode, rbuf.get_buffer(), elements, root, depth, ntags,
+                                           comm, sources, tags);
+            te = std::chrono::high_resolution_clock::now();
+            *time += std::chrono::duration<double>(te-ts).count();
+        }
+        else {
+            ret = MPI_Waitall (depth, reqs, MPI_STATUSES_IGNORE);
+        }
+    }
+
+    if (MPI_SUCCESS == ret && rank == root) {
+        int nmsgs = (nprocs - 1) * depth;
+        hip_mpitest_match_expected (nmsgs, sources, tags, nprocs, depth, ntags, expected);
+        *res = rbuf.Verify([expected](const int *buf, long first, long n) {
+                               return hip_mpitest_match_check_recvbuf(buf, first, n, elements,
+                                                                      expected); });
+    }
+    return ret;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size;
+    int root = 0;
+    int maxdepth, ntags, maxmsgs;
+    bool res, fret=true;
+    hip_mpitest_typed_buffer<int> sbuf, rbuf;
+    MPI_Request *reqs=NULL;
+    int *sources=NULL, *tags=NULL, *expected=NULL;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    if (size < 2) {
+        if (rank == 0) {
+            printf("%s requires at least two processes\n", argv[0]);
+        }
+        MPI_Finalize ();
+        return 1;
+    }
+    maxdepth = hip_mpitest_queue_depth;
+    ntags    = hip_mpitest_tags;
+    maxmsgs  = (size - 1) * maxdepth;
+
+    reqs     = (MPI_Request *) malloc (maxdepth * sizeof(MPI_Request));
+    sources  = (int *) malloc (maxmsgs * sizeof(int));
+    tags     = (int *) malloc (maxmsgs * sizeof(int));
+    expected = (int *) malloc (maxmsgs * sizeof(int));
+    if (NULL == reqs || NULL == sources || NULL == tags || NULL == expected) {
+        fprintf(stderr, "Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes, %d tags, messages of %ld elements\n\n",
+               argv[0], sendbuf->get_memchar(), recvbuf->get_memchar(), size, ntags, elements);
+        printf("Time per matched message in usec, queue length being the number of messages of all processes\n");
+        printf("depth \t queue length");
+        for (int mode=0; mode<HIP_MPITEST_MATCH_LAST; mode++) {
+            printf(" \t %-10s", hip_mpitest_match_names[mode]);
+        }
+        printf(" \t result\n");
+        printf("=================================================================================================================\n");
+    }
+
+    for (int depth=1; depth<=maxdepth; depth*=2) {
+        int niter = depth >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+        double t[HIP_MPITEST_MATCH_LAST];
+        int pret=1, gret;
+
+        // Buffers for the messages of one round
+        if (rank == root) {
+            if (rbuf.Allocate(recvbuf, (long)(size - 1) * depth * elements) != hipSuccess ||
+                rbuf.Generate(hip_mpitest_match_init_recvbuf) != hipSuccess) {
+                ret = MPI_ERR_OTHER;
+                goto out;
+            }
+        }
+        else {
+            if (sbuf.Allocate(sendbuf, (long)depth * elements) != hipSuccess ||
+                sbuf.Generate([rank, depth, ntags](int *buf, long first, long n) {
+                                  hip_mpitest_match_init_sendbuf(buf, first, n, rank, elements,
+                                                                 depth, ntags); })
+                != hipSuccess) {
+                ret = MPI_ERR_OTHER;
+                goto out;
+            }
+        }
+
+        for (int mode=0; mode<HIP_MPITEST_MATCH_LAST; mode++) {
+            ret = match_test (mode, depth, ntags, niter, rank, root, sbuf, rbuf, reqs, sources,
+                              tags, expected, MPI_COMM_WORLD, &t[mode], &res);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in match_test. Aborting\n");
+                goto out;
+            }
+            pret &= res ? 1 : 0;
+        }
+        MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        if (rank == root) {
+            double nmsgs = (double)(size - 1) * depth * niter;
+            printf("%5d \t %12d", depth, (size - 1) * depth);
+            for (int mode=0; mode<HIP_MPITEST_MATCH_LAST; mode++) {
+                printf(" \t %lf", t[mode] / nmsgs * 1e6);
+            }
+            printf(" \t %s\n", gret != 0 ? "SUCCESS" : "FAILED");
+        }
+        fret &= (gret != 0);
+    }
+
+ out:
+    sbuf.Free();
+    rbuf.Free();
+    free (reqs);
+    free (sources);
+    free (tags);
+    free (expected);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
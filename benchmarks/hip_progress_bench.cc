@@ -0,0 +1,303 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Compares strategies for completing the requests of a nonblocking
+** exchange, by completing the same set of requests with
+**   waitall:         MPI_Waitall
+**   testall:         MPI_Testall polled in a busy loop
+**   testall-backoff: MPI_Testall with a sleep between the polls, starting
+**                    at 1 usec and doubling up to --progress-backoff usec
+**   waitany:         MPI_Waitany, one completion at a time
+**   testany:         MPI_Testany polled in a busy loop
+**   waitsome:        MPI_Waitsome, processing completions as they arrive
+**   testsome:        MPI_Testsome polled in a busy loop
+** For every strategy the latency of an exchange, the throughput and the
+** CPU time (user + system, from getrusage) consumed by the process per
+** exchange are reported. The peers are selected with --pattern, every
+** process exchanging data with all others by default.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_layout.h"
+#include "hip_mpitest_pattern.h"
+
+#define NITER_LONG   20
+#define NITER_SHORT  200
+#define NITER_THRESH 131072
+long elements=1048576;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+enum HIP_MPITEST_PROGRESS {
+      HIP_MPITEST_PROGRESS_WAITALL=0,
+      HIP_MPITEST_PROGRESS_TESTALL,
+      HIP_MPITEST_PROGRESS_TESTALL_BACKOFF,
+      HIP_MPITEST_PROGRESS_WAITANY,
+      HIP_MPITEST_PROGRESS_TESTANY,
+      HIP_MPITEST_PROGRESS_WAITSOME,
+      HIP_MPITEST_PROGRESS_TESTSOME,
+      HIP_MPITEST_PROGRESS_LAST
+};
+
+const char *const hip_mpitest_progress_names[HIP_MPITEST_PROGRESS_LAST] = {
+    "waitall", "testall", "testall-backoff", "waitany", "testany", "waitsome", "testsome"};
+
+static double cputime (void)
+{
+    struct rusage usage;
+
+    getrusage (RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+// Completes the nreqs requests of reqs using the given strategy
+static int progress_complete (int strategy, int nreqs, MPI_Request *reqs, int *indices)
+{
+    int ret=MPI_SUCCESS;
+    int flag=0, idx, outcount, done=0;
+    long backoff=1;
+
+    switch (strategy) {
+    case HIP_MPITEST_PROGRESS_WAITALL :
+        ret = MPI_Waitall (nreqs, reqs, MPI_STATUSES_IGNORE);
+        break;
+    case HIP_MPITEST_PROGRESS_TESTALL :
+        while (!flag && MPI_SUCCESS == ret) {
+            ret = MPI_Testall (nreqs, reqs, &flag, MPI_STATUSES_IGNORE);
+        }
+        break;
+    case HIP_MPITEST_PROGRESS_TESTALL_BACKOFF :
+        while (MPI_SUCCESS == ret) {
+            ret = MPI_Testall (nreqs, reqs, &flag, MPI_STATUSES_IGNORE);
+            if (flag) {
+                break;
+            }
+            usleep (backoff);
+            backoff = (2 * backoff < hip_mpitest_progress_backoff) ? 2 * backoff :
+                hip_mpitest_progress_backoff;
+        }
+        break;
+    case HIP_MPITEST_PROGRESS_WAITANY :
+        while (done < nreqs && MPI_SUCCESS == ret) {
+            ret = MPI_Waitany (nreqs, reqs, &idx, MPI_STATUS_IGNORE);
+            if (MPI_UNDEFINED == idx) {
+                break;
+            }
+            done++;
+        }
+        break;
+    case HIP_MPITEST_PROGRESS_TESTANY :
+        while (done < nreqs && MPI_SUCCESS == ret) {
+            ret = MPI_Testany (nreqs, reqs, &idx, &flag, MPI_STATUS_IGNORE);
+            if (flag) {
+                if (MPI_UNDEFINED == idx) {
+                    break;
+                }
+                done++;
+            }
+        }
+        break;
+    case HIP_MPITEST_PROGRESS_WAITSOME :
+        while (done < nreqs && MPI_SUCCESS == ret) {
+            ret = MPI_Waitsome (nreqs, reqs, &outcount, indices, MPI_STATUSES_IGNORE);
+            if (MPI_UNDEFINED == outcount) {
+                break;
+            }
+            done += outcount;
+        }
+        break;
+    case HIP_MPITEST_PROGRESS_TESTSOME :
+        while (done < nreqs && MPI_SUCCESS == ret) {
+            ret = MPI_Testsome (nreqs, reqs, &outcount, indices, MPI_STATUSES_IGNORE);
+            if (MPI_UNDEFINED == outcount) {
+                break;
+            }
+            done += outcount;
+        }
+        break;
+    }
+    return ret;
+}
+
+// Executes niter exchanges of count bytes with the peers of the schedule,
+// completing them with the given strategy. Returns the time and the CPU
+// time spent and the number of bytes sent.
+static int progress_test (int strategy, hip_mpitest_peer_buffer<char> &sbuf,
+                          hip_mpitest_peer_buffer<char> &rbuf, long count, int niter,
+                          hip_mpitest_schedule &sched, int *senders, MPI_Request *reqs,
+                          int *indices, MPI_Comm comm, double *time, double *cpu, double *bytes)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int size, ret=MPI_SUCCESS;
+    int tag=311;
+    double cs, ce;
+
+    MPI_Comm_size (comm, &size);
+    *bytes = 0.0;
+    ret = MPI_Barrier (comm);
+    ts = std::chrono::high_resolution_clock::now();
+    cs = cputime();
+    for (int iter=0; iter<niter && MPI_SUCCESS == ret; iter++) {
+        int nreqs=0;
+
+        sched.Generate(iter);
+        for (int i=0; i<size && MPI_SUCCESS == ret; i++) {
+            if (sched.RecvsFrom(i)) {
+                senders[i] = i;
+                ret = MPI_Irecv (rbuf.get_slice(i), count, MPI_CHAR, i, tag, comm, &reqs[nreqs++]);
+            }
+            if (sched.SendsTo(i) && MPI_SUCCESS == ret) {
+                ret = MPI_Isend (sbuf.get_slice(i), count, MPI_CHAR, i, tag, comm, &reqs[nreqs++]);
+            }
+        }
+        if (MPI_SUCCESS == ret) {
+            ret = progress_complete (strategy, nreqs, reqs, indices);
+        }
+        *bytes += (double)sched.get_nsend() * count;
+    }
+    ce = cputime();
+    te = std::chrono::high_resolution_clock::now();
+    *time = std::chrono::duration<double>(te-ts).count();
+    *cpu  = ce - cs;
+    return ret;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size;
+    bool fret=true;
+    hip_mpitest_peer_buffer<char> sbuf, rbuf;
+    hip_mpitest_schedule sched;
+    MPI_Request *reqs=NULL;
+    int *indices=NULL;
+    int *senders=NULL;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    ret = sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL);
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+    reqs    = (MPI_Request *) malloc (2 * size * sizeof(MPI_Request));
+    indices = (int *) malloc (2 * size * sizeof(int));
+    senders = (int *) malloc (size * sizeof(int));
+    if (NULL == reqs || NULL == indices || NULL == senders) {
+        fprintf(stderr, "Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes, pattern %s, back-off up to %ld usec\n\n",
+               argv[0], sendbuf->get_memchar(), recvbuf->get_memchar(), size,
+               hip_mpitest_pattern_names[sched.get_pattern()], hip_mpitest_progress_backoff);
+        printf("Latency and CPU time (user + system) per exchange in usec, throughput in MB/s\n");
+        printf("msg. length \t strategy \t\t latency \t throughput \t CPU time \t CPU usage \t result\n");
+        printf("=================================================================================================================\n");
+    }
+
+    for (long count=1; count<=elements; count *=2 ) {
+        int niter = count >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+
+        if (sbuf.Allocate(sendbuf, size, count, hip_mpitest_layout) != hipSuccess ||
+            sbuf.Generate([rank, count](char *b, long first, long n) {
+                              bench_init_sendbuf(b, first, n, count, rank); }) != hipSuccess ||
+            rbuf.Allocate(recvbuf, size, count, hip_mpitest_layout) != hipSuccess) {
+            fprintf(stderr, "Could not allocate buffers. Aborting\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+
+        for (int strategy=0; strategy<HIP_MPITEST_PROGRESS_LAST; strategy++) {
+            double t, tmax, cpu, cpusum, bytes, bytesum;
+            int pret, gret;
+            bool res;
+
+            if (rbuf.Generate(bench_init_recvbuf) != hipSuccess) {
+                ret = MPI_ERR_OTHER;
+                goto out;
+            }
+            for (int i=0; i<size; i++) {
+                senders[i] = -1;
+            }
+            ret = progress_test (strategy, sbuf, rbuf, count, niter, sched, senders, reqs,
+                                 indices, MPI_COMM_WORLD, &t, &cpu, &bytes);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in progress_test. Aborting\n");
+                goto out;
+            }
+            res = rbuf.Verify([count, senders](const char *b, long first, long n) {
+                                  return bench_check_recvbuf(b, first, n, count, count,
+                                                             senders); });
+            pret = res ? 1 : 0;
+
+            MPI_Reduce(&t, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&cpu, &cpusum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&bytes, &bytesum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+            if (rank == 0) {
+                // CPU time and usage are averages over the processes
+                printf("%10ld \t %-16s \t %lf \t %lf \t %lf \t %6.1lf%% \t %s\n", count,
+                       hip_mpitest_progress_names[strategy], tmax / niter * 1e6,
+                       bytesum / tmax / (1024 * 1024), cpusum / size / niter * 1e6,
+                       cpusum / size / tmax * 100.0, gret != 0 ? "SUCCESS" : "FAILED");
+            }
+            fret &= (gret != 0);
+        }
+    }
+
+ out:
+    sbuf.Free();
+    rbuf.Free();
+    free (reqs);
+    free (indices);
+    free (senders);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Ping-pong latency between two processes for message sizes of 1 byte up
+** to -n bytes, doubling the size in every step. With --protocol-fit
+** <steps> the sizes are swept in steps per power of two instead, and the
+** median latencies are split into linear segments. The switch points
+** between the segments are the sizes at which the MPI library changes
+** its protocol, e.g. from eager to rendezvous, and the slope of every
+** segment is its cost per byte.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+#include <algorithm>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
+#include "hip_mpitest_fit.h"
+
+#define NITER_LONG   50
+#define NITER_SHORT  500
+#define NITER_THRESH 131072
+long elements=4194304;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+// Message sizes from 1 to max bytes, steps sizes per power of two
+static int get_sizes (long max, int steps, long *sizes)
+{
+    int n=0;
+
+    for (long base=1; base<=max; base*=2) {
+        for (int j=0; j<steps; j++) {
+            long s = lround(base * pow(2.0, (double)j / steps));
+            if (s > max) {
+                break;
+            }
+            if (n == 0 || s > sizes[n-1]) {
+                sizes[n++] = s;
+            }
+        }
+    }
+    return n;
+}
+
+int pingpong_test (char *sbuf, char *rbuf, long count, MPI_Comm comm, int niterations,
+                   double *t);
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size, peer;
+    double t2;
+    bool res, fret=true;
+    int steps, nsizes=0;
+    long *sizes=NULL;
+    double *t=NULL, *lat=NULL, *x=NULL;
+    hip_mpitest_typed_buffer<char> sbuf, rbuf;
+    hip_mpitest_fit_segment seg[HIP_MPITEST_FIT_MAXSEG];
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    hip_mpitest_max_elements = LONG_MAX;
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    if (size != 2) {
+        printf("This benchmark requires exactly two processes!\n");
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    peer  = 1 - rank;
+    steps = hip_mpitest_protocol_steps > 0 ? hip_mpitest_protocol_steps : 1;
+
+    sizes = (long *) malloc (64 * steps * sizeof(long));
+    t     = (double *) malloc (NITER_SHORT * sizeof(double));
+    lat   = (double *) malloc (64 * steps * sizeof(double));
+    x     = (double *) malloc (64 * steps * sizeof(double));
+    if (NULL == sizes || NULL == t || NULL == lat || NULL == x) {
+        fprintf(stderr, "Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    nsizes = get_sizes (elements, steps, sizes);
+
+    // Buffers of the largest message, smaller ones use the beginning
+    if (sbuf.Allocate(sendbuf, elements) != hipSuccess ||
+        sbuf.Generate([rank](char *b, long first, long n) {
+                          bench_init_sendbuf(b, first, n, elements, rank); }) != hipSuccess ||
+        rbuf.Allocate(recvbuf, elements) != hipSuccess ||
+        rbuf.Generate(bench_init_recvbuf) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    sbuf.Report(MPI_COMM_WORLD, "Sendbuf");
+    rbuf.Report(MPI_COMM_WORLD, "Recvbuf");
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes\n\n", argv[0],  sendbuf->get_memchar(), recvbuf->get_memchar(), size);
+        if (hip_mpitest_protocol_steps > 0) {
+            printf("Protocol analysis with %d message sizes per power of two, median one-way latency\n",
+                   steps);
+            printf("msg. length \t latency (usec) \t bandwidth (MB/s) \t result\n");
+        }
+        else {
+            printf("No. of elems \t msg. length \t time \t\t check time \t result\n");
+        }
+        printf("================================================================================\n");
+    }
+
+    for (int i=0; i<nsizes; i++) {
+        long len  = sizes[i];
+        int niter = len >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+        double tsum=0.0;
+
+        //Warmup
+        ret = pingpong_test (sbuf.get_buffer(), rbuf.get_buffer(), len, MPI_COMM_WORLD, 1, t);
+        if (MPI_SUCCESS != ret) {
+            fprintf(stderr, "Error in pingpong_test. Aborting\n");
+            goto out;
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        hip_mpitest_pagefaults_begin();
+        ret = pingpong_test (sbuf.get_buffer(), rbuf.get_buffer(), len, MPI_COMM_WORLD, niter, t);
+        if (MPI_SUCCESS != ret) {
+            fprintf(stderr, "Error in pingpong_test. Aborting\n");
+            goto out;
+        }
+        hip_mpitest_pagefaults_end();
+        for (int it=0; it<niter; it++) {
+            tsum += t[it];
+        }
+        // one-way latency in usec, the median is robust against outliers
+        std::sort(t, t + niter);
+        lat[i] = (niter % 2 ? t[niter/2] : (t[niter/2-1] + t[niter/2]) / 2.0) * 1e6 / 2.0;
+        x[i]   = (double)len;
+
+        // verify results outside of the timed loop. The first len bytes
+        // hold the data of process peer, the remaining ones are untouched.
+        ret = bench_verify (MPI_COMM_WORLD,
+                            [&]() { return rbuf.Generate(bench_init_recvbuf) == hipSuccess; },
+                            [&]() { return pingpong_test (sbuf.get_buffer(), rbuf.get_buffer(), len,
+                                                          MPI_COMM_WORLD, 1, t); },
+                            [&]() {
+                                return rbuf.Verify([peer, len](const char *b, long first, long n) {
+                                    return bench_check_recvbuf(b, first, n, elements, len,
+                                                               &peer); }); },
+                            &res, &t2);
+        if (MPI_SUCCESS != ret) {
+            fprintf(stderr, "Error in pingpong_test. Aborting\n");
+            goto out;
+        }
+
+        if (hip_mpitest_protocol_steps > 0) {
+            int pret = res ? 1 : 0, gret;
+            MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+            if (rank == 0) {
+                printf("%11ld \t %14.3lf \t %16.1lf \t %s\n", len, lat[i], len / lat[i],
+                       gret != 0 ? "SUCCESS" : "FAILED");
+            }
+            fret &= (gret != 0);
+        }
+        else {
+            fret &= bench_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
+                                       len, (size_t)len, niter, tsum / 2.0, t2, res);
+        }
+    }
+
+    if (hip_mpitest_protocol_steps > 0 && rank == 0) {
+        int nseg = hip_mpitest_fit_segments (x, lat, nsizes, steps, seg);
+        hip_mpitest_fit_report (x, lat, nsizes, seg, nseg);
+    }
+
+ out:
+    HIP_CHECK(sbuf.Free());
+    HIP_CHECK(rbuf.Free());
+    free (sizes);
+    free (t);
+    free (lat);
+    free (x);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
+
+// Process 0 sends count bytes to process 1 and receives them back. t[i]
+// is the time of the i-th round trip.
+int pingpong_test (char *sbuf, char *rbuf, long count, MPI_Comm comm, int niterations,
+                   double *t)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int rank, ret=MPI_SUCCESS;
+    int tag=251;
+
+    MPI_Comm_rank (comm, &rank);
+
+    for (int i=0; i<niterations; i++) {
+        ts = std::chrono::high_resolution_clock::now();
+        if (rank == 0) {
+            ret = hip_mpitest_send (sbuf, count, MPI_CHAR, 1, tag, comm);
+            if (MPI_SUCCESS != ret) {
+                return ret;
+            }
+            ret = hip_mpitest_recv (rbuf, count, MPI_CHAR, 1, tag, comm, MPI_STATUS_IGNORE);
+        }
+        else {
+            ret = hip_mpitest_recv (rbuf, count, MPI_CHAR, 0, tag, comm, MPI_STATUS_IGNORE);
+            if (MPI_SUCCESS != ret) {
+                return ret;
+            }
+            ret = hip_mpitest_send (sbuf, count, MPI_CHAR, 0, tag, comm);
+        }
+        if (MPI_SUCCESS != ret) {
+            return ret;
+        }
+        te = std::chrono::high_resolution_clock::now();
+        t[i] = std::chrono::duration<double>(te-ts).count();
+    }
+    return MPI_SUCCESS;
+}
@@ -0,0 +1,401 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+/*
+** Latency and bandwidth between every pair of processes. The pairs are
+** scheduled in rounds in which every process takes part in at most one
+** pair, such that the measurements do not interfere with each other. In
+** every round both processes of a pair initiate a ping-pong of 1 byte
+** for the latency and of -n bytes for the bandwidth, giving an N x N
+** matrix in which row i holds the values measured by process i. The
+** matrices are printed as CSV and as an ASCII heatmap, together with the
+** GPU and NUMA placement of every process, to spot slow pairs, e.g.
+** across sockets or GPU links.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+#include <algorithm>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
+
+#define NITER_LONG   20
+#define NITER_SHORT  100
+#define NITER_THRESH 131072
+#define LAT_SIZE     1
+long elements=4194304;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+// Heatmap shades from fast to slow
+static const char heat_shades[] = " .:-=+*#%@";
+#define NUM_SHADES ((int)sizeof(heat_shades) - 1)
+
+// Partner of rank in round r of a round-robin schedule of m processes,
+// m being even. Every process meets every other one exactly once in
+// m-1 rounds.
+static int get_partner (int rank, int r, int m)
+{
+    if (rank == m - 1) {
+        return r;
+    }
+    if (rank == r) {
+        return m - 1;
+    }
+    return (2 * r - rank + m - 1) % (m - 1);
+}
+
+static void print_placement (hip_mpitest_placement *p, int size)
+{
+    printf("Placement:\n");
+    printf("rank \t host \t\t local rank \t GPU \t PCI bus id \t GPU NUMA \t CPU \t CPU NUMA\n");
+    for (int i=0; i<size; i++) {
+        printf("%4d \t %-12s \t %10d \t %3d \t %-12s \t %8d \t %3d \t %8d\n", i,
+               p[i].host, p[i].local_rank, p[i].device,
+               p[i].busid[0] != '\0' ? p[i].busid : "-", p[i].gpu_numa, p[i].cpu,
+               p[i].cpu_numa);
+    }
+    printf("\n");
+}
+
+static void print_csv (const char *title, double *val, int size)
+{
+    printf("# %s, row: initiating process, column: peer\n", title);
+    printf("rank");
+    for (int j=0; j<size; j++) {
+        printf(",%d", j);
+    }
+    printf("\n");
+    for (int i=0; i<size; i++) {
+        printf("%d", i);
+        for (int j=0; j<size; j++) {
+            if (i == j) {
+                printf(",");
+            }
+            else {
+                printf(",%.3lf", val[i*size+j]);
+            }
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+// Darker shades mark slower pairs, i.e. a higher latency or, with
+// higher_is_faster, a lower bandwidth
+static void print_heatmap (const char *title, double *val, int size, bool higher_is_faster)
+{
+    double vmin=0.0, vmax=0.0;
+    bool first=true;
+
+    for (int i=0; i<size; i++) {
+        for (int j=0; j<size; j++) {
+            if (i == j) {
+                continue;
+            }
+            if (first || val[i*size+j] < vmin) {
+                vmin = val[i*size+j];
+            }
+            if (first || val[i*size+j] > vmax) {
+                vmax = val[i*size+j];
+            }
+            first = false;
+        }
+    }
+
+    printf("%s heatmap, '%c' = %.3lf to '%c' = %.3lf\n", title, heat_shades[0],
+           higher_is_faster ? vmax : vmin, heat_shades[NUM_SHADES-1],
+           higher_is_faster ? vmin : vmax);
+    printf("     ");
+    for (int j=0; j<size; j++) {
+        printf("%d", j % 10);
+    }
+    printf("\n");
+    for (int i=0; i<size; i++) {
+        printf("%4d ", i);
+        for (int j=0; j<size; j++) {
+            int shade = 0;
+            if (i == j) {
+                printf("\\");
+                continue;
+            }
+            if (vmax > vmin) {
+                double rel = (val[i*size+j] - vmin) / (vmax - vmin);
+                if (higher_is_faster) {
+                    rel = 1.0 - rel;
+                }
+                shade = (int)(rel * (NUM_SHADES - 1) + 0.5);
+            }
+            printf("%c", heat_shades[shade]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+int pair_test (char *sbuf, char *rbuf, long count, int peer, bool initiator, MPI_Comm comm,
+               int niterations, double *t);
+
+// Median one-way latency in usec of count bytes between this process
+// and peer
+static int pair_latency (char *sbuf, char *rbuf, long count, int peer, bool initiator,
+                         MPI_Comm comm, double *t, double *lat)
+{
+    int niter = count >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+    int ret;
+
+    //Warmup
+    ret = pair_test (sbuf, rbuf, count, peer, initiator, comm, 1, t);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    ret = pair_test (sbuf, rbuf, count, peer, initiator, comm, niter, t);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    std::sort(t, t + niter);
+    *lat = (niter % 2 ? t[niter/2] : (t[niter/2-1] + t[niter/2]) / 2.0) * 1e6 / 2.0;
+    return MPI_SUCCESS;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size, m, nfailed=0;
+    bool fret=true;
+    double *t=NULL, *lat=NULL, *bw=NULL, *glat=NULL, *gbw=NULL;
+    char *ok=NULL, *gok=NULL;
+    hip_mpitest_placement place, *gplace=NULL;
+    hip_mpitest_typed_buffer<char> sbuf, rbuf;
+    std::chrono::high_resolution_clock::time_point ts, te;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    hip_mpitest_max_elements = LONG_MAX;
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    if (size < 2) {
+        printf("This benchmark requires at least two processes!\n");
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    if (elements < LAT_SIZE) {
+        elements = LAT_SIZE;
+    }
+    // a dummy process is added for an odd number of processes, its
+    // partner is idle for the round
+    m = size + size % 2;
+
+    t   = (double *) malloc (NITER_SHORT * sizeof(double));
+    lat = (double *) calloc (size, sizeof(double));
+    bw  = (double *) calloc (size, sizeof(double));
+    ok  = (char *) malloc (size * sizeof(char));
+    if (NULL == t || NULL == lat || NULL == bw || NULL == ok) {
+        fprintf(stderr, "Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    memset (ok, 1, size);
+    if (rank == 0) {
+        glat   = (double *) malloc (size * size * sizeof(double));
+        gbw    = (double *) malloc (size * size * sizeof(double));
+        gok    = (char *) malloc (size * size * sizeof(char));
+        gplace = (hip_mpitest_placement *) malloc (size * sizeof(hip_mpitest_placement));
+        if (NULL == glat || NULL == gbw || NULL == gok || NULL == gplace) {
+            fprintf(stderr, "Could not allocate memory. Aborting\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+    }
+
+    if (sbuf.Allocate(sendbuf, elements) != hipSuccess ||
+        sbuf.Generate([rank](char *b, long first, long n) {
+                          bench_init_sendbuf(b, first, n, elements, rank); }) != hipSuccess ||
+        rbuf.Allocate(recvbuf, elements) != hipSuccess ||
+        rbuf.Generate(bench_init_recvbuf) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    sbuf.Report(MPI_COMM_WORLD, "Sendbuf");
+    rbuf.Report(MPI_COMM_WORLD, "Recvbuf");
+
+    hip_mpitest_get_placement (&place);
+    MPI_Gather (&place, sizeof(hip_mpitest_placement), MPI_BYTE, gplace,
+                sizeof(hip_mpitest_placement), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("Benchmark: %s %c %c - %d processes, %d rounds, latency of %d byte, "
+               "bandwidth of %ld bytes\n\n", argv[0], sendbuf->get_memchar(),
+               recvbuf->get_memchar(), size, m - 1, LAT_SIZE, elements);
+        print_placement (gplace, size);
+    }
+
+    ts = std::chrono::high_resolution_clock::now();
+    for (int r=0; r<m-1; r++) {
+        int peer = get_partner (rank, r, m);
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        if (peer >= size) {
+            continue;
+        }
+        // both processes of the pair initiate in turn, the lower ranked one first
+        for (int k=0; k<2; k++) {
+            bool initiator = (k == 0) == (rank < peer);
+            double l, b;
+            int pret, peerret;
+            bool res;
+
+            ret = pair_latency (sbuf.get_buffer(), rbuf.get_buffer(), LAT_SIZE, peer,
+                                initiator, MPI_COMM_WORLD, t, &l);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in pair_test. Aborting\n");
+                goto out;
+            }
+            ret = pair_latency (sbuf.get_buffer(), rbuf.get_buffer(), elements, peer,
+                                initiator, MPI_COMM_WORLD, t, &b);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in pair_test. Aborting\n");
+                goto out;
+            }
+
+            // verify results outside of the timed loop, only the pair takes
+            // part hence there is no barrier
+            ret = bench_verify (MPI_COMM_SELF,
+                                [&]() { return rbuf.Generate(bench_init_recvbuf) == hipSuccess; },
+                                [&]() { return pair_test (sbuf.get_buffer(), rbuf.get_buffer(),
+                                                          elements, peer, initiator,
+                                                          MPI_COMM_WORLD, 1, t); },
+                                [&]() {
+                                    return rbuf.Verify([peer](const char *b, long first, long n) {
+                                        return bench_check_recvbuf(b, first, n, elements, elements,
+                                                                   &peer); }); },
+                                &res, NULL);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in pair_test. Aborting\n");
+                goto out;
+            }
+            // a failure on either side fails the measurement of the initiator
+            pret = res ? 1 : 0;
+            ret = MPI_Sendrecv (&pret, 1, MPI_INT, peer, 252, &peerret, 1, MPI_INT, peer, 252,
+                                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+            if (initiator) {
+                lat[peer] = l;
+                bw[peer]  = elements / b;
+                ok[peer]  = pret && peerret;
+            }
+        }
+    }
+    te = std::chrono::high_resolution_clock::now();
+
+    MPI_Gather (lat, size, MPI_DOUBLE, glat, size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather (bw, size, MPI_DOUBLE, gbw, size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather (ok, size, MPI_CHAR, gok, size, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        print_csv ("Latency (usec)", glat, size);
+        print_csv ("Bandwidth (MB/s)", gbw, size);
+        print_heatmap ("Latency", glat, size, false);
+        print_heatmap ("Bandwidth", gbw, size, true);
+
+        for (int i=0; i<size; i++) {
+            for (int j=0; j<size; j++) {
+                if (i != j && !gok[i*size+j]) {
+                    printf("Verification failed for process %d -> %d\n", i, j);
+                    nfailed++;
+                }
+            }
+        }
+        printf("%d process pairs in %.2lf seconds, %d failed: %s\n", size * (size - 1),
+               std::chrono::duration<double>(te-ts).count(), nfailed,
+               nfailed == 0 ? "SUCCESS" : "FAILED");
+    }
+    MPI_Bcast (&nfailed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    fret = (nfailed == 0);
+
+ out:
+    HIP_CHECK(sbuf.Free());
+    HIP_CHECK(rbuf.Free());
+    free (t);
+    free (lat);
+    free (bw);
+    free (ok);
+    free (glat);
+    free (gbw);
+    free (gok);
+    free (gplace);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
+
+// The initiator sends count bytes to peer and receives them back. t[i]
+// is the time of the i-th round trip.
+int pair_test (char *sbuf, char *rbuf, long count, int peer, bool initiator, MPI_Comm comm,
+               int niterations, double *t)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int ret=MPI_SUCCESS;
+    int tag=251;
+
+    for (int i=0; i<niterations; i++) {
+        ts = std::chrono::high_resolution_clock::now();
+        if (initiator) {
+            ret = hip_mpitest_send (sbuf, count, MPI_CHAR, peer, tag, comm);
+            if (MPI_SUCCESS != ret) {
+                return ret;
+            }
+            ret = hip_mpitest_recv (rbuf, count, MPI_CHAR, peer, tag, comm, MPI_STATUS_IGNORE);
+        }
+        else {
+            ret = hip_mpitest_recv (rbuf, count, MPI_CHAR, peer, tag, comm, MPI_STATUS_IGNORE);
+            if (MPI_SUCCESS != ret) {
+                return ret;
+            }
+            ret = hip_mpitest_send (sbuf, count, MPI_CHAR, peer, tag, comm);
+        }
+        if (MPI_SUCCESS != ret) {
+            return ret;
+        }
+        te = std::chrono::high_resolution_clock::now();
+        t[i] = std::chrono::duration<double>(te-ts).count();
+    }
+    return MPI_SUCCESS;
+}
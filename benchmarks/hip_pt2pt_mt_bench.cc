@@ -0,0 +1,255 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Aggregate message rate and bandwidth of nonblocking exchanges executed
+** concurrently by an increasing number of threads per process under
+** MPI_THREAD_MULTIPLE, from 1 up to --threads threads. Thread t of a
+** process exchanges windows of messages with thread t of its peer, the
+** traffic of the threads being separated either by a tag per thread or
+** by a duplicate of the communicator per thread. A drop of the rate per
+** thread as threads are added shows contention inside the MPI library.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
+#include "hip_mpitest_mt.h"
+
+#define NITER_LONG   10
+#define NITER_SHORT  100
+#define NITER_THRESH 131072
+#define WINDOW       8
+long elements=262144;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+// Runs niter exchanges of count bytes on nthreads threads, separated
+// according to mode, and returns the longest time of a thread. The data
+// received is verified afterwards.
+static int mt_test (int nthreads, int mode, long count, int niter, int rank, int peer,
+                    hip_mpitest_buffer **smem, hip_mpitest_buffer **rmem, MPI_Comm *comms,
+                    hip_mpitest_mt_ctx *ctx, double *time, bool *res)
+{
+    hip_mpitest_typed_buffer<char> *sbuf, *rbuf;
+    int ret = MPI_SUCCESS;
+
+    *time = 0.0;
+    *res  = true;
+    sbuf = new hip_mpitest_typed_buffer<char>[nthreads];
+    rbuf = new hip_mpitest_typed_buffer<char>[nthreads];
+    for (int t=0; t<nthreads; t++) {
+        // every thread sends its own data, as if it was a process of its own
+        if (sbuf[t].Allocate(smem[t], count * WINDOW) != hipSuccess ||
+            sbuf[t].Generate([rank, t, count](char *b, long first, long n) {
+                                 bench_init_sendbuf(b, first, n, count * WINDOW,
+                                                    rank * 31 + t); }) != hipSuccess ||
+            rbuf[t].Allocate(rmem[t], count * WINDOW) != hipSuccess ||
+            rbuf[t].Generate(bench_init_recvbuf) != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+            break;
+        }
+        hip_mpitest_mt_setup (&ctx[t], t, mode, MPI_COMM_WORLD, comms, 401);
+        ctx[t].peer     = peer;
+        ctx[t].sbuf     = sbuf[t].get_buffer();
+        ctx[t].rbuf     = rbuf[t].get_buffer();
+        ctx[t].datatype = MPI_CHAR;
+        ctx[t].count    = count;
+        ctx[t].window   = WINDOW;
+    }
+
+    if (MPI_SUCCESS == ret) {
+        //Warmup
+        for (int t=0; t<nthreads; t++) {
+            ctx[t].niter = 1;
+        }
+        ret = hip_mpitest_mt_run (ctx, nthreads);
+    }
+    if (MPI_SUCCESS == ret) {
+        MPI_Barrier (MPI_COMM_WORLD);
+        for (int t=0; t<nthreads; t++) {
+            ctx[t].niter = niter;
+        }
+        ret = hip_mpitest_mt_run (ctx, nthreads);
+        for (int t=0; t<nthreads; t++) {
+            *time = ctx[t].time > *time ? ctx[t].time : *time;
+        }
+    }
+
+    if (MPI_SUCCESS == ret && MPI_PROC_NULL != peer) {
+        for (int t=0; t<nthreads; t++) {
+            int sender = peer * 31 + t;
+            *res &= rbuf[t].Verify([sender, count](const char *b, long first, long n) {
+                                       return bench_check_recvbuf(b, first, n, count * WINDOW,
+                                                                  count * WINDOW, &sender); });
+        }
+    }
+    for (int t=0; t<nthreads; t++) {
+        if (sbuf[t].Free() != hipSuccess || rbuf[t].Free() != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+        }
+    }
+    delete [] sbuf;
+    delete [] rbuf;
+    return ret;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size, peer, npairs;
+    int maxthreads;
+    bool res, fret=true;
+    hip_mpitest_buffer **smem=NULL, **rmem=NULL;
+    hip_mpitest_mt_ctx *ctx=NULL;
+    MPI_Comm *comms=NULL;
+
+    bind_device();
+
+    if (!hip_mpitest_mt_init (&argc, &argv)) {
+        MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+        if (0 == rank) {
+            printf("%s: MPI_THREAD_MULTIPLE is not supported\n", argv[0]);
+        }
+        MPI_Finalize ();
+        return 1;
+    }
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    // Processes are paired as 0-1, 2-3, ..., the last one idles for odd sizes
+    peer = rank ^ 1;
+    if (peer >= size) {
+        peer = MPI_PROC_NULL;
+    }
+    npairs = size / 2;
+
+    // Every thread uses its own buffers of the memory types and placement
+    // of the ones created by parse_args, and its own communicator in comm
+    // mode
+    maxthreads = hip_mpitest_threads;
+    smem  = (hip_mpitest_buffer **) calloc (maxthreads, sizeof(hip_mpitest_buffer *));
+    rmem  = (hip_mpitest_buffer **) calloc (maxthreads, sizeof(hip_mpitest_buffer *));
+    ctx   = (hip_mpitest_mt_ctx *) calloc (maxthreads, sizeof(hip_mpitest_mt_ctx));
+    comms = (MPI_Comm *) malloc (maxthreads * sizeof(MPI_Comm));
+    if (NULL == smem || NULL == rmem || NULL == ctx || NULL == comms) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    for (int t=0; t<maxthreads; t++) {
+        comms[t] = MPI_COMM_NULL;
+    }
+    smem[0] = sendbuf;
+    rmem[0] = recvbuf;
+    for (int t=0; t<maxthreads; t++) {
+        if (t > 0) {
+            char stype[2] = {sendbuf->get_memchar(), '\0'};
+            char rtype[2] = {recvbuf->get_memchar(), '\0'};
+            SET_MEMBUF_TYPE(stype, smem[t], argc, argv, MPI_COMM_WORLD);
+            SET_MEMBUF_TYPE(rtype, rmem[t], argc, argv, MPI_COMM_WORLD);
+            smem[t]->set_offset(sendbuf->get_offset(), sendbuf->get_align());
+            rmem[t]->set_offset(recvbuf->get_offset(), recvbuf->get_align());
+        }
+        ret = MPI_Comm_dup (MPI_COMM_WORLD, &comms[t]);
+        if (MPI_SUCCESS != ret) {
+            goto out;
+        }
+    }
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes, up to %d threads, window of %d messages\n\n",
+               argv[0], sendbuf->get_memchar(), recvbuf->get_memchar(), size, maxthreads, WINDOW);
+        printf("Aggregate message rate in messages/s and bandwidth in MB/s of all threads\n");
+        printf("threads \t msg. length \t rate (tag) \t MB/s (tag) \t rate (comm) \t MB/s (comm) \t result\n");
+        printf("=================================================================================================================\n");
+    }
+
+    // powers of two, followed by maxthreads if it is none
+    for (int nthreads=1; ; nthreads = (2*nthreads < maxthreads) ? 2*nthreads : maxthreads) {
+        for (long count=1; count<=elements; count *=2 ) {
+            int niter = count >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+            double t[HIP_MPITEST_MT_LAST], tmax[HIP_MPITEST_MT_LAST];
+            int pret=1, gret;
+
+            for (int mode=0; mode<HIP_MPITEST_MT_LAST; mode++) {
+                ret = mt_test (nthreads, mode, count, niter, rank, peer, smem, rmem, comms, ctx,
+                               &t[mode], &res);
+                if (MPI_SUCCESS != ret) {
+                    fprintf(stderr, "Error in mt_test. Aborting\n");
+                    goto out;
+                }
+                pret &= res ? 1 : 0;
+            }
+            MPI_Reduce(t, tmax, HIP_MPITEST_MT_LAST, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+            if (rank == 0) {
+                // messages sent in both directions by all threads of all pairs
+                double nmsgs = 2.0 * npairs * nthreads * niter * WINDOW;
+                printf("%7d \t %10ld \t %lf \t %lf \t %lf \t %lf \t %s\n", nthreads, count,
+                       nmsgs / tmax[HIP_MPITEST_MT_TAG],
+                       nmsgs * count / tmax[HIP_MPITEST_MT_TAG] / (1024 * 1024),
+                       nmsgs / tmax[HIP_MPITEST_MT_COMM],
+                       nmsgs * count / tmax[HIP_MPITEST_MT_COMM] / (1024 * 1024),
+                       gret != 0 ? "SUCCESS" : "FAILED");
+            }
+            fret &= (gret != 0);
+        }
+        if (nthreads == maxthreads) {
+            break;
+        }
+    }
+
+ out:
+    if (NULL != smem && NULL != rmem && NULL != comms) {
+        for (int t=0; t<maxthreads; t++) {
+            if (t > 0) {
+                delete (smem[t]);
+                delete (rmem[t]);
+            }
+            if (MPI_COMM_NULL != comms[t]) {
+                MPI_Comm_free (&comms[t]);
+            }
+        }
+    }
+    free (smem);
+    free (rmem);
+    free (ctx);
+    free (comms);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
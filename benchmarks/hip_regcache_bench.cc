@@ -0,0 +1,255 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Measures the overhead of memory registration and memory type lookups
+** in the MPI library, by executing a ping-pong between pairs of processes
+**   reuse: on the same buffers in every iteration
+**   fresh: on buffers allocated anew in every iteration
+**   pool:  on buffers cycled through a pool of --churn-pool buffers
+** Only the communication is timed, allocation and initialization of the
+** buffers are excluded. The difference to the reuse mode is the overhead
+** per message caused by the buffer churn.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_typed_buffer.h"
+
+#define NITER_LONG   20
+#define NITER_SHORT  200
+#define NITER_THRESH 131072
+long elements=4194304;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+enum HIP_MPITEST_CHURN_MODE {
+      HIP_MPITEST_CHURN_REUSE=0,
+      HIP_MPITEST_CHURN_FRESH,
+      HIP_MPITEST_CHURN_POOL,
+      HIP_MPITEST_CHURN_LAST
+};
+
+static int churn_alloc (hip_mpitest_typed_buffer<char> *sbuf, hip_mpitest_buffer *smem,
+                        hip_mpitest_typed_buffer<char> *rbuf, hip_mpitest_buffer *rmem,
+                        long count, int rank)
+{
+    if (sbuf->Allocate(smem, count) != hipSuccess ||
+        sbuf->Generate([rank, count](char *b, long first, long n) {
+                           bench_init_sendbuf(b, first, n, count, rank); }) != hipSuccess ||
+        rbuf->Allocate(rmem, count) != hipSuccess ||
+        rbuf->Generate(bench_init_recvbuf) != hipSuccess) {
+        return MPI_ERR_OTHER;
+    }
+    return MPI_SUCCESS;
+}
+
+// Ping-pong of count bytes with peer, the process with the lower rank sends first
+static int churn_pingpong (char *sbuf, char *rbuf, long count, int rank, int peer,
+                           MPI_Comm comm)
+{
+    int tag=301;
+    int ret;
+
+    if (rank < peer) {
+        ret = MPI_Send (sbuf, count, MPI_CHAR, peer, tag, comm);
+        if (MPI_SUCCESS == ret) {
+            ret = MPI_Recv (rbuf, count, MPI_CHAR, peer, tag, comm, MPI_STATUS_IGNORE);
+        }
+    }
+    else {
+        ret = MPI_Recv (rbuf, count, MPI_CHAR, peer, tag, comm, MPI_STATUS_IGNORE);
+        if (MPI_SUCCESS == ret) {
+            ret = MPI_Send (sbuf, count, MPI_CHAR, peer, tag, comm);
+        }
+    }
+    return ret;
+}
+
+// Executes niter ping-pongs in the given mode and returns the time spent
+// communicating. The buffers of the last iteration are verified.
+static int churn_test (int mode, long count, int niter, int rank, int peer,
+                       hip_mpitest_buffer **spool, hip_mpitest_buffer **rpool, int npool,
+                       MPI_Comm comm, double *time, bool *res)
+{
+    hip_mpitest_typed_buffer<char> *sbuf, *rbuf;
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int nbuf = (HIP_MPITEST_CHURN_POOL == mode) ? npool : 1;
+    int ret = MPI_SUCCESS;
+    int cur = 0;
+
+    *time = 0.0;
+    *res  = true;
+    sbuf = new hip_mpitest_typed_buffer<char>[nbuf];
+    rbuf = new hip_mpitest_typed_buffer<char>[nbuf];
+    if (HIP_MPITEST_CHURN_FRESH != mode) {
+        for (int i=0; i<nbuf && MPI_SUCCESS == ret; i++) {
+            ret = churn_alloc (&sbuf[i], spool[i], &rbuf[i], rpool[i], count, rank);
+        }
+    }
+
+    for (int iter=0; iter<niter && MPI_SUCCESS == ret; iter++) {
+        cur = iter % nbuf;
+        if (HIP_MPITEST_CHURN_FRESH == mode) {
+            ret = churn_alloc (&sbuf[0], spool[0], &rbuf[0], rpool[0], count, rank);
+            if (MPI_SUCCESS != ret) {
+                break;
+            }
+        }
+        // Keep the time the peer spends allocating out of the measurement
+        ret = MPI_Sendrecv (NULL, 0, MPI_CHAR, peer, 0, NULL, 0, MPI_CHAR, peer, 0,
+                            comm, MPI_STATUS_IGNORE);
+        if (MPI_SUCCESS != ret) {
+            break;
+        }
+        ts = std::chrono::high_resolution_clock::now();
+        ret = churn_pingpong (sbuf[cur].get_buffer(), rbuf[cur].get_buffer(), count,
+                              rank, peer, comm);
+        te = std::chrono::high_resolution_clock::now();
+        *time += std::chrono::duration<double>(te-ts).count();
+    }
+
+    if (MPI_SUCCESS == ret && MPI_PROC_NULL != peer) {
+        *res = rbuf[cur].Verify([peer, count](const char *b, long first, long n) {
+                                    return bench_check_recvbuf(b, first, n, count, count,
+                                                               &peer); });
+    }
+    for (int i=0; i<nbuf; i++) {
+        if (sbuf[i].Free() != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+        }
+        if (rbuf[i].Free() != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+        }
+    }
+    delete [] sbuf;
+    delete [] rbuf;
+    return ret;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size, peer;
+    int npool;
+    double t[HIP_MPITEST_CHURN_LAST], tmax[HIP_MPITEST_CHURN_LAST];
+    bool res, fret=true;
+    int pret, gret;
+    hip_mpitest_buffer **spool=NULL, **rpool=NULL;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    // Processes are paired as 0-1, 2-3, ..., the last one idles for odd sizes
+    peer = rank ^ 1;
+    if (peer >= size) {
+        peer = MPI_PROC_NULL;
+    }
+
+    // The pool contains the buffers created by parse_args and additional
+    // ones of the same memory types and placement
+    npool = hip_mpitest_churn_pool;
+    spool = (hip_mpitest_buffer **) calloc (npool, sizeof(hip_mpitest_buffer *));
+    rpool = (hip_mpitest_buffer **) calloc (npool, sizeof(hip_mpitest_buffer *));
+    if (NULL == spool || NULL == rpool) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    spool[0] = sendbuf;
+    rpool[0] = recvbuf;
+    for (int i=1; i<npool; i++) {
+        char stype[2] = {sendbuf->get_memchar(), '\0'};
+        char rtype[2] = {recvbuf->get_memchar(), '\0'};
+        SET_MEMBUF_TYPE(stype, spool[i], argc, argv, MPI_COMM_WORLD);
+        SET_MEMBUF_TYPE(rtype, rpool[i], argc, argv, MPI_COMM_WORLD);
+        spool[i]->set_offset(sendbuf->get_offset(), sendbuf->get_align());
+        rpool[i]->set_offset(recvbuf->get_offset(), recvbuf->get_align());
+    }
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes, pool of %d buffers\n\n", argv[0],
+               sendbuf->get_memchar(), recvbuf->get_memchar(), size, npool);
+        printf("Time per message in usec, overhead relative to reusing the buffers\n");
+        printf("msg. length \t reuse \t\t fresh \t\t pool \t\t fresh ovh. \t pool ovh. \t result\n");
+        printf("=================================================================================================================\n");
+    }
+
+    for (long count=1; count<=elements; count *=2 ) {
+        int niter = count >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+
+        pret = 1;
+        for (int mode=0; mode<HIP_MPITEST_CHURN_LAST; mode++) {
+            ret = churn_test (mode, count, niter, rank, peer, spool, rpool, npool,
+                              MPI_COMM_WORLD, &t[mode], &res);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in churn_test. Aborting\n");
+                goto out;
+            }
+            // two messages per ping-pong
+            t[mode] = t[mode] / (2 * niter) * 1e6;
+            pret &= res ? 1 : 0;
+        }
+        MPI_Reduce(t, tmax, HIP_MPITEST_CHURN_LAST, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        if (rank == 0) {
+            printf("%10ld \t %lf \t %lf \t %lf \t %lf \t %lf \t %s\n", count,
+                   tmax[HIP_MPITEST_CHURN_REUSE], tmax[HIP_MPITEST_CHURN_FRESH],
+                   tmax[HIP_MPITEST_CHURN_POOL],
+                   tmax[HIP_MPITEST_CHURN_FRESH] - tmax[HIP_MPITEST_CHURN_REUSE],
+                   tmax[HIP_MPITEST_CHURN_POOL] - tmax[HIP_MPITEST_CHURN_REUSE],
+                   gret != 0 ? "SUCCESS" : "FAILED");
+        }
+        fret &= (gret != 0);
+    }
+
+ out:
+    if (NULL != spool && NULL != rpool) {
+        for (int i=1; i<npool; i++) {
+            delete (spool[i]);
+            delete (rpool[i]);
+        }
+    }
+    free (spool);
+    free (rpool);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
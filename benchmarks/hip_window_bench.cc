@@ -0,0 +1,259 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+/*
+** Throughput of a nonblocking exchange with the peers of --pattern
+** (every other process by default) as a function of the number of
+** requests a process keeps outstanding. For windows of 2 up to --window
+** requests, doubling in every step, the receives and sends are posted in
+** the order of hip_mpitest_window_peer() and completed requests are
+** replaced by the next operations as reported by MPI_Waitsome. Posting
+** all requests at once and completing them with MPI_Waitall is reported
+** as window "all" for comparison. The results help choosing injection
+** limits for all-to-all style communication phases.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+#include <chrono>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_bench.h"
+#include "hip_mpitest_layout.h"
+#include "hip_mpitest_pattern.h"
+#include "hip_mpitest_window.h"
+
+#define NITER_LONG   20
+#define NITER_SHORT  200
+#define NITER_THRESH 131072
+long elements=1048576;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+// Window sizes of 2 up to max, doubling in every step, followed by 0
+// for all requests at once. At most MAX_DEPTHS sizes for any int max.
+#define MAX_DEPTHS 32
+static int get_depths (int max, int *depths)
+{
+    int n=0;
+
+    // long, such that doubling beyond 2^30 does not overflow
+    for (long d=2; d<max; d*=2) {
+        depths[n++] = (int)d;
+    }
+    depths[n++] = max;
+    depths[n++] = 0;
+    return n;
+}
+
+// Executes niter exchanges of count bytes with the peers of the schedule
+// with at most depth requests outstanding, or all of them posted at once
+// for depth 0. Returns the time spent, the number of bytes sent and the
+// number of times the process waited for completions.
+static int window_test (int depth, hip_mpitest_peer_buffer<char> &sbuf,
+                        hip_mpitest_peer_buffer<char> &rbuf, long count, int niter,
+                        hip_mpitest_schedule &sched, int *senders, MPI_Request *reqs,
+                        MPI_Comm comm, double *time, double *bytes, long *nwaits)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int size, rank, ret=MPI_SUCCESS;
+    int tag=313;
+    hip_mpitest_window window;
+
+    MPI_Comm_size (comm, &size);
+    MPI_Comm_rank (comm, &rank);
+    *bytes  = 0.0;
+    *nwaits = 0;
+    if (depth > 0) {
+        ret = window.Init (depth);
+        if (MPI_SUCCESS != ret) {
+            return ret;
+        }
+    }
+    ret = MPI_Barrier (comm);
+    ts = std::chrono::high_resolution_clock::now();
+    for (int iter=0; iter<niter && MPI_SUCCESS == ret; iter++) {
+        int nreqs=0;
+
+        sched.Generate(iter);
+        if (depth > 0) {
+            ret = window.Run (2*(long)size, [&](long op, MPI_Request *req) {
+                bool is_send;
+                int peer = hip_mpitest_window_peer (rank, size, op, &is_send);
+                if (is_send) {
+                    if (!sched.SendsTo(peer)) {
+                        return MPI_SUCCESS;
+                    }
+                    return MPI_Isend (sbuf.get_slice(peer), count, MPI_CHAR, peer, tag, comm, req);
+                }
+                if (!sched.RecvsFrom(peer)) {
+                    return MPI_SUCCESS;
+                }
+                senders[peer] = peer;
+                return MPI_Irecv (rbuf.get_slice(peer), count, MPI_CHAR, peer, tag, comm, req);
+            });
+        }
+        else {
+            for (int i=0; i<size && MPI_SUCCESS == ret; i++) {
+                if (sched.RecvsFrom(i)) {
+                    senders[i] = i;
+                    ret = MPI_Irecv (rbuf.get_slice(i), count, MPI_CHAR, i, tag, comm, &reqs[nreqs++]);
+                }
+                if (sched.SendsTo(i) && MPI_SUCCESS == ret) {
+                    ret = MPI_Isend (sbuf.get_slice(i), count, MPI_CHAR, i, tag, comm, &reqs[nreqs++]);
+                }
+            }
+            if (MPI_SUCCESS == ret) {
+                ret = MPI_Waitall (nreqs, reqs, MPI_STATUSES_IGNORE);
+                (*nwaits)++;
+            }
+        }
+        *bytes += (double)sched.get_nsend() * count;
+    }
+    te = std::chrono::high_resolution_clock::now();
+    *time = std::chrono::duration<double>(te-ts).count();
+    if (depth > 0) {
+        *nwaits = window.GetNumWaits();
+    }
+    return ret;
+}
+
+int main (int argc, char *argv[])
+{
+    int ret = MPI_SUCCESS;
+    int rank, size, maxdepth, ndepths;
+    int depths[MAX_DEPTHS];
+    bool fret=true;
+    hip_mpitest_peer_buffer<char> sbuf, rbuf;
+    hip_mpitest_schedule sched;
+    MPI_Request *reqs=NULL;
+    int *senders=NULL;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    ret = sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL);
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+    // an exchange has 2*size operations, a larger window can not hold more
+    maxdepth = hip_mpitest_window_depth > 0 && hip_mpitest_window_depth < 2 * size ?
+               hip_mpitest_window_depth : 2 * size;
+    ndepths  = get_depths (maxdepth, depths);
+    reqs  = (MPI_Request *) malloc (2 * size * sizeof(MPI_Request));
+    senders = (int *) malloc (size * sizeof(int));
+    if (NULL == reqs || NULL == senders) {
+        fprintf(stderr, "Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+
+    if (rank == 0 ) {
+        printf("Benchmark: %s %c %c - %d processes, pattern %s, windows of up to %d requests\n\n",
+               argv[0], sendbuf->get_memchar(), recvbuf->get_memchar(), size,
+               hip_mpitest_pattern_names[sched.get_pattern()], maxdepth);
+        printf("Time per exchange in usec, throughput in MB/s, waits being the average number of\n"
+               "MPI_Waitsome (or MPI_Waitall) calls per exchange and process\n");
+        printf("msg. length \t window \t time \t\t throughput \t waits \t\t result\n");
+        printf("=================================================================================================\n");
+    }
+
+    for (long count=1; count<=elements; count *=2 ) {
+        int niter = count >= NITER_THRESH ? NITER_LONG : NITER_SHORT;
+
+        if (sbuf.Allocate(sendbuf, size, count, hip_mpitest_layout) != hipSuccess ||
+            sbuf.Generate([rank, count](char *b, long first, long n) {
+                              bench_init_sendbuf(b, first, n, count, rank); }) != hipSuccess ||
+            rbuf.Allocate(recvbuf, size, count, hip_mpitest_layout) != hipSuccess) {
+            fprintf(stderr, "Could not allocate buffers. Aborting\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+
+        for (int k=0; k<ndepths; k++) {
+            int d = depths[k];
+            double t, tmax, bytes, bytesum;
+            long nwaits, waitsum;
+            int pret, gret;
+            bool res;
+
+            if (rbuf.Generate(bench_init_recvbuf) != hipSuccess) {
+                ret = MPI_ERR_OTHER;
+                goto out;
+            }
+            for (int i=0; i<size; i++) {
+                senders[i] = -1;
+            }
+            ret = window_test (d, sbuf, rbuf, count, niter, sched, senders, reqs, MPI_COMM_WORLD,
+                               &t, &bytes, &nwaits);
+            if (MPI_SUCCESS != ret) {
+                fprintf(stderr, "Error in window_test. Aborting\n");
+                goto out;
+            }
+            res = rbuf.Verify([count, senders](const char *b, long first, long n) {
+                                  return bench_check_recvbuf(b, first, n, count, count,
+                                                             senders); });
+            pret = res ? 1 : 0;
+
+            MPI_Reduce(&t, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&bytes, &bytesum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&nwaits, &waitsum, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Allreduce(&pret, &gret, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+            if (rank == 0) {
+                char wname[16];
+                if (d > 0) {
+                    snprintf(wname, sizeof(wname), "%d", d);
+                }
+                else {
+                    snprintf(wname, sizeof(wname), "all");
+                }
+                printf("%10ld \t %6s \t %lf \t %lf \t %8.1lf \t %s\n", count, wname,
+                       tmax / niter * 1e6, bytesum / tmax / (1024 * 1024),
+                       (double)waitsum / size / niter, gret != 0 ? "SUCCESS" : "FAILED");
+            }
+            fret &= (gret != 0);
+        }
+    }
+
+ out:
+    sbuf.Free();
+    rbuf.Free();
+    free (reqs);
+    free (senders);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#!/bin/bash
+###############################################################################
+# Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to
+# deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+###############################################################################
+
+# Runs the multi-peer tests with the slab, per-peer and region buffer
+# layouts for an increasing number of processes, and reports the time of
+# the first operation, which includes registering the buffers, and of
+# subsequent operations.
+#
+# Usage: run_layout_sweep.sh <elements> [memtypes] [process counts]
+
+OPTIONS="--mca pml ucx --mca osc ucx"
+LAYOUTS="slab per-peer region"
+TESTS="hip_pt2pt_nb hip_alltoall hip_allgather"
+
+NUMELEMS=${1:-1048576}
+MEMTYPES=${2:-"H D"}
+NPROCS=${3:-"2 4 8 16"}
+
+printf "%-16s %-8s %6s %-10s %18s %18s\n" "test" "memtype" "procs" "layout" "first op. (usec)" "later ops. (usec)"
+for TEST in $TESTS ; do
+    for MEM in $MEMTYPES ; do
+	for NP in $NPROCS ; do
+	    for LAYOUT in $LAYOUTS ; do
+		mpirun $OPTIONS -np $NP ../src/$TEST -s $MEM -r $MEM -n $NUMELEMS --layout $LAYOUT | \
+		    awk -v test=$TEST -v mem=$MEM -v np=$NP -v layout=$LAYOUT \
+			'/Layout/ {printf("%-16s %-8s %6d %-10s %18.2f %18.2f\n", test, mem, np, layout, $8, $12)}'
+	    done
+	done
+    done
+done
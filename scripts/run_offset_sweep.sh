@@ -0,0 +1,56 @@
+#!/bin/bash
+###############################################################################
+# Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to
+# deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+###############################################################################
+
+# Runs a benchmark with send and receive buffers starting at increasing
+# offsets from a page aligned address, and reports the bandwidth of every
+# message size relative to the aligned buffers.
+#
+# Usage: run_offset_sweep.sh <benchmark> <nprocs> <elements> [memtypes]
+
+OPTIONS="--mca pml ucx --mca osc ucx"
+OFFSETS="0 1 2 4 8 16 32 63 64 128 256 512 1024 2048 4095 4096"
+ALIGN=4096
+
+BENCH=${1:-hip_alltoall_bench}
+NPROCS=${2:-2}
+NUMELEMS=${3:-1048576}
+MEMTYPES=${4:-"H D"}
+
+for MEM in $MEMTYPES ; do
+    for OFFSET in $OFFSETS ; do
+	mpirun $OPTIONS -np $NPROCS ../benchmarks/$BENCH -s $MEM -r $MEM -n $NUMELEMS \
+	       --align $ALIGN --send-offset $OFFSET --recv-offset $OFFSET | \
+	    awk -v mem=$MEM -v off=$OFFSET '$5 == "SUCCESS" || $5 == "FAILED" {print mem, off, $2, $3}'
+    done
+done | awk '
+    BEGIN {
+        printf("%-8s %8s %12s %14s %10s\n", "memtype", "offset", "msg. length", "bandwidth MB/s", "penalty")
+    }
+    {
+        bw = $4 > 0 ? $3 / $4 / 1e6 : 0
+        if ($2 == 0) {
+            base[$1, $3] = bw
+        }
+        penalty = base[$1, $3] > 0 ? 100.0 * (1.0 - bw / base[$1, $3]) : 0
+        printf("%-8s %8d %12d %14.2f %9.1f%%\n", $1, $2, $3, bw, penalty)
+    }'
@@ -46,26 +46,26 @@ let SUCCESS=0
 let FAILED=0
 
 echo "RNDV_SCHEME=put_zcopy"
-ExecTest "hip_pt2pt_nb"           "2" "1048576" "D H M O R" "put_zcopy"
-ExecTest "hip_type_struct_long"   "2" "32"      "D H M O R" "put_zcopy"
-ExecTest "hip_osc_put_fence"      "2" "1048576" "D H" "put_zcopy"
-ExecTest "hip_osc_get_fence"      "2" "1048576" "D H" "put_zcopy"
+ExecTest "hip_pt2pt_nb"           "2" "1048576" "D A H M O R" "put_zcopy"
+ExecTest "hip_type_struct_long"   "2" "32"      "D A H M O R" "put_zcopy"
+ExecTest "hip_osc_put_fence"      "2" "1048576" "D A H" "put_zcopy"
+ExecTest "hip_osc_get_fence"      "2" "1048576" "D A H" "put_zcopy"
 
 echo "RNDV_SCHEME=get_zcopy"
-ExecTest "hip_pt2pt_nb"           "2" "1048576" "D H M O R" "get_zcopy"
-ExecTest "hip_type_struct_long"   "2" "32"      "D H M O R" "get_zcopy"
-ExecTest "hip_osc_put_fence"      "2" "1048576" "D H" "get_zcopy"
-ExecTest "hip_osc_get_fence"      "2" "1048576" "D H" "get_zcopy"
+ExecTest "hip_pt2pt_nb"           "2" "1048576" "D A H M O R" "get_zcopy"
+ExecTest "hip_type_struct_long"   "2" "32"      "D A H M O R" "get_zcopy"
+ExecTest "hip_osc_put_fence"      "2" "1048576" "D A H" "get_zcopy"
+ExecTest "hip_osc_get_fence"      "2" "1048576" "D A H" "get_zcopy"
 
 echo "RNDV_SCHEME=put_ppln"
-ExecTest "hip_pt2pt_nb"           "2" "1048576" "D H M O R" "put_ppln"
-ExecTest "hip_type_struct_long"   "2" "32"      "D H M O R" "put_ppln"
-ExecTest "hip_osc_put_fence"      "2" "1048576" "D H" "put_ppln"
-ExecTest "hip_osc_get_fence"      "2" "1048576" "D H" "put_ppln"
+ExecTest "hip_pt2pt_nb"           "2" "1048576" "D A H M O R" "put_ppln"
+ExecTest "hip_type_struct_long"   "2" "32"      "D A H M O R" "put_ppln"
+ExecTest "hip_osc_put_fence"      "2" "1048576" "D A H" "put_ppln"
+ExecTest "hip_osc_get_fence"      "2" "1048576" "D A H" "put_ppln"
 
 echo "RNDV_SCHEME=get_ppln"
-ExecTest "hip_pt2pt_nb"           "2" "1048576" "D H M O R" "get_ppln"
-ExecTest "hip_type_struct_long"   "2" "32"      "D H M O R" "get_ppln"
-ExecTest "hip_osc_put_fence"      "2" "1048576" "D H" "get_ppln"
-ExecTest "hip_osc_get_fence"      "2" "1048576" "D H" "get_ppln"
+ExecTest "hip_pt2pt_nb"           "2" "1048576" "D A H M O R" "get_ppln"
+ExecTest "hip_type_struct_long"   "2" "32"      "D A H M O R" "get_ppln"
+ExecTest "hip_osc_put_fence"      "2" "1048576" "D A H" "get_ppln"
+ExecTest "hip_osc_get_fence"      "2" "1048576" "D A H" "get_ppln"
 printf "\n Executed %d Tests (%d passed %d failed)\n" $COUNTER $SUCCESS $FAILED
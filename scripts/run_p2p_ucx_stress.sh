@@ -46,27 +46,27 @@ let SUCCESS=0
 let FAILED=0
 
 echo "RNDV_SCHEME=am"
-ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D H M O R" "am"
-ExecTest "hip_sendtoself_stress"  "1" "10485760" "D H M O R" "am"
+ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D A H M O R" "am"
+ExecTest "hip_sendtoself_stress"  "1" "10485760" "D A H M O R" "am"
 
 echo "RNDV_SCHEME=rkey_ptr"
-ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D H M O R" "rkey_ptr"
-ExecTest "hip_sendtoself_stress"  "1" "10485760" "D H M O R" "am"
+ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D A H M O R" "rkey_ptr"
+ExecTest "hip_sendtoself_stress"  "1" "10485760" "D A H M O R" "am"
 
 echo "RNDV_SCHEME=put_zcopy"
-ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D H M O R" "put_zcopy"
-ExecTest "hip_sendtoself_stress"  "1" "10485760" "D H M O R" "am"
+ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D A H M O R" "put_zcopy"
+ExecTest "hip_sendtoself_stress"  "1" "10485760" "D A H M O R" "am"
 
 echo "RNDV_SCHEME=get_zcopy"
-ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D H M O R" "get_zcopy"
-ExecTest "hip_sendtoself_stress"  "1" "10485760" "D H M O R" "am"
+ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D A H M O R" "get_zcopy"
+ExecTest "hip_sendtoself_stress"  "1" "10485760" "D A H M O R" "am"
 
 echo "RNDV_SCHEME=put_ppln"
-ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D H M O R" "put_ppln"
-ExecTest "hip_sendtoself_stress"  "1" "10485760" "D H M O R" "am"
+ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D A H M O R" "put_ppln"
+ExecTest "hip_sendtoself_stress"  "1" "10485760" "D A H M O R" "am"
 
 echo "RNDV_SCHEME=get_ppln"
-ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D H M O R" "get_ppln"
-ExecTest "hip_sendtoself_stress"  "1" "10485760" "D H M O R" "am"
+ExecTest "hip_pt2pt_nb_stress"    "2" "10485760" "D A H M O R" "get_ppln"
+ExecTest "hip_sendtoself_stress"  "1" "10485760" "D A H M O R" "am"
 
 printf "\n Executed %d Tests (%d passed %d failed)\n" $COUNTER $SUCCESS $FAILED
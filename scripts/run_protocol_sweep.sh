@@ -0,0 +1,42 @@
+#!/bin/bash
+###############################################################################
+# Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to
+# deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# Runs the protocol analysis of the point-to-point benchmark for every
+# pair of send and receive memory types, and lists the detected switch
+# points together with the cost per byte of the regimes they separate.
+#
+# Usage: run_protocol_sweep.sh <max. message length> [memtypes] [steps]
+
+OPTIONS="--mca pml ucx --mca osc ucx"
+
+MAXLEN=${1:-16M}
+MEMTYPES=${2:-"D H"}
+STEPS=${3:-8}
+
+for SMEM in $MEMTYPES ; do
+    for RMEM in $MEMTYPES ; do
+	echo "Sendbuf $SMEM Recvbuf $RMEM"
+	mpirun $OPTIONS -np 2 ../benchmarks/hip_pt2pt_bench -s $SMEM -r $RMEM -n $MAXLEN --protocol-fit $STEPS | \
+	    awk '/^Detected/,0'
+	echo ""
+    done
+done
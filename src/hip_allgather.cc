@@ -29,49 +29,53 @@
 
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_layout.h"
 
 #define NITER 25
-int elements=100;
+long elements=100;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (double *sendbuf, int count, int mynode)
+static void init_sendbuf (double *sendbuf, long first, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = (double)mynode;
     }
 }
 
-static void init_recvbuf (double *recvbuf, int count)
+static void init_recvbuf (double *recvbuf, long first, long count)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0.0;
     }
 }
 
-static bool check_recvbuf(double *recvbuf, int nprocs, int rank, int count)
+// Checks elements [first, first+n) of the receive buffer, which holds
+// count elements from every process
+static bool check_recvbuf(const double *recvbuf, long first, long n, int count)
 {
     bool res=true;
-    int l=0;
 
-    for (int j=0; j<nprocs; j++) {
-        double result = (double)j;
-        for (int i=0; i<count; i++, l++) {
-            if (recvbuf[l] != result) {
-                res = false;
+    for (long l=0; l<n; l++) {
+        double result = (double)((first + l) / count);
+        if (recvbuf[l] != result) {
+            res = false;
 #ifdef VERBOSE
-                printf("recvbuf[%d] = %d\n", i, recvbuf[l]);
+            printf("recvbuf[%ld] = %lf\n", first + l, recvbuf[l]);
 #endif
-                break;
-            }
+            break;
         }
     }
 
     return res;
 }
 
-int allgather_test (void *sendbuf, void *recvbuf, int count,
-                    MPI_Datatype datatype, MPI_Comm comm,
+// stype and rtypes describe the send buffer and the slice of each process
+// in the receive buffer by their absolute address in layouts other than
+// slab, NULL otherwise. The slab layout uses them as well when layouts are
+// compared, such that all layouts run the same MPI_Alltoallw.
+int allgather_test (void *sendbuf, void *recvbuf, MPI_Datatype *stype, MPI_Datatype *rtypes,
+                    int count, MPI_Datatype datatype, MPI_Comm comm,
                     int niterations);
 
 int main (int argc, char *argv[])
@@ -79,8 +83,10 @@ int main (int argc, char *argv[])
     int ret;
     int rank, size;
     int root = 0;
-    double t1;
+    double t1, tfirst;
     std::chrono::high_resolution_clock::time_point t1s, t1e;
+    hip_mpitest_peer_buffer<double> sbuf, rbuf;
+    MPI_Datatype *stype=NULL, *rtypes=NULL;
 
     bind_device();
 
@@ -90,61 +96,91 @@ int main (int argc, char *argv[])
 
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    double *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
-
     // Initialise send buffer
-    ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, double, size*elements, sizeof(double),
-                        rank, MPI_COMM_WORLD, init_sendbuf, out);
+    if (sbuf.Allocate(sendbuf, 1, elements, hip_mpitest_layout) != hipSuccess ||
+        sbuf.Generate([rank](double *buf, long first, long n) {
+                          init_sendbuf(buf, first, n, rank); }) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    report_buffertype(MPI_COMM_WORLD, "Sendbuf", sendbuf);
 
     // Initialize recv buffer
-    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, double, size*elements, sizeof(double),
-                        rank, MPI_COMM_WORLD, init_recvbuf, out);
+    if (rbuf.Allocate(recvbuf, size, elements, hip_mpitest_layout) != hipSuccess ||
+        rbuf.Generate(init_recvbuf) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    report_buffertype(MPI_COMM_WORLD, "Recvbuf", recvbuf);
+
+    if (HIP_MPITEST_LAYOUT_SLAB != hip_mpitest_layout || hip_mpitest_layout_report) {
+        stype = (MPI_Datatype *) malloc ((size + 1) * sizeof(MPI_Datatype));
+        if (NULL == stype) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        rtypes = stype + 1;
+        for (int i=0; i<size+1; i++) {
+            stype[i] = MPI_DATATYPE_NULL;
+        }
+        ret = sbuf.CreateTypes(MPI_DOUBLE, stype);
+        if (MPI_SUCCESS == ret) {
+            ret = rbuf.CreateTypes(MPI_DOUBLE, rtypes);
+        }
+        if (MPI_SUCCESS != ret) {
+            goto out;
+        }
+    }
 
     //Warmup
-    ret = allgather_test (sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
+    t1s = std::chrono::high_resolution_clock::now();
+    hip_mpitest_pagefaults_begin();
+    ret = allgather_test (sbuf.get_slice(0), rbuf.get_slice(0), stype, rtypes, elements,
                           MPI_DOUBLE, MPI_COMM_WORLD, 1);
     if (MPI_SUCCESS != ret) {
         fprintf(stderr, "Error in allgather_test. Aborting\n");
         goto out;
     }
+    hip_mpitest_pagefaults_end();
+    t1e = std::chrono::high_resolution_clock::now();
+    tfirst = std::chrono::duration<double>(t1e-t1s).count();
 
     // execute the allreduce test
     MPI_Barrier(MPI_COMM_WORLD);
     t1s = std::chrono::high_resolution_clock::now();
-    ret = allgather_test (sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
+    hip_mpitest_pagefaults_begin();
+    ret = allgather_test (sbuf.get_slice(0), rbuf.get_slice(0), stype, rtypes, elements,
                           MPI_DOUBLE, MPI_COMM_WORLD, NITER);
     if (MPI_SUCCESS != ret) {
         fprintf(stderr, "Error in allgather_test. Aborting\n");
         goto out;
     }
+    hip_mpitest_pagefaults_end();
     t1e = std::chrono::high_resolution_clock::now();
     t1 = std::chrono::duration<double>(t1e-t1s).count();
 
     // verify results
     bool res, fret;
     res = true;
-    if (recvbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*size*sizeof(double)));
-#if defined HIP_MPITEST_GATHER || defined HIP_MPITEST_GATHERV
-        if (rank == 0)
-#endif
-        res = check_recvbuf(tmp_recvbuf, size, rank, elements);
-    }
-    else {
 #if defined HIP_MPITEST_GATHER || defined HIP_MPITEST_GATHERV
-        if (rank == 0)
+    if (rank == 0)
 #endif
-        res = check_recvbuf((double*) recvbuf->get_buffer(), size, rank, elements);
-    }
+    res = rbuf.Verify([](const double *buf, long first, long n) {
+                          return check_recvbuf(buf, first, n, elements); });
 
     fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
     report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
                         elements, (size_t)(elements * sizeof(double)), NITER, t1);
+    hip_mpitest_layout_report_time (MPI_COMM_WORLD, size, tfirst, t1/NITER);
 
  out:
     //Free buffers
-    FREE_BUFFER(sendbuf, tmp_sendbuf);
-    FREE_BUFFER(recvbuf, tmp_recvbuf);
+    if (NULL != stype) {
+        hip_mpitest_free_types (stype, size+1);
+        free (stype);
+    }
+    HIP_CHECK(sbuf.Free());
+    HIP_CHECK(rbuf.Free());
     delete (sendbuf);
     delete (recvbuf);
 
@@ -158,54 +194,89 @@ int main (int argc, char *argv[])
 }
 
 
-int allgather_test (void *sendbuf, void *recvbuf, int count,
-                    MPI_Datatype datatype, MPI_Comm comm,
+int allgather_test (void *sendbuf, void *recvbuf, MPI_Datatype *stype, MPI_Datatype *rtypes,
+                    int count, MPI_Datatype datatype, MPI_Comm comm,
                     int niterations)
 {
     int ret;
-#if defined HIP_MPITEST_ALLGATHERV || defined HIP_MPITEST_GATHERV
     int *rcounts = NULL, *rdispls = NULL;
-    int size;
+    int *scounts = NULL;
+    MPI_Datatype *stypes = NULL;
+    int size, rank;
 
     MPI_Comm_size (comm, &size);
+    MPI_Comm_rank (comm, &rank);
 
-    rcounts = (int*)malloc(size *sizeof(int));
-    if (NULL == rcounts) {
-        printf("(All)gatherv test: Could not allocate memory\n");
-        return MPI_ERR_OTHER;
-    }
-    rdispls = (int*)malloc(size *sizeof(int));
-    if (NULL == rdispls) {
-        printf("(All)gatherv test: Could not allocate memory\n");
-        ret = MPI_ERR_OTHER;
-        goto out;
+    if (NULL != stype) {
+        // Expressed as an alltoallw, in which every process sends its
+        // buffer to all processes, respectively to the root only for gather
+        scounts = (int*)malloc(size *sizeof(int));
+        rcounts = (int*)malloc(size *sizeof(int));
+        rdispls = (int*)malloc(size *sizeof(int));
+        stypes  = (MPI_Datatype*)malloc(size *sizeof(MPI_Datatype));
+        if (NULL == scounts || NULL == rcounts || NULL == rdispls || NULL == stypes) {
+            printf("(All)gather test: Could not allocate memory\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        for (int i=0; i<size; i++) {
+#if defined HIP_MPITEST_GATHER || defined HIP_MPITEST_GATHERV
+            scounts[i] = (i == 0) ? 1 : 0;
+            rcounts[i] = (rank == 0) ? 1 : 0;
+#else
+            scounts[i] = 1;
+            rcounts[i] = 1;
+#endif
+            rdispls[i] = 0;
+            stypes[i]  = *stype;
+        }
     }
+#if defined HIP_MPITEST_ALLGATHERV || defined HIP_MPITEST_GATHERV
+    else {
+        rcounts = (int*)malloc(size *sizeof(int));
+        if (NULL == rcounts) {
+            printf("(All)gatherv test: Could not allocate memory\n");
+            return MPI_ERR_OTHER;
+        }
+        rdispls = (int*)malloc(size *sizeof(int));
+        if (NULL == rdispls) {
+            printf("(All)gatherv test: Could not allocate memory\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
 
-    for (int i=0; i<size; i++) {
-        rcounts[i]=count;
-        rdispls[i]=i*count;
+        for (int i=0; i<size; i++) {
+            rcounts[i]=count;
+            rdispls[i]=i*count;
+        }
     }
 #endif
 
     for (int i=0; i<niterations; i++) {
+        if (NULL != stype) {
+            ret = MPI_Alltoallw (MPI_BOTTOM, scounts, rdispls, stypes,
+                                 MPI_BOTTOM, rcounts, rdispls, rtypes, comm);
+        }
+        else {
 #if defined HIP_MPITEST_GATHER
-        ret = MPI_Gather (sendbuf, count, datatype, recvbuf, count, datatype, 0, comm);
+            ret = MPI_Gather (sendbuf, count, datatype, recvbuf, count, datatype, 0, comm);
 #elif defined HIP_MPITEST_GATHERV
-        ret = MPI_Gatherv (sendbuf, count, datatype, recvbuf, rcounts, rdispls, datatype, 0, comm);
+            ret = MPI_Gatherv (sendbuf, count, datatype, recvbuf, rcounts, rdispls, datatype, 0, comm);
 #elif defined HIP_MPITEST_ALLGATHERV
-        ret = MPI_Allgatherv (sendbuf, count, datatype, recvbuf, rcounts, rdispls, datatype, comm);
+            ret = MPI_Allgatherv (sendbuf, count, datatype, recvbuf, rcounts, rdispls, datatype, comm);
 #else
-        ret = MPI_Allgather (sendbuf, count, datatype, recvbuf, count, datatype, comm);
+            ret = MPI_Allgather (sendbuf, count, datatype, recvbuf, count, datatype, comm);
 #endif
+        }
         if (MPI_SUCCESS != ret) {
             goto out;
         }
     }
 
  out:
-#if defined HIP_MPITEST_ALLGATHERV || defined HIP_MPITEST_GATHERV
+    free (scounts);
     free (rcounts);
     free (rdispls);
-#endif
+    free (stypes);
     return ret;
 }
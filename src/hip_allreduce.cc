@@ -31,35 +31,35 @@
 #include "hip_mpitest_buffer.h"
 
 #define NITER 25
-int elements=100;
+long elements=100;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (double *sendbuf, int count, int mynode)
+static void init_sendbuf (double *sendbuf, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = (double)mynode;
     }
 }
 
-static void init_recvbuf (double *recvbuf, int count)
+static void init_recvbuf (double *recvbuf, long count)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0.0;
     }
 }
 
-static bool check_recvbuf(double *recvbuf, int nprocs, int rank, int count)
+static bool check_recvbuf(double *recvbuf, int nprocs, int rank, long count)
 {
     bool res=true;
     int expected = nprocs * (nprocs -1) / 2;
     double result = (double) expected;
 
-    for (int i=0; i<count; i++) {
+    for (long i=0; i<count; i++) {
         if (recvbuf[i] != result) {
             res = false;
 #ifdef VERBOSE
-            printf("recvbuf[%d] = %d\n", i, recvbuf[i]);
+            printf("recvbuf[%ld] = %lf\n", i, recvbuf[i]);
 #endif
         }
     }
@@ -67,7 +67,7 @@ static bool check_recvbuf(double *recvbuf, int nprocs, int rank, int count)
     return res;
 }
 
-int allreduce_test (void *sendbuf, void *recvbuf, int count,
+int allreduce_test (void *sendbuf, void *recvbuf, long count,
                     MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
                     int niterations);
 
@@ -85,6 +85,7 @@ int main (int argc, char *argv[])
     MPI_Comm_size (MPI_COMM_WORLD, &size);
     MPI_Comm_rank (MPI_COMM_WORLD, &rank);
 
+    hip_mpitest_max_elements = LONG_MAX;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
     double *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
@@ -155,7 +156,7 @@ int main (int argc, char *argv[])
 }
 
 
-int allreduce_test ( void *sendbuf, void *recvbuf, int count,
+int allreduce_test ( void *sendbuf, void *recvbuf, long count,
                      MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
                      int niterations)
 {
@@ -163,9 +164,9 @@ int allreduce_test ( void *sendbuf, void *recvbuf, int count,
 
     for (int i=0; i<niterations; i++) {
 #ifdef HIP_MPITEST_REDUCE
-        ret = MPI_Reduce (sendbuf, recvbuf, count, datatype, op, 0, comm);
+        ret = hip_mpitest_reduce (sendbuf, recvbuf, count, datatype, op, 0, comm);
 #else
-        ret = MPI_Allreduce (sendbuf, recvbuf, count, datatype, op, comm);
+        ret = hip_mpitest_allreduce (sendbuf, recvbuf, count, datatype, op, comm);
 #endif
         if (MPI_SUCCESS != ret) {
             return ret;
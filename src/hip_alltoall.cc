@@ -29,56 +29,62 @@
 
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_layout.h"
 
 #define NITER 25
-int elements=100;
+long elements=100;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (double *sendbuf, int count, int mynode)
+static void init_sendbuf (double *sendbuf, long first, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = (double)mynode;
     }
 }
 
-static void init_recvbuf (double *recvbuf, int count)
+static void init_recvbuf (double *recvbuf, long first, long count)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0.0;
     }
 }
 
-static bool check_recvbuf(double *recvbuf, int nprocs, int rank, int count)
+// Checks elements [first, first+n) of the receive buffer, which holds
+// count elements from every process
+static bool check_recvbuf(const double *recvbuf, long first, long n, int count)
 {
     bool res=true;
-    int l=0;
 
-    for (int j=0; j<nprocs; j++) {
-        double result = (double)j;
-        for (int i=0; i<count; i++, l++) {
-            if (recvbuf[l] != result) {
-                res = false;
+    for (long l=0; l<n; l++) {
+        double result = (double)((first + l) / count);
+        if (recvbuf[l] != result) {
+            res = false;
 #ifdef VERBOSE
-                printf("recvbuf[%d] = %d\n", i, recvbuf[l]);
+            printf("recvbuf[%ld] = %lf\n", first + l, recvbuf[l]);
 #endif
-            }
         }
     }
 
     return res;
 }
 
-int alltoall_test (void *sendbuf, void *recvbuf, int count,
-                   MPI_Datatype datatype, MPI_Comm comm,
+// stypes and rtypes describe the slice of each process by its absolute
+// address in layouts other than slab, NULL otherwise. The slab layout uses
+// them as well when layouts are compared, such that all layouts run the
+// same MPI_Alltoallw.
+int alltoall_test (void *sendbuf, void *recvbuf, MPI_Datatype *stypes, MPI_Datatype *rtypes,
+                   int count, MPI_Datatype datatype, MPI_Comm comm,
                    int niterations);
 
 int main (int argc, char *argv[])
 {
     int ret;
     int rank, size;
-    double t1;
+    double t1, tfirst;
     std::chrono::high_resolution_clock::time_point t1s, t1e;
+    hip_mpitest_peer_buffer<double> sbuf, rbuf;
+    MPI_Datatype *stypes=NULL, *rtypes=NULL;
 
     bind_device();
 
@@ -88,55 +94,87 @@ int main (int argc, char *argv[])
 
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    double *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
-
     // Initialise send buffer
-    ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, double, size*elements, sizeof(double),
-                        rank, MPI_COMM_WORLD, init_sendbuf, out);
+    if (sbuf.Allocate(sendbuf, size, elements, hip_mpitest_layout) != hipSuccess ||
+        sbuf.Generate([rank](double *buf, long first, long n) {
+                          init_sendbuf(buf, first, n, rank); }) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    report_buffertype(MPI_COMM_WORLD, "Sendbuf", sendbuf);
 
     // Initialize recv buffer
-    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, double, size*elements, sizeof(double),
-                        rank, MPI_COMM_WORLD, init_recvbuf, out);
+    if (rbuf.Allocate(recvbuf, size, elements, hip_mpitest_layout) != hipSuccess ||
+        rbuf.Generate(init_recvbuf) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    report_buffertype(MPI_COMM_WORLD, "Recvbuf", recvbuf);
+
+    if (HIP_MPITEST_LAYOUT_SLAB != hip_mpitest_layout || hip_mpitest_layout_report) {
+        stypes = (MPI_Datatype *) malloc (2 * size * sizeof(MPI_Datatype));
+        if (NULL == stypes) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        rtypes = stypes + size;
+        for (int i=0; i<2*size; i++) {
+            stypes[i] = MPI_DATATYPE_NULL;
+        }
+        ret = sbuf.CreateTypes(MPI_DOUBLE, stypes);
+        if (MPI_SUCCESS == ret) {
+            ret = rbuf.CreateTypes(MPI_DOUBLE, rtypes);
+        }
+        if (MPI_SUCCESS != ret) {
+            goto out;
+        }
+    }
 
     //Warmup
-    ret = alltoall_test (sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
+    t1s = std::chrono::high_resolution_clock::now();
+    hip_mpitest_pagefaults_begin();
+    ret = alltoall_test (sbuf.get_slice(0), rbuf.get_slice(0), stypes, rtypes, elements,
                          MPI_DOUBLE, MPI_COMM_WORLD, 1);
     if (MPI_SUCCESS != ret) {
         fprintf(stderr, "Error in alltoall_test. Aborting\n");
         goto out;
     }
+    hip_mpitest_pagefaults_end();
+    t1e = std::chrono::high_resolution_clock::now();
+    tfirst = std::chrono::duration<double>(t1e-t1s).count();
 
     // execute the allreduce test
     MPI_Barrier(MPI_COMM_WORLD);
     t1s = std::chrono::high_resolution_clock::now();
-    ret = alltoall_test (sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
+    hip_mpitest_pagefaults_begin();
+    ret = alltoall_test (sbuf.get_slice(0), rbuf.get_slice(0), stypes, rtypes, elements,
                          MPI_DOUBLE, MPI_COMM_WORLD, NITER);
     if (MPI_SUCCESS != ret) {
         fprintf(stderr, "Error in alltoall_test. Aborting\n");
         goto out;
     }
+    hip_mpitest_pagefaults_end();
     t1e = std::chrono::high_resolution_clock::now();
     t1 = std::chrono::duration<double>(t1e-t1s).count();
 
     // verify results
     bool res, fret;
-    res = true;
-    if (recvbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*size*sizeof(double)));
-        res = check_recvbuf(tmp_recvbuf, size, rank, elements);
-    }
-    else {
-        res = check_recvbuf((double*) recvbuf->get_buffer(), size, rank, elements);
-    }
+    res = rbuf.Verify([](const double *buf, long first, long n) {
+                          return check_recvbuf(buf, first, n, elements); });
 
     fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
     report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
                         elements, (size_t)(elements * sizeof(double)), NITER, t1);
+    hip_mpitest_layout_report_time (MPI_COMM_WORLD, size, tfirst, t1/NITER);
 
  out:
     //Free buffers
-    FREE_BUFFER(sendbuf, tmp_sendbuf);
-    FREE_BUFFER(recvbuf, tmp_recvbuf);
+    if (NULL != stypes) {
+        hip_mpitest_free_types (stypes, 2*size);
+        free (stypes);
+    }
+    HIP_CHECK(sbuf.Free());
+    HIP_CHECK(rbuf.Free());
 
     delete (sendbuf);
     delete (recvbuf);
@@ -150,69 +188,67 @@ int main (int argc, char *argv[])
 }
 
 
-int alltoall_test ( void *sendbuf, void *recvbuf, int count,
-                    MPI_Datatype datatype, MPI_Comm comm,
+int alltoall_test ( void *sendbuf, void *recvbuf, MPI_Datatype *stypes, MPI_Datatype *rtypes,
+                    int count, MPI_Datatype datatype, MPI_Comm comm,
                     int niterations)
 {
     int ret;
-#ifdef HIP_MPITEST_ALLTOALLV
-    int *scounts, *rcounts;
-    int *sdispls, *rdispls;
+    int *counts = NULL, *displs = NULL;
     int size;
 
     MPI_Comm_size (comm, &size);
 
-    scounts = (int*)malloc(size *sizeof(int));
-    if (NULL==scounts) {
-        printf("Alltoallv test: Could not allocate memory\n");
-        return MPI_ERR_OTHER;
-    }
-    rcounts = (int*)malloc(size *sizeof(int));
-    if (NULL==rcounts) {
-        printf("Alltoallv test: Could not allocate memory\n");
-        ret = MPI_ERR_OTHER;
-        goto out;
-    }
-    sdispls = (int*)malloc(size *sizeof(int));
-    if (NULL==sdispls) {
-        printf("Alltoallv test: Could not allocate memory\n");
-        ret = MPI_ERR_OTHER;
-        goto out;
-    }
-    rdispls = (int*)malloc(size *sizeof(int));
-    if (NULL==rdispls) {
-        printf("Alltoallv test: Could not allocate memory\n");
-        ret = MPI_ERR_OTHER;
-        goto out;
+    if (NULL != stypes) {
+        // every slice is described by a single element of its datatype
+        counts = (int*)malloc(size *sizeof(int));
+        displs = (int*)malloc(size *sizeof(int));
+        if (NULL == counts || NULL == displs) {
+            printf("Alltoallw test: Could not allocate memory\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        for (int i=0; i<size; i++) {
+            counts[i] = 1;
+            displs[i] = 0;
+        }
     }
-
-    for (int i=0; i<size; i++) {
-        scounts[i]=count;
-        rcounts[i]=count;
-        sdispls[i]=i*count;
-        rdispls[i]=i*count;
+#ifdef HIP_MPITEST_ALLTOALLV
+    else {
+        counts = (int*)malloc(size *sizeof(int));
+        displs = (int*)malloc(size *sizeof(int));
+        if (NULL == counts || NULL == displs) {
+            printf("Alltoallv test: Could not allocate memory\n");
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        for (int i=0; i<size; i++) {
+            counts[i]=count;
+            displs[i]=i*count;
+        }
     }
 #endif
 
     for (int i=0; i<niterations; i++) {
+        if (NULL != stypes) {
+            ret = MPI_Alltoallw(MPI_BOTTOM, counts, displs, stypes,
+                                MPI_BOTTOM, counts, displs, rtypes, comm);
+        }
+        else {
 #ifdef HIP_MPITEST_ALLTOALLV
-        ret = MPI_Alltoallv(sendbuf, scounts, sdispls, datatype,
-                            recvbuf, rcounts, rdispls, datatype, comm);
+            ret = MPI_Alltoallv(sendbuf, counts, displs, datatype,
+                                recvbuf, counts, displs, datatype, comm);
 #else
-        ret = MPI_Alltoall(sendbuf, count, datatype, recvbuf, count, datatype, comm);
+            ret = MPI_Alltoall(sendbuf, count, datatype, recvbuf, count, datatype, comm);
 #endif
+        }
         if (MPI_SUCCESS != ret) {
             goto out;
         }
     }
 
  out:
-#ifdef HIP_MPITEST_ALLTOALLV
-    free (scounts);
-    free (rcounts);
-    free (sdispls);
-    free (rdispls);
-#endif
+    free (counts);
+    free (displs);
 
     return ret;
 }
@@ -30,21 +30,24 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_datatype.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_pattern.h"
 
 
 #define NITER 10
-int  elements=3;
+long elements=3;
 
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-int type_p2p_nb_test (void *sendbuf, void *recvbuf, int count,
-                      MPI_Datatype datatype, MPI_Comm comm, int niterations);
+int type_p2p_nb_test (void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+                      hip_mpitest_schedule &sched, MPI_Comm comm, int first, int niterations,
+                      int *recvfrom);
 
 int main (int argc, char *argv[])
 {
-    int ret, rank, size;
+    int ret, rank, size, recvfrom=-1;
     MPI_Comm comm = MPI_COMM_WORLD;
+    hip_mpitest_schedule sched;
     double t1;
     std::chrono::high_resolution_clock::time_point t1s, t1e;
 
@@ -59,6 +62,20 @@ int main (int argc, char *argv[])
     hip_mpitest_datatype *dat = new (TEST_DATATYPE);
     char *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
 
+    // A single receive buffer, hence at most one peer per iteration
+    ret = sched.Init(comm, HIP_MPITEST_PATTERN_RING);
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+    if (!hip_mpitest_pattern_single_peer(sched.get_pattern())) {
+        if (0 == rank) {
+            fprintf(stderr, "Pattern %s is not supported by this test, use ring, xor or random\n",
+                    hip_mpitest_pattern_names[sched.get_pattern()]);
+        }
+        ret = MPI_ERR_ARG;
+        goto out;
+    }
+
     // Initialise send buffer
     ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, char, elements, dat->get_extent(),
                         rank, comm, dat->init_sendbuf, out);
@@ -69,7 +86,7 @@ int main (int argc, char *argv[])
 
     //Warmup
     ret = type_p2p_nb_test (sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
-                            dat->get_mpi_type(), comm, 1);
+                            dat->get_mpi_type(), sched, comm, 0, 1, &recvfrom);
     if (MPI_SUCCESS != ret) {
         fprintf(stderr, "Error in type_p2p_test. Aborting\n");
         goto out;
@@ -79,7 +96,7 @@ int main (int argc, char *argv[])
     MPI_Barrier(comm);
     t1s = std::chrono::high_resolution_clock::now();
     ret = type_p2p_nb_test(sendbuf->get_buffer(), recvbuf->get_buffer(), elements,
-                           dat->get_mpi_type(), comm, NITER);
+                           dat->get_mpi_type(), sched, comm, 1, NITER, &recvfrom);
     if (MPI_SUCCESS != ret) {
         fprintf(stderr, "Error in type_p2p_test. Aborting\n");
         goto out;
@@ -87,15 +104,17 @@ int main (int argc, char *argv[])
     t1e = std::chrono::high_resolution_clock::now();
     t1 = std::chrono::duration<double>(t1e-t1s).count();
 
-    // verify results
+    // verify results against the data of the last process received from
     bool res, fret;
     res = true;
-    if (recvbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*dat->get_extent()));
-        res = dat->check_recvbuf(tmp_recvbuf, size, rank, elements);
-    }
-    else {
-        res = dat->check_recvbuf(recvbuf->get_buffer(), size, rank, elements);
+    if (recvfrom >= 0) {
+        if (recvbuf->NeedsStagingBuffer()) {
+            HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*dat->get_extent()));
+            res = dat->check_recvbuf(tmp_recvbuf, recvfrom, elements);
+        }
+        else {
+            res = dat->check_recvbuf(recvbuf->get_buffer(), recvfrom, elements);
+        }
     }
 
     fret = report_testresult(argv[0], comm, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
@@ -120,30 +139,36 @@ int main (int argc, char *argv[])
 }
 
 
-int type_p2p_nb_test ( void *sendbuf, void *recvbuf, int count,
-                       MPI_Datatype datatype, MPI_Comm comm, int niterations)
+// Iterations first .. first+niterations-1 of the schedule. recvfrom is
+// set to the process received from last.
+int type_p2p_nb_test ( void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+                       hip_mpitest_schedule &sched, MPI_Comm comm, int first, int niterations,
+                       int *recvfrom)
 {
-    int size, rank, ret;
+    int ret;
     int tag=251;
     MPI_Request reqs[2];
 
-    MPI_Comm_size (comm, &size);
-    MPI_Comm_rank (comm, &rank);
-
-    // send buffer to right, receive from left
-    int left = rank - 1;
-    if (left < 0) left = size-1;
-    int right = rank + 1;
-    if (right == size) right = 0;
-
+    // by default send buffer to right, receive from left
     for (int i=0; i<niterations; i++) {
-      ret = MPI_Irecv (recvbuf, count, datatype, left, tag, comm, &reqs[1]);
-      if (MPI_SUCCESS != ret) {
-	return ret;
+      int left, right;
+
+      sched.Generate(first + i);
+      left  = sched.get_recvpeer();
+      right = sched.get_sendpeer();
+      reqs[0] = reqs[1] = MPI_REQUEST_NULL;
+      if (left >= 0) {
+	ret = MPI_Irecv (recvbuf, count, datatype, left, tag, comm, &reqs[1]);
+	if (MPI_SUCCESS != ret) {
+	  return ret;
+	}
+	*recvfrom = left;
       }
-      ret = MPI_Isend (sendbuf, count, datatype, right, tag, comm, &reqs[0]);
-      if (MPI_SUCCESS != ret) {
-	return ret;
+      if (right >= 0) {
+	ret = MPI_Isend (sendbuf, count, datatype, right, tag, comm, &reqs[0]);
+	if (MPI_SUCCESS != ret) {
+	  return ret;
+	}
       }
       ret = MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
       if (MPI_SUCCESS != ret) {
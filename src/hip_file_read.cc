@@ -34,7 +34,7 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements=64*1024*1024;
+long elements=64*1024*1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
@@ -128,6 +128,10 @@ int main (int argc, char *argv[])
     }
 
     SL_write(fd, sendbuf->get_buffer(), elements*sizeof(long));
+    if (hip_mpitest_file_dropcache) {
+        // make sure the read operation is not served from the page cache
+        hip_mpitest_file_drop_cache(fd);
+    }
     close (fd);
     rename ("testout.out", "testin.in");
     MPI_Barrier(MPI_COMM_WORLD);
@@ -210,13 +214,11 @@ int file_read_test (void *recvbuf, int count, MPI_Datatype datatype, MPI_File fh
     }
 
     MPI_Waitall (NBLOCKS, req, MPI_STATUS_IGNORE);
-#else
-    ret = MPI_File_read (fh, recvbuf, count, datatype, MPI_STATUS_IGNORE);
-#endif
 
  out:
-#ifdef HIP_MPITEST_FILE_IREAD
     free (req);
+#else
+    ret = MPI_File_read (fh, recvbuf, count, datatype, MPI_STATUS_IGNORE);
 #endif
     return ret;
 }
@@ -34,7 +34,7 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements=64*1024*1024;
+long elements=64*1024*1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
@@ -45,14 +45,14 @@ static int nelem_per_dim;
 static void SL_write (int hdl, void *buf, size_t num);
 
 
-static void init_sendbuf (long *sendbuf, int count, int unused)
+static void init_sendbuf (long *sendbuf, long count, int unused)
 {
     for (long i = 0; i < count; i++) {
         sendbuf[i] = i+1;
     }
 }
 
-static void init_recvbuf (long *recvbuf, int count)
+static void init_recvbuf (long *recvbuf, long count)
 {
     for (long i = 0; i < count; i++) {
         recvbuf[i] = 0.0;
@@ -148,6 +148,10 @@ int main (int argc, char *argv[])
         }
 
         SL_write(fd, sendbuf->get_buffer(), elements*size*sizeof(long));
+        if (hip_mpitest_file_dropcache) {
+            // make sure the read operation is not served from the page cache
+            hip_mpitest_file_drop_cache(fd);
+        }
         close (fd);
         rename ("testout.out", "testin.in");
     }
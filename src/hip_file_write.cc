@@ -34,12 +34,10 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements=64*1024*1024;
+long elements=64*1024*1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void SL_read ( int hdl, void *buf, size_t num);
-
 static void init_sendbuf (long *sendbuf, int count, int unused)
 {
     for (long i = 0; i < count; i++) {
@@ -47,23 +45,18 @@ static void init_sendbuf (long *sendbuf, int count, int unused)
     }
 }
 
-static void init_recvbuf (long *recvbuf, int count)
-{
-    for (long i = 0; i < count; i++) {
-        recvbuf[i] = 0.0;
-    }
-}
-
-static bool check_recvbuf(long *recvbuf, int nprocs_unused, int rank_unused, int count)
+static bool check_recvbuf(void *rbuf, long first, long count)
 {
     bool res=true;
+    long *recvbuf = (long *)rbuf;
 
     for (long i=0; i<count; i++) {
-        if (recvbuf[i] != i+1) {
+        if (recvbuf[i] != first+i+1) {
             res = false;
 #ifdef VERBOSE
-            printf("recvbuf[%d] = %ld\n", i, recvbuf[i]);
+            printf("recvbuf[%ld] = %ld\n", first+i, recvbuf[i]);
 #endif
+            break;
         }
     }
 
@@ -99,15 +92,11 @@ int main (int argc, char *argv[])
 
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    long *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
+    long *tmp_sendbuf=NULL;
     // Initialise send buffer
     ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, long, elements, sizeof(long),
                         rank, MPI_COMM_WORLD, init_sendbuf, out);
 
-    // Initialize recv buffer
-    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, long, elements, sizeof(long),
-                        rank, MPI_COMM_WORLD, init_recvbuf, out);
-
     // execute file_write test
     MPI_File_open(MPI_COMM_SELF, "testout.out", MPI_MODE_CREATE|MPI_MODE_WRONLY,
                   MPI_INFO_NULL, &fh);
@@ -127,12 +116,11 @@ int main (int argc, char *argv[])
 
     // verify results
     bool res, fret;
-    res = true;
+    res = false;
     int fd;
     fd = open ("testout.out", O_RDONLY );
     if ( -1 != fd ) {
-        SL_read(fd, tmp_recvbuf, elements * sizeof(long));
-        res = check_recvbuf(tmp_recvbuf, size, rank, elements);
+        res = hip_mpitest_file_verify(fd, 0, elements, sizeof(long), check_recvbuf);
         close (fd);
     }
 
@@ -144,7 +132,6 @@ int main (int argc, char *argv[])
  out:
     //Free buffers
     FREE_BUFFER(sendbuf, tmp_sendbuf);
-    FREE_BUFFER(recvbuf, tmp_recvbuf);
 
     delete (sendbuf);
     delete (recvbuf);
@@ -185,47 +172,11 @@ int file_write_test (void *sendbuf, int count, MPI_Datatype datatype, MPI_File f
     }
 
     MPI_Waitall (NBLOCKS, req, MPI_STATUS_IGNORE);
-#else
-    ret = MPI_File_write (fh, sendbuf, count, datatype, MPI_STATUS_IGNORE);
-#endif
 
  out:
-#ifdef HIP_MPITEST_FILE_IWRITE
     free (req);
+#else
+    ret = MPI_File_write (fh, sendbuf, count, datatype, MPI_STATUS_IGNORE);
 #endif
     return ret;
 }
-
-void SL_read ( int hdl, void *buf, size_t num )
-{
-    int lcount=0;
-    int a;
-    char *wbuf = (char *)buf;
-    do {
-        a = read (hdl, wbuf, num);
-
-        if(0 == a && num > 0){
-            printf("\nSL_read: Warning: # Bytes read are less than "
-                   "expected file size %d %s\n", hdl, strerror(errno));
-            return;
-        }
-
-        if ( a == -1 ) {
-            if (errno == EINTR       || errno == EAGAIN     ||
-                errno == EINPROGRESS || errno == EWOULDBLOCK) {
-                continue;
-            } else {
-                printf("SL_read: error while reading from file %d %s\n", hdl, strerror(errno));
-                return;
-            }
-            lcount++;
-            a=0;
-        }
-
-        num -= a;
-        wbuf += a;
-
-    } while ( num > 0 &&  lcount < 20 );
-
-    return;
-}
@@ -34,7 +34,7 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements=64*1024*1024;
+long elements=64*1024*1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
@@ -42,36 +42,28 @@ static int coord[2];
 static int procs_per_dim;
 static int nelem_per_dim;
 
-static void SL_read ( int hdl, void *buf, size_t num);
-
 static void init_sendbuf (long *sendbuf, int count, int unused)
 {
     long c = 0;
     for (long i = 0; i < nelem_per_dim; i++) {
         for (long j = 0; j < nelem_per_dim; j++) {
-            sendbuf[c] = (coord[0] * procs_per_dim * nelem_per_dim * nelem_per_dim) +
-                         (coord[1] * nelem_per_dim) + (i*procs_per_dim * nelem_per_dim) + j+1;
+            sendbuf[c] = ((long)coord[0] * procs_per_dim * nelem_per_dim * nelem_per_dim) +
+                         ((long)coord[1] * nelem_per_dim) + (i*procs_per_dim * nelem_per_dim) + j+1;
             c++;
         }
     }
 }
 
-static void init_recvbuf (long *recvbuf, int count)
-{
-    for (long i = 0; i < count; i++) {
-        recvbuf[i] = 0.0;
-    }
-}
-
-static bool check_recvbuf(long *recvbuf, int nprocs, int rank_unused, int count)
+static bool check_recvbuf(void *rbuf, long first, long count)
 {
     bool res=true;
+    long *recvbuf = (long *)rbuf;
 
-    for (long i=0; i<count*nprocs; i++) {
-        if (recvbuf[i] != i+1) {
+    for (long i=0; i<count; i++) {
+        if (recvbuf[i] != first+i+1) {
             res = false;
 #ifdef VERBOSE
-            printf("recvbuf[%d] = %ld\n", i, recvbuf[i]);
+            printf("recvbuf[%ld] = %ld\n", first+i, recvbuf[i]);
 #endif
             break;
         }
@@ -116,17 +108,13 @@ int main (int argc, char *argv[])
     MPI_Cart_create(MPI_COMM_WORLD, 2, dim, period, reorder, &gridComm);
     MPI_Cart_coords(gridComm, rank, 2, coord);
 
-    long *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
+    long *tmp_sendbuf=NULL;
+    long rowlen;
+    int fd, lres;
     // Initialise send buffer
     ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, long, elements, sizeof(long),
                         rank, MPI_COMM_WORLD, init_sendbuf, out);
 
-    if (rank == 0) {
-        // Initialize recv buffer
-        ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, long, elements*size, sizeof(long),
-                            rank, MPI_COMM_WORLD, init_recvbuf, out);
-    }
-
     // open file and set file view
     MPI_Datatype fview;
     int startV[2];
@@ -167,18 +155,28 @@ int main (int argc, char *argv[])
     t1e = std::chrono::high_resolution_clock::now();
     t1 = std::chrono::duration<double>(t1e-t1s).count();
 
-    // verify results
+    // verify results. Every process checks only the part of the file
+    // that it has written, without reading it into memory as a whole.
+    // The individual results are combined across all processes.
     bool res, fret;
-    res = true;
-    if (rank == 0) {
-        int fd;
-        fd = open ("testout.out", O_RDONLY );
-        if ( -1 != fd ) {
-            SL_read(fd, tmp_recvbuf, elements * size * sizeof(long));
-            res = check_recvbuf(tmp_recvbuf, size, rank, elements);
-            close (fd);
+    res = false;
+    fd = open ("testout.out", O_RDONLY );
+    if ( -1 != fd ) {
+        rowlen = (long)procs_per_dim * nelem_per_dim;
+        res = true;
+        for (long i=0; i<nelem_per_dim && res; i++) {
+            long start = ((long)coord[0] * nelem_per_dim + i) * rowlen +
+                         (long)coord[1] * nelem_per_dim;
+            res = hip_mpitest_file_verify(fd, start, nelem_per_dim,
+                                          sizeof(long), check_recvbuf);
         }
     }
+    if ( -1 != fd ) {
+        close (fd);
+    }
+    lres = res == true ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &lres, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    res = (bool)lres;
 
     fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(),
                              '-', res);
@@ -189,10 +187,9 @@ int main (int argc, char *argv[])
     //Free buffers
     FREE_BUFFER(sendbuf, tmp_sendbuf);
     delete (sendbuf);
+    delete (recvbuf);
 
     if (rank == 0) {
-        FREE_BUFFER(recvbuf, tmp_recvbuf);
-        delete (recvbuf);
         unlink("testout.out");
     }
 
@@ -213,37 +210,3 @@ int file_write_all_test (void *sendbuf, int count, MPI_Datatype datatype, MPI_Fi
     ret = MPI_File_write_all (fh, sendbuf, count, datatype, MPI_STATUS_IGNORE);
     return ret;
 }
-
-void SL_read ( int hdl, void *buf, size_t num )
-{
-    int lcount=0;
-    int a;
-    char *wbuf = (char *)buf;
-    do {
-        a = read (hdl, wbuf, num);
-
-        if(0 == a && num > 0){
-            printf("\nSL_read: Warning: # Bytes read are less than "
-                   "expected file size %d %s\n", hdl, strerror(errno));
-            return;
-        }
-
-        if ( a == -1 ) {
-            if (errno == EINTR       || errno == EAGAIN     ||
-                errno == EINPROGRESS || errno == EWOULDBLOCK) {
-                continue;
-            } else {
-                printf("SL_read: error while reading from file %d %s\n", hdl, strerror(errno));
-                return;
-            }
-            lcount++;
-            a=0;
-        }
-
-        num -= a;
-        wbuf += a;
-
-    } while ( num > 0 &&  lcount < 20 );
-
-    return;
-}
@@ -31,7 +31,7 @@
 #include "hip_mpitest_buffer.h"
 
 #define NITER 25
-int elements=100;
+long elements=100;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
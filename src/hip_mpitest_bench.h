@@ -27,26 +27,176 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <chrono>
 
 #include "mpi.h"
+#include "hip_mpitest_utils.h"
 
+// Data of the point-to-point benchmarks. The buffers are divided into
+// slices of slice bytes, byte i of a slice sent by process mynode holds
+// (mynode + i) % 251. Bytes that were not received keep 0xff, which is
+// never generated.
+static inline void bench_init_sendbuf (char *sendbuf, long first, long count, long slice,
+                                       int mynode)
+{
+    for (long i = 0; i < count; i++) {
+        sendbuf[i] = (char)((mynode + (first + i) % slice) % 251);
+    }
+}
+
+static inline void bench_init_recvbuf (char *recvbuf, long first, long count)
+{
+    memset(recvbuf, 0xff, count);
+}
+
+// Slice s holds the first len bytes of the data of process senders[s],
+// or no data if senders[s] is negative
+static inline bool bench_check_recvbuf (const char *recvbuf, long first, long count, long slice,
+                                        long len, const int *senders)
+{
+    for (long i = 0; i < count; i++) {
+        long s        = (first + i) / slice;
+        long offset   = (first + i) % slice;
+        char expected = senders[s] >= 0 && offset < len ?
+                        (char)((senders[s] + offset) % 251) : (char)0xff;
+        if (recvbuf[i] != expected) {
+#ifdef VERBOSE
+            printf("recvbuf[%ld] = %d expected %d\n", first+i, recvbuf[i], expected);
+#endif
+            return false;
+        }
+    }
+    return true;
+}
+
+// Resets the count elements of the receive buffer buf with init, through
+// the host buffer tmp if buf needs a staging buffer
+template <typename T, typename Init>
+static inline bool bench_reset_recvbuf (hip_mpitest_buffer *buf, T *tmp, long count, Init init)
+{
+    if (buf->NeedsStagingBuffer()) {
+        init(tmp, count);
+        return buf->CopyTo(tmp, count * sizeof(T)) == hipSuccess;
+    }
+    init((T *)buf->get_buffer(), count);
+    return true;
+}
+
+// Host accessible copy of the count elements of buf, downloaded into tmp
+// if buf needs a staging buffer. Returns NULL if the download failed.
+template <typename T>
+static inline T *bench_host_data (hip_mpitest_buffer *buf, T *tmp, long count)
+{
+    if (buf->NeedsStagingBuffer()) {
+        return buf->CopyFrom(tmp, count * sizeof(T)) == hipSuccess ? tmp : NULL;
+    }
+    return (T *)buf->get_buffer();
+}
+
+// Verifies the result of a benchmark in a separate pass outside of its
+// timed loop. reset() prepares the receive buffer first, such that the
+// data left by the timed iterations can not satisfy check(). run()
+// executes the operation once and returns an MPI error code. The
+// operation starts after a barrier on comm, time returns the duration of
+// the operation and the check if not NULL.
+template <typename Reset, typename Run, typename Check>
+static inline int bench_verify (MPI_Comm comm, Reset reset, Run run, Check check, bool *res,
+                                double *time)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    int ret;
 
-static void bench_performance (char *exec, MPI_Comm comm, char sendtype, char recvtype,
-                               int elements, long nBytes, int niter, double time)
+    if (!reset()) {
+        return MPI_ERR_OTHER;
+    }
+    MPI_Barrier (comm);
+    ts  = std::chrono::high_resolution_clock::now();
+    ret = run();
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    *res = check();
+    te   = std::chrono::high_resolution_clock::now();
+    if (NULL != time) {
+        *time = std::chrono::duration<double>(te-ts).count();
+    }
+    return MPI_SUCCESS;
+}
+
+static bool bench_performance (char *exec, MPI_Comm comm, char sendtype, char recvtype,
+                               long elements, long nBytes, int niter, double time,
+                               double vtime, bool res)
 {
     int rank, size;
     double t1_sum=0.0;
     double t1_avg=0.0;
+    double tv_max=0.0;
+    int gret=1, pret;
+    int spolicy[2], rpolicy[2];
+    // policies reported for the previous message size
+    static int last_spolicy[2]={-1,-1}, last_rpolicy[2]={-1,-1};
+    unsigned long snuma=0, rnuma=0;
+    int sspread=0, rspread=0;
+    static unsigned long last_snuma=0, last_rnuma=0;
+    static int last_sspread=0, last_rspread=0;
+    static bool first=true;
+    long fsum[2], fmax[2];
 
     MPI_Comm_rank (comm, &rank);
     MPI_Comm_size (comm, &size);
 
+    pret = res == true ? 1 : 0;
     MPI_Reduce(&time, &t1_sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Reduce(&vtime, &tv_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(&pret, &gret, 1, MPI_INT, MPI_MIN, 0, comm);
+    get_bufferpolicy (comm, sendbuf, spolicy);
+    get_bufferpolicy (comm, recvbuf, rpolicy);
+    if (hip_mpitest_numa_report) {
+        get_buffernuma (comm, sendbuf, &snuma, &sspread);
+        get_buffernuma (comm, recvbuf, &rnuma, &rspread);
+    }
+    if (hip_mpitest_prefault_report) {
+        get_pagefaults (comm, fsum, fmax);
+    }
 
     if (rank == 0) {
+        if (first) {
+            print_bufferoffset ("Sendbuf", sendbuf);
+            print_bufferoffset ("Recvbuf", recvbuf);
+            if (hip_mpitest_prefault_report) {
+                printf("Prefault policy %s, page faults in the timed region: minor/major "
+                       "(max. per process)\n",
+                       hip_mpitest_prefault_names[hip_mpitest_prefault_policy]);
+            }
+        }
+        if (spolicy[0] != last_spolicy[0] || spolicy[1] != last_spolicy[1]) {
+            print_bufferpolicy ("Sendbuf", sendbuf, spolicy);
+        }
+        if (rpolicy[0] != last_rpolicy[0] || rpolicy[1] != last_rpolicy[1]) {
+            print_bufferpolicy ("Recvbuf", recvbuf, rpolicy);
+        }
+        if (snuma != last_snuma || sspread != last_sspread) {
+            print_buffernuma ("Sendbuf", sendbuf, snuma, sspread, size);
+        }
+        if (rnuma != last_rnuma || rspread != last_rspread) {
+            print_buffernuma ("Recvbuf", recvbuf, rnuma, rspread, size);
+        }
         t1_avg = t1_sum/(size*niter);
-        printf("%10d \t %10lu \t %lf\n", elements, (size_t)nBytes, t1_avg);
+        printf("%10ld \t %10lu \t %lf \t %lf \t %s", elements, (size_t)nBytes, t1_avg,
+               tv_max, gret != 0 ? "SUCCESS" : "FAILED");
+        if (hip_mpitest_prefault_report) {
+            printf(" \t %ld/%ld (%ld/%ld)", fsum[0], fsum[1], fmax[0], fmax[1]);
+        }
+        printf("\n");
     }
+    memcpy (last_spolicy, spolicy, sizeof(spolicy));
+    memcpy (last_rpolicy, rpolicy, sizeof(rpolicy));
+    last_snuma   = snuma;
+    last_rnuma   = rnuma;
+    last_sspread = sspread;
+    last_rspread = rspread;
+    first        = false;
+    return (bool)gret;
 }
 
 #endif
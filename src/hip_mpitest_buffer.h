@@ -27,7 +27,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <hip/hip_runtime.h>
+#include "hip_mpitest_numa.h"
+#include "hip_mpitest_prefault.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
 
 
 enum HIP_MPITEST_MEMTYPE {
@@ -36,19 +53,254 @@ enum HIP_MPITEST_MEMTYPE {
       HIP_MPITEST_MEMTYPE_MANAGED,
       HIP_MPITEST_MEMTYPE_HOSTMALLOC,
       HIP_MPITEST_MEMTYPE_HOSTREGISTER,
+      HIP_MPITEST_MEMTYPE_HUGEPAGE,
+      HIP_MPITEST_MEMTYPE_MMAPFILE,
+      HIP_MPITEST_MEMTYPE_MEMPOOL,
       HIP_MPITEST_MEMTYPE_LAST
 };
 
-const char hip_mpitest_memtype_chars[HIP_MPITEST_MEMTYPE_LAST] = {'H','D','M','O','R'};
+const char hip_mpitest_memtype_chars[HIP_MPITEST_MEMTYPE_LAST] = {'H','D','M','O','R','P','F','A'};
+
+// Set through the --send-offset, --recv-offset and --align options
+static size_t hip_mpitest_send_offset = 0;
+static size_t hip_mpitest_recv_offset = 0;
+static size_t hip_mpitest_align       = 0;
+
+// Set through the --churn-pool option, number of buffers the registration
+// cache benchmark cycles through
+static int hip_mpitest_churn_pool = 8;
+
+// Set through the --mmap-path and --mmap-populate options
+static const char *hip_mpitest_mmap_path     = NULL;
+static bool        hip_mpitest_mmap_populate = false;
+
+// Reuse policies of the stream ordered memory pool
+#define HIP_MPITEST_POOL_REUSE_FOLLOW_EVENTS  0x1
+#define HIP_MPITEST_POOL_REUSE_OPPORTUNISTIC  0x2
+#define HIP_MPITEST_POOL_REUSE_INTERNAL_DEPS  0x4
+#define HIP_MPITEST_POOL_REUSE_ALL            0x7
+
+// Set through the --pool-release-threshold and --pool-reuse options,
+// -1 leaves the attribute of the pool unchanged
+static long long hip_mpitest_pool_release_threshold = -1;
+static int       hip_mpitest_pool_reuse             = -1;
+
+// Parses a comma separated list of reuse policies, or "none"
+static bool hip_mpitest_pool_reuse_parse (const char *arg)
+{
+    const char *names[3] = {"follow-events", "opportunistic", "internal-deps"};
+    const char *p = arg;
+    int mask = 0;
+
+    if (strcmp(arg, "none") == 0) {
+        hip_mpitest_pool_reuse = 0;
+        return true;
+    }
+    while (*p != '\0') {
+        size_t len = strcspn(p, ",");
+        int i;
+        for (i=0; i<3; i++) {
+            if (strlen(names[i]) == len && strncmp(p, names[i], len) == 0) {
+                mask |= (1 << i);
+                break;
+            }
+        }
+        if (i == 3) {
+            return false;
+        }
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    if (0 == mask) {
+        return false;
+    }
+    hip_mpitest_pool_reuse = mask;
+    return true;
+}
+
+// Allocation policies of the huge page buffer, in order of preference
+enum HIP_MPITEST_HUGEPAGE_POLICY {
+      HIP_MPITEST_HUGEPAGE_1G=0,
+      HIP_MPITEST_HUGEPAGE_2M,
+      HIP_MPITEST_HUGEPAGE_THP,
+      HIP_MPITEST_HUGEPAGE_NONE,
+      HIP_MPITEST_HUGEPAGE_LAST
+};
+
+const char *const hip_mpitest_hugepage_policy_names[HIP_MPITEST_HUGEPAGE_LAST] = {
+    "MAP_HUGETLB 1G", "MAP_HUGETLB 2M", "MADV_HUGEPAGE", "4K pages"};
+
+// Size of the chunks in which staging copies are executed
+#define HIP_MPITEST_COPY_CHUNK (4*1024*1024)
+
+// Generates bytes [offset, offset+nBytes) of the data to be copied into chunk
+typedef void (*hip_mpitest_fill_fn)(void *chunk, size_t offset, size_t nBytes, void *arg);
+
+static inline void hip_mpitest_fill_memcpy (void *chunk, size_t offset, size_t nBytes, void *arg)
+{
+    memcpy(chunk, (char *)arg + offset, nBytes);
+}
+
+static inline void hip_mpitest_fill_zero (void *chunk, size_t offset, size_t nBytes, void *arg)
+{
+    memset(chunk, 0, nBytes);
+}
+
+// Completion handle of an asynchronous copy
+struct hip_mpitest_copy_handle {
+    hipEvent_t  event;   // recorded after the last chunk, NULL if already complete
+    void       *dst;     // pending copy out of a bounce buffer (CopyFromAsync only)
+    void       *bounce;
+    size_t      nBytes;
+};
+typedef struct hip_mpitest_copy_handle hip_mpitest_copy_handle;
 
 class hip_mpitest_buffer {
  protected:
-    void                *buffer;
+    void                *buffer=NULL;
+    size_t              nbytes=0;
     HIP_MPITEST_MEMTYPE memtype;
     char                memchar;
     char            memname[32];
 
+    // Start of the allocation, buffer is shifted from it by Allocate()
+    // according to buf_offset and buf_align
+    void                *base=NULL;
+    size_t              buf_offset=0;
+    size_t              buf_align=0;
+    size_t              alloc_bytes=0;
+    int                 prefault=HIP_MPITEST_PREFAULT_NONE;
+
+    // Allocation and release of the memory of the buffer by the memory
+    // type, AllocateMem() sets buffer to the start of the allocation
+    virtual hipError_t  AllocateMem(size_t nBytes)=0;
+    virtual hipError_t  FreeMem()=0;
+
+    // Resources of the asynchronous copies, created on first use. Copies
+    // are executed on a per-buffer stream in chunks, alternating between
+    // two pinned bounce buffers, such that the host side work on one chunk
+    // overlaps with the transfer of the other one. Only one asynchronous
+    // copy can be pending per buffer.
+    hipStream_t              stream=NULL;
+    void                    *bounce[2]={NULL, NULL};
+    hipEvent_t               bounce_event[2]={NULL, NULL};
+    hip_mpitest_copy_handle *pending=NULL;
+
+    hipError_t InitAsync () {
+        hipError_t err;
+        if (NULL != stream) {
+            return hipSuccess;
+        }
+        err = hipStreamCreateWithFlags(&stream, hipStreamNonBlocking);
+        for (int i=0; i<2 && hipSuccess == err; i++) {
+            err = hipHostMalloc(&bounce[i], HIP_MPITEST_COPY_CHUNK, hipHostMallocDefault);
+            if (hipSuccess == err) {
+                err = hipEventCreateWithFlags(&bounce_event[i], hipEventDisableTiming);
+            }
+        }
+        return err;
+    }
+
+    hipError_t StartAsync (hip_mpitest_copy_handle *handle) {
+        hipError_t err = hipSuccess;
+        handle->event = NULL;
+        handle->dst   = NULL;
+        if (NULL != pending) {
+            err = Wait(pending);
+        }
+        return err;
+    }
+
+    // Staging copy from the host to a buffer not accessible by the host
+    hipError_t FillAsyncStaged (hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                                hip_mpitest_copy_handle *handle, size_t offset) {
+        hipError_t err = StartAsync(handle);
+        if (hipSuccess == err) {
+            err = InitAsync();
+        }
+        for (size_t pos=0, k=0; pos<nBytes && hipSuccess == err; pos+=HIP_MPITEST_COPY_CHUNK, k++) {
+            size_t n = (nBytes - pos) < HIP_MPITEST_COPY_CHUNK ? (nBytes - pos) : HIP_MPITEST_COPY_CHUNK;
+            int b = k % 2;
+            // the previous transfer out of this bounce buffer has to be finished
+            err = hipEventSynchronize(bounce_event[b]);
+            if (hipSuccess != err) {
+                break;
+            }
+            fill(bounce[b], pos, n, arg);
+            err = hipMemcpyAsync((char *)buffer + offset + pos, bounce[b], n, hipMemcpyDefault, stream);
+            if (hipSuccess == err) {
+                err = hipEventRecord(bounce_event[b], stream);
+            }
+        }
+        if (hipSuccess == err) {
+            err = hipEventCreateWithFlags(&handle->event, hipEventDisableTiming);
+        }
+        if (hipSuccess == err) {
+            err = hipEventRecord(handle->event, stream);
+            pending = handle;
+        }
+        return err;
+    }
+
+    // Staging copy from a buffer not accessible by the host. The last
+    // chunk is copied out of its bounce buffer when waiting for the handle.
+    hipError_t CopyFromAsyncStaged (void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                                    size_t offset) {
+        hipError_t err = StartAsync(handle);
+        size_t prev_pos=0, prev_n=0;
+        if (hipSuccess == err) {
+            err = InitAsync();
+        }
+        for (size_t pos=0, k=0; pos<nBytes && hipSuccess == err; pos+=HIP_MPITEST_COPY_CHUNK, k++) {
+            size_t n = (nBytes - pos) < HIP_MPITEST_COPY_CHUNK ? (nBytes - pos) : HIP_MPITEST_COPY_CHUNK;
+            int b = k % 2;
+            err = hipMemcpyAsync(bounce[b], (char *)buffer + offset + pos, n, hipMemcpyDefault, stream);
+            if (hipSuccess == err) {
+                err = hipEventRecord(bounce_event[b], stream);
+            }
+            // copy out the previous chunk while this one is transferred
+            if (k > 0 && hipSuccess == err) {
+                err = hipEventSynchronize(bounce_event[1-b]);
+                if (hipSuccess == err) {
+                    memcpy((char *)dst + prev_pos, bounce[1-b], prev_n);
+                }
+            }
+            prev_pos = pos;
+            prev_n   = n;
+            handle->bounce = bounce[b];
+        }
+        if (hipSuccess == err && nBytes > 0) {
+            handle->dst    = (char *)dst + prev_pos;
+            handle->nBytes = prev_n;
+            err = hipEventCreateWithFlags(&handle->event, hipEventDisableTiming);
+            if (hipSuccess == err) {
+                err = hipEventRecord(handle->event, stream);
+                pending = handle;
+            }
+        }
+        return err;
+    }
+
  public:
+    virtual ~hip_mpitest_buffer() {
+        if (NULL != pending) {
+            Wait(pending);
+        }
+        for (int i=0; i<2; i++) {
+            if (NULL != bounce_event[i]) {
+                hipEventDestroy(bounce_event[i]);
+            }
+            if (NULL != bounce[i]) {
+                hipHostFree(bounce[i]);
+            }
+        }
+        if (NULL != stream) {
+            hipStreamDestroy(stream);
+        }
+    }
+
     void* get_buffer() {
 	return buffer;
     }
@@ -58,12 +310,135 @@ class hip_mpitest_buffer {
     char *get_memname() {
 	return memname;
     }
+    size_t get_size() {
+        return nbytes;
+    }
+    // Host memory types are subject to the NUMA placement and the prefault policy
+    virtual bool IsHostMemory() {
+        return false;
+    }
+
+    // Allocation policy that has been applied, -1 if the memory type has none
+    virtual int get_policy() {
+        return -1;
+    }
+    virtual const char *get_policy_name(int policy) {
+        return NULL;
+    }
+
+    // Place the start of the buffer buf_offset bytes past an address
+    // aligned to buf_align bytes, 0 keeps the alignment of the allocator
+    void set_offset (size_t offset, size_t align) {
+        buf_offset = offset;
+        buf_align  = align;
+    }
+    size_t get_offset() {
+        return buf_offset;
+    }
+    size_t get_align() {
+        return buf_align;
+    }
+
+    // Allocates nBytes plus the room required for the offset and the
+    // alignment of the buffer, get_buffer() returns the shifted address
+    hipError_t Allocate (size_t nBytes) {
+        size_t pad = buf_offset + (buf_align > 1 ? buf_align - 1 : 0);
+        hipError_t err = AllocateMem(nBytes + pad);
+        if (hipSuccess != err) {
+            return err;
+        }
+        base = buffer;
+        alloc_bytes = nBytes + pad;
+        if (IsHostMemory()) {
+            prefault = hip_mpitest_prefault(base, alloc_bytes);
+        }
+        if (buf_align > 1) {
+            uintptr_t addr = ((uintptr_t)base + buf_align - 1) / buf_align * buf_align;
+            buffer = (void *)addr;
+        }
+        buffer = (char *)buffer + buf_offset;
+        nbytes = nBytes;
+        return err;
+    }
+
+    hipError_t Free () {
+        hipError_t err;
+        if (NULL != base) {
+            hip_mpitest_prefault_release(base, alloc_bytes, prefault);
+            buffer = base;
+        }
+        err = FreeMem();
+        prefault = HIP_MPITEST_PREFAULT_NONE;
+        base   = NULL;
+        buffer = NULL;
+        return err;
+    }
 
-    virtual hipError_t  Allocate(size_t nBytes)=0;
-    virtual hipError_t  CopyTo(void* src, size_t nBytes)=0;
-    virtual hipError_t  CopyFrom(void* dst, size_t nBytes)=0;
-    virtual hipError_t  Free ()=0;
     virtual bool        NeedsStagingBuffer()=0;
+
+    // Asynchronous copies into and out of the buffer, starting at offset
+    // bytes into the buffer. The copy is complete once Wait() returns for
+    // the handle. FillAsync generates the data through a callback instead
+    // of copying it from memory.
+    virtual hipError_t  FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                                  hip_mpitest_copy_handle *handle, size_t offset=0)=0;
+    virtual hipError_t  CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                                      size_t offset=0)=0;
+
+    hipError_t CopyToAsync(void *src, size_t nBytes, hip_mpitest_copy_handle *handle,
+                           size_t offset=0) {
+        return FillAsync(hip_mpitest_fill_memcpy, src, nBytes, handle, offset);
+    }
+
+    bool Test(hip_mpitest_copy_handle *handle) {
+        if (NULL != handle->event && hipEventQuery(handle->event) != hipSuccess) {
+            return false;
+        }
+        return Wait(handle) == hipSuccess;
+    }
+
+    hipError_t Wait(hip_mpitest_copy_handle *handle) {
+        hipError_t err = hipSuccess;
+        if (NULL != handle->event) {
+            err = hipEventSynchronize(handle->event);
+            hipEventDestroy(handle->event);
+            handle->event = NULL;
+        }
+        if (hipSuccess == err && NULL != handle->dst) {
+            memcpy(handle->dst, handle->bounce, handle->nBytes);
+        }
+        handle->dst = NULL;
+        if (pending == handle) {
+            pending = NULL;
+        }
+        return err;
+    }
+
+    // Synchronous versions of the copies
+    hipError_t CopyTo(void *src, size_t nBytes, size_t offset=0) {
+        hip_mpitest_copy_handle handle;
+        hipError_t err = CopyToAsync(src, nBytes, &handle, offset);
+        if (hipSuccess != err) {
+            return err;
+        }
+        return Wait(&handle);
+    }
+    hipError_t CopyFrom(void *dst, size_t nBytes, size_t offset=0) {
+        hip_mpitest_copy_handle handle;
+        hipError_t err = CopyFromAsync(dst, nBytes, &handle, offset);
+        if (hipSuccess != err) {
+            return err;
+        }
+        return Wait(&handle);
+    }
+    hipError_t Fill(hip_mpitest_fill_fn fill, void *arg, size_t nBytes, size_t offset=0) {
+        hip_mpitest_copy_handle handle;
+        hipError_t err = FillAsync(fill, arg, nBytes, &handle, offset);
+        if (hipSuccess != err) {
+            return err;
+        }
+        return Wait(&handle);
+    }
 };
 
 
@@ -79,30 +454,40 @@ class hip_mpitest_buffer_host: public hip_mpitest_buffer {
 	return false;
     }
 
-    hipError_t Allocate (size_t nBytes) {
+    bool IsHostMemory() {
+        return true;
+    }
+
+    hipError_t AllocateMem (size_t nBytes) {
 	hipError_t err = hipErrorMemoryAllocation;
 	char *tbuf = (char *) malloc (nBytes);
 	if (NULL != tbuf) {
 	    err = hipSuccess;
 	    buffer = tbuf;
+            nbytes = nBytes;
+            hip_mpitest_numa_bind(tbuf, nBytes);
 	}
 	return err;
     }
 
-    hipError_t Free () {
+    hipError_t FreeMem () {
 	free(buffer);
 	buffer = NULL;
 	return hipSuccess;
     }
 
-    hipError_t CopyTo(void *src, size_t nBytes) {
-	memcpy(buffer, src, nBytes);
-	return hipSuccess;
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        fill((char *)buffer + offset, 0, nBytes, arg);
+        return err;
     }
 
-    hipError_t CopyFrom(void *dst, size_t nBytes) {
-	memcpy(dst, buffer, nBytes);
-	return hipSuccess;
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        memcpy(dst, (char *)buffer + offset, nBytes);
+        return err;
     }
 };
 
@@ -118,31 +503,113 @@ class hip_mpitest_buffer_device: public hip_mpitest_buffer {
 	return true;
     }
 
-    hipError_t Allocate (size_t nBytes) {
+    hipError_t AllocateMem (size_t nBytes) {
+        nbytes = nBytes;
 	return hipMalloc((void **)&buffer, nBytes);
     }
 
-    hipError_t Free () {
+    hipError_t FreeMem () {
 	hipError_t err = hipFree(buffer);
 	buffer = NULL;
 	return err;
     }
 
-    hipError_t CopyTo(void *src, size_t nBytes) {
-	hipError_t err = hipMemcpy(buffer, src, nBytes, hipMemcpyDefault);
-        if (err != hipSuccess) {
-            return err;
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        return FillAsyncStaged(fill, arg, nBytes, handle, offset);
+    }
+
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        return CopyFromAsyncStaged(dst, nBytes, handle, offset);
+    }
+
+};
+
+
+// Device memory allocated from the stream ordered default memory pool of
+// the current device. The attributes of the pool are set once, before the
+// first allocation. Allocation and release are completed on the stream of
+// the buffer before returning, since MPI is not aware of streams.
+class hip_mpitest_buffer_mempool: public hip_mpitest_buffer {
+ protected:
+    hipError_t SetupPool () {
+        static bool done=false;
+        hipMemPool_t pool;
+        hipError_t err;
+        int dev;
+
+        if (done) {
+            return hipSuccess;
+        }
+        err = hipGetDevice(&dev);
+        if (hipSuccess == err) {
+            err = hipDeviceGetDefaultMemPool(&pool, dev);
         }
-        return hipStreamSynchronize(0);
+        if (hipSuccess == err && hip_mpitest_pool_release_threshold >= 0) {
+            uint64_t threshold = (uint64_t)hip_mpitest_pool_release_threshold;
+            err = hipMemPoolSetAttribute(pool, hipMemPoolAttrReleaseThreshold, &threshold);
+        }
+        if (hipSuccess == err && hip_mpitest_pool_reuse >= 0) {
+            hipMemPoolAttr attrs[3] = {hipMemPoolReuseFollowEventDependencies,
+                                       hipMemPoolReuseAllowOpportunistic,
+                                       hipMemPoolReuseAllowInternalDependencies};
+            for (int i=0; i<3 && hipSuccess == err; i++) {
+                int value = (hip_mpitest_pool_reuse & (1 << i)) ? 1 : 0;
+                err = hipMemPoolSetAttribute(pool, attrs[i], &value);
+            }
+        }
+        done = (hipSuccess == err);
+        return err;
     }
-    hipError_t CopyFrom(void *dst, size_t nBytes) {
-	hipError_t err = hipMemcpy(dst, buffer, nBytes, hipMemcpyDefault);
-        if (err != hipSuccess) {
-            return err;
+
+ public:
+    hip_mpitest_buffer_mempool () {
+        memtype = HIP_MPITEST_MEMTYPE_MEMPOOL;
+        memchar = 'A';
+        strncpy (memname, "hipMallocAsync", 32);
+    }
+
+    bool NeedsStagingBuffer() {
+        return true;
+    }
+
+    hipError_t AllocateMem (size_t nBytes) {
+        hipError_t err = SetupPool();
+        if (hipSuccess == err) {
+            err = InitAsync();
+        }
+        if (hipSuccess == err) {
+            err = hipMallocAsync((void **)&buffer, nBytes, stream);
+        }
+        if (hipSuccess == err) {
+            err = hipStreamSynchronize(stream);
         }
-        return hipStreamSynchronize(0);
+        nbytes = nBytes;
+        return err;
     }
 
+    hipError_t FreeMem () {
+        hipError_t err = hipSuccess;
+        if (NULL != buffer) {
+            err = hipFreeAsync(buffer, stream);
+            if (hipSuccess == err) {
+                err = hipStreamSynchronize(stream);
+            }
+        }
+        buffer = NULL;
+        return err;
+    }
+
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        return FillAsyncStaged(fill, arg, nBytes, handle, offset);
+    }
+
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        return CopyFromAsyncStaged(dst, nBytes, handle, offset);
+    }
 };
 
 
@@ -158,30 +625,25 @@ class hip_mpitest_buffer_managed: public hip_mpitest_buffer {
 	return false;
     }
 
-    hipError_t Allocate(size_t nBytes) {
+    hipError_t AllocateMem (size_t nBytes) {
+        nbytes = nBytes;
 	return hipMallocManaged((void**) &buffer, nBytes);
     }
 
-    hipError_t Free() {
+    hipError_t FreeMem () {
 	hipError_t err = hipFree(buffer);
 	buffer = NULL;
 	return err;
     }
 
-    hipError_t CopyTo(void *src, size_t nBytes) {
-	hipError_t err = hipMemcpy(buffer, src, nBytes, hipMemcpyDefault);
-        if (err != hipSuccess) {
-            return err;
-        }
-        return hipStreamSynchronize(0);
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        return FillAsyncStaged(fill, arg, nBytes, handle, offset);
     }
 
-    hipError_t CopyFrom(void *dst, size_t nBytes) {
-	hipError_t err = hipMemcpy(dst, buffer, nBytes, hipMemcpyDefault);
-        if (err != hipSuccess) {
-            return err;
-        }
-        return hipStreamSynchronize(0);
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        return CopyFromAsyncStaged(dst, nBytes, handle, offset);
     }
 };
 
@@ -197,30 +659,33 @@ class hip_mpitest_buffer_hostmalloc: public hip_mpitest_buffer {
 	return false;
     }
 
-    hipError_t Allocate(size_t nBytes) {
-	return hipHostMalloc((void **)&buffer, nBytes);
+    bool IsHostMemory() {
+        return true;
+    }
+
+    hipError_t AllocateMem (size_t nBytes) {
+        // the pages are populated by the allocation itself
+        nbytes = nBytes;
+        hip_mpitest_numa_set();
+	hipError_t err = hipHostMalloc((void **)&buffer, nBytes);
+        hip_mpitest_numa_unset();
+        return err;
     }
 
-    hipError_t Free() {
+    hipError_t FreeMem () {
 	hipError_t err = hipFree(buffer);
 	buffer = NULL;
 	return err;
     }
 
-    hipError_t CopyTo(void *src, size_t nBytes) {
-	hipError_t err = hipMemcpy(buffer, src, nBytes, hipMemcpyDefault);
-        if (err != hipSuccess) {
-            return err;
-        }
-        return hipStreamSynchronize(0);
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        return FillAsyncStaged(fill, arg, nBytes, handle, offset);
     }
 
-    hipError_t CopyFrom(void *dst, size_t nBytes) {
-	hipError_t err = hipMemcpy(dst, buffer, nBytes, hipMemcpyDefault);
-        if (err != hipSuccess) {
-            return err;
-        }
-        return hipStreamSynchronize(0);
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        return CopyFromAsyncStaged(dst, nBytes, handle, offset);
     }
 };
 
@@ -236,35 +701,254 @@ class hip_mpitest_buffer_hostregister: public hip_mpitest_buffer {
 	return false;
     }
 
-    hipError_t Allocate(size_t nBytes) {
+    bool IsHostMemory() {
+        return true;
+    }
+
+    hipError_t AllocateMem (size_t nBytes) {
 	hipError_t err = hipErrorMemoryAllocation;
 	char *tbuf = (char*) malloc (nBytes);
 	if (NULL != tbuf) {
+            // the pages have to be placed before they are pinned
+            hip_mpitest_numa_bind(tbuf, nBytes);
 	    err = hipHostRegister(tbuf, nBytes, 0);
 	    buffer = tbuf;
+            nbytes = nBytes;
 	}
 	return err;
     }
 
-    hipError_t Free() {
+    hipError_t FreeMem () {
 	hipError_t err = hipHostUnregister(buffer);
 	free(buffer);
 	buffer = NULL;
 	return err;
     }
 
-    hipError_t CopyTo(void *src, size_t nBytes) {
-	memcpy(buffer, src, nBytes);
-	return hipSuccess;
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        fill((char *)buffer + offset, 0, nBytes, arg);
+        return err;
     }
 
-    hipError_t CopyFrom(void *dst, size_t nBytes) {
-	memcpy(dst, buffer, nBytes);
-	return hipSuccess;
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        memcpy(dst, (char *)buffer + offset, nBytes);
+        return err;
     }
 };
 
-// Some convinience macros
+// Host memory backed by huge pages. Explicit huge pages (MAP_HUGETLB)
+// are tried first, 1G pages only for allocations of at least 1 GiB.
+// If no huge pages are reserved, the allocation falls back to regular
+// pages with a transparent huge page hint.
+class hip_mpitest_buffer_hugepage: public hip_mpitest_buffer {
+ protected:
+    size_t mapped;
+    int    policy;
+
+ public:
+    hip_mpitest_buffer_hugepage () {
+        memtype = HIP_MPITEST_MEMTYPE_HUGEPAGE;
+        memchar = 'P';
+        strncpy (memname, "mmap huge pages", 32);
+        policy = HIP_MPITEST_HUGEPAGE_NONE;
+        mapped = 0;
+    }
+
+    bool NeedsStagingBuffer() {
+        return false;
+    }
+
+    bool IsHostMemory() {
+        return true;
+    }
+
+    int get_policy() {
+        return policy;
+    }
+    const char *get_policy_name(int p) {
+        return hip_mpitest_hugepage_policy_names[p];
+    }
+
+    hipError_t AllocateMem (size_t nBytes) {
+        const size_t hugesize[2] = {1UL<<30, 1UL<<21};
+        const int    hugeflag[2] = {MAP_HUGE_1GB, MAP_HUGE_2MB};
+        void *tbuf;
+
+        for (int i=0; i<2; i++) {
+            if (HIP_MPITEST_HUGEPAGE_1G == i && nBytes < hugesize[i]) {
+                continue;
+            }
+            size_t len = ((nBytes + hugesize[i] - 1) / hugesize[i]) * hugesize[i];
+            tbuf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | hugeflag[i], -1, 0);
+            if (MAP_FAILED != tbuf) {
+                buffer = tbuf;
+                nbytes = nBytes;
+                mapped = len;
+                policy = i;
+                hip_mpitest_numa_bind(tbuf, len);
+                return hipSuccess;
+            }
+        }
+
+        long pagesize = sysconf(_SC_PAGESIZE);
+        size_t len = ((nBytes + pagesize - 1) / pagesize) * pagesize;
+        tbuf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == tbuf) {
+            return hipErrorMemoryAllocation;
+        }
+        buffer = tbuf;
+        nbytes = nBytes;
+        mapped = len;
+        hip_mpitest_numa_bind(tbuf, len);
+        policy = (madvise(tbuf, len, MADV_HUGEPAGE) == 0) ? HIP_MPITEST_HUGEPAGE_THP :
+                                                            HIP_MPITEST_HUGEPAGE_NONE;
+        return hipSuccess;
+    }
+
+    hipError_t FreeMem () {
+        if (NULL != buffer) {
+            munmap(buffer, mapped);
+        }
+        buffer = NULL;
+        mapped = 0;
+        return hipSuccess;
+    }
+
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        fill((char *)buffer + offset, 0, nBytes, arg);
+        return err;
+    }
+
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        memcpy(dst, (char *)buffer + offset, nBytes);
+        return err;
+    }
+};
+
+// Host memory backed by a shared mapping of a file. The file is created
+// in the directory given by --mmap-path (default $TMPDIR or /tmp) and
+// removed right away, such that it disappears once the buffer is freed.
+// The pages are either faulted in from the page cache on first access,
+// or populated when mapping the file with --mmap-populate.
+class hip_mpitest_buffer_mmapfile: public hip_mpitest_buffer {
+ protected:
+    size_t mapped;
+    int    fd;
+
+ public:
+    hip_mpitest_buffer_mmapfile () {
+        memtype = HIP_MPITEST_MEMTYPE_MMAPFILE;
+        memchar = 'F';
+        strncpy (memname, "mmap file", 32);
+        mapped = 0;
+        fd = -1;
+    }
+
+    bool NeedsStagingBuffer() {
+        return false;
+    }
+
+    bool IsHostMemory() {
+        return true;
+    }
+
+    hipError_t AllocateMem (size_t nBytes) {
+        const char *dir = hip_mpitest_mmap_path;
+        char fname[512];
+        long pagesize = sysconf(_SC_PAGESIZE);
+        size_t len = ((nBytes + pagesize - 1) / pagesize) * pagesize;
+        void *tbuf;
+
+        if (NULL == dir) {
+            dir = getenv("TMPDIR");
+        }
+        if (NULL == dir) {
+            dir = "/tmp";
+        }
+        if (0 == len) {
+            len = pagesize;
+        }
+        snprintf(fname, sizeof(fname), "%s/hip_mpitest_buffer_XXXXXX", dir);
+        fd = mkstemp(fname);
+        if (-1 == fd) {
+            printf("hip_mpitest_buffer_mmapfile: could not create file in %s %s\n", dir,
+                   strerror(errno));
+            return hipErrorMemoryAllocation;
+        }
+        unlink(fname);
+        if (ftruncate(fd, len) != 0) {
+            close(fd);
+            fd = -1;
+            return hipErrorMemoryAllocation;
+        }
+        tbuf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | (hip_mpitest_mmap_populate ? MAP_POPULATE : 0), fd, 0);
+        if (MAP_FAILED == tbuf) {
+            close(fd);
+            fd = -1;
+            return hipErrorMemoryAllocation;
+        }
+        buffer = tbuf;
+        nbytes = nBytes;
+        mapped = len;
+        hip_mpitest_numa_bind(tbuf, len);
+        return hipSuccess;
+    }
+
+    hipError_t FreeMem () {
+        if (NULL != buffer) {
+            munmap(buffer, mapped);
+            close(fd);
+        }
+        buffer = NULL;
+        mapped = 0;
+        fd = -1;
+        return hipSuccess;
+    }
+
+    hipError_t FillAsync(hip_mpitest_fill_fn fill, void *arg, size_t nBytes,
+                         hip_mpitest_copy_handle *handle, size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        fill((char *)buffer + offset, 0, nBytes, arg);
+        return err;
+    }
+
+    hipError_t CopyFromAsync(void *dst, size_t nBytes, hip_mpitest_copy_handle *handle,
+                             size_t offset=0) {
+        hipError_t err = StartAsync(handle);
+        memcpy(dst, (char *)buffer + offset, nBytes);
+        return err;
+    }
+};
+
+// Creates a buffer object of the memory type identified by memchar,
+// NULL for an unknown memory type
+static hip_mpitest_buffer *hip_mpitest_buffer_create (char memchar)
+{
+    switch (memchar) {
+    case 'D': return new hip_mpitest_buffer_device;
+    case 'H': return new hip_mpitest_buffer_host;
+    case 'M': return new hip_mpitest_buffer_managed;
+    case 'O': return new hip_mpitest_buffer_hostmalloc;
+    case 'R': return new hip_mpitest_buffer_hostregister;
+    case 'P': return new hip_mpitest_buffer_hugepage;
+    case 'F': return new hip_mpitest_buffer_mmapfile;
+    case 'A': return new hip_mpitest_buffer_mempool;
+    default:  return NULL;
+    }
+}
+
+// Some convinience macros. New tests should use hip_mpitest_typed_buffer
+// instead, which only creates host staging copies when they are accessed.
 #define ALLOCATE_SENDBUFFER(_sendbuf, _tmp_sendbuf, _type, _elements, _extent, _rank, _comm, _init, _label) { \
      if (_sendbuf == nullptr) {                                                                       \
          ret = MPI_ERR_OTHER;                                                                         \
@@ -25,6 +25,7 @@
 #define __HIP_MPITEST_DATATYPE__
 
 #include "mpi.h"
+#include "hip_mpitest_typemap.h"
 
 class hip_mpitest_datatype {
  protected:
@@ -44,9 +45,19 @@ class hip_mpitest_datatype {
 	return type_size;
     }
     virtual int get_num_elements()=0;
-    virtual void init_sendbuf   (void *sendbuf, int count, int mynode)=0;
-    virtual void init_recvbuf   (void *recvbuf, int count)=0;
-    virtual bool check_recvbuf  (void *recvbuf, int numprocs, int rank, int count)=0;
+
+    // By default, buffers are initialized and checked based on the
+    // flattened typemap of the datatype, such that a new type only
+    // needs to construct its MPI_Datatype.
+    virtual void init_sendbuf   (void *sendbuf, int count, int mynode) {
+        hip_mpitest_typemap_init_sendbuf (datatype, sendbuf, count, mynode);
+    }
+    virtual void init_recvbuf   (void *recvbuf, int count) {
+        hip_mpitest_typemap_init_recvbuf (datatype, recvbuf, count);
+    }
+    virtual bool check_recvbuf  (void *recvbuf, int recvfrom, int count) {
+        return hip_mpitest_typemap_check_recvbuf (datatype, recvbuf, count, recvfrom);
+    }
 };
 
 
@@ -54,6 +65,8 @@ class hip_mpitest_datatype {
 #include "hip_type_resized.h"
 #elif defined (HIP_TYPE_STRUCT)
 #include "hip_type_struct.h"
+#elif defined (HIP_TYPE_NESTED)
+#include "hip_type_nested.h"
 #endif
 
 #endif // __HIP_MPITEST_DATATYPE__
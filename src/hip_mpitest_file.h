@@ -0,0 +1,197 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_FILE__
+#define __HIP_MPITEST_FILE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+enum HIP_MPITEST_FILE_VERIFY {
+      HIP_MPITEST_FILE_VERIFY_STREAM=0,
+      HIP_MPITEST_FILE_VERIFY_MMAP,
+      HIP_MPITEST_FILE_VERIFY_LAST
+};
+
+// Amount of data checked at once by the file verifiers
+#define HIP_MPITEST_FILE_CHUNK (8*1024*1024)
+
+// Set through the --file-verify and --keep-page-cache options
+static int  hip_mpitest_file_verify_mode = HIP_MPITEST_FILE_VERIFY_STREAM;
+static bool hip_mpitest_file_dropcache   = true;
+
+// Checks count elements of a file stored in buf. first is the index
+// of the first element of buf within the file.
+typedef bool (*hip_mpitest_file_check_fn)(void *buf, long first, long count);
+
+static inline bool hip_mpitest_file_pread (int fd, void *buf, size_t num, off_t offset)
+{
+    int lcount=0;
+    ssize_t a;
+    char *rbuf = (char *)buf;
+
+    do {
+        a = pread (fd, rbuf, num, offset);
+        if (0 == a && num > 0) {
+            printf("hip_mpitest_file_pread: Warning: # Bytes read are less than "
+                   "expected file size %d\n", fd);
+            return false;
+        }
+        if (a == -1) {
+            if (errno == EINTR       || errno == EAGAIN     ||
+                errno == EINPROGRESS || errno == EWOULDBLOCK) {
+                lcount++;
+                continue;
+            }
+            printf("hip_mpitest_file_pread: error while reading from file %d %s\n",
+                   fd, strerror(errno));
+            return false;
+        }
+        num    -= a;
+        rbuf   += a;
+        offset += a;
+    } while (num > 0 && lcount < 20);
+
+    return num == 0;
+}
+
+// Evict a file from the page cache, such that subsequent reads have to
+// go to the storage. Only clean pages can be dropped, hence the file is
+// flushed first.
+static inline void hip_mpitest_file_drop_cache (int fd)
+{
+    fdatasync (fd);
+    posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+static inline bool hip_mpitest_file_verify_stream (int fd, long start, long count, size_t elsize,
+                                                   hip_mpitest_file_check_fn check)
+{
+    bool res=true;
+    long chunk = HIP_MPITEST_FILE_CHUNK / elsize;
+    long n;
+    char *buf;
+
+    if (chunk == 0) {
+        chunk = 1;
+    }
+    if (chunk > count) {
+        chunk = count;
+    }
+    buf = (char *) malloc (chunk * elsize);
+    if (NULL == buf) {
+        printf("hip_mpitest_file_verify: Could not allocate memory\n");
+        return false;
+    }
+
+    posix_fadvise (fd, start * elsize, count * elsize, POSIX_FADV_SEQUENTIAL);
+    for (long done=0; done<count && res; done+=n) {
+        n = (count - done) < chunk ? (count - done) : chunk;
+        if (!hip_mpitest_file_pread (fd, buf, n * elsize, (start + done) * elsize)) {
+            res = false;
+            break;
+        }
+        // Let the kernel read the next chunk while checking this one
+        if (done + n < count) {
+            long nn = (count - done - n) < chunk ? (count - done - n) : chunk;
+            posix_fadvise (fd, (start + done + n) * elsize, nn * elsize, POSIX_FADV_WILLNEED);
+        }
+        res = check (buf, start + done, n);
+        // Verified data is not accessed again
+        posix_fadvise (fd, (start + done) * elsize, n * elsize, POSIX_FADV_DONTNEED);
+    }
+
+    free (buf);
+    return res;
+}
+
+static inline bool hip_mpitest_file_verify_mmap (int fd, long start, long count, size_t elsize,
+                                                 hip_mpitest_file_check_fn check)
+{
+    bool res=true;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    long chunk = HIP_MPITEST_FILE_CHUNK / elsize;
+    long n;
+    off_t offset  = start * elsize;
+    off_t aoffset = offset - (offset % pagesize);
+    size_t len = count * elsize + (offset - aoffset);
+    char *map, *base;
+
+    if (chunk == 0) {
+        chunk = 1;
+    }
+    map = (char *) mmap (NULL, len, PROT_READ, MAP_SHARED, fd, aoffset);
+    if (MAP_FAILED == map) {
+        printf("hip_mpitest_file_verify: mmap failed %s\n", strerror(errno));
+        return false;
+    }
+    madvise (map, len, MADV_SEQUENTIAL);
+    base = map + (offset - aoffset);
+
+    for (long done=0; done<count && res; done+=n) {
+        n = (count - done) < chunk ? (count - done) : chunk;
+        // Prefetch the next chunk while checking this one
+        if (done + n < count) {
+            long nn = (count - done - n) < chunk ? (count - done - n) : chunk;
+            char *next = base + (done + n) * elsize;
+            char *anext = map + ((next - map) / pagesize) * pagesize;
+            madvise (anext, (next - anext) + nn * elsize, MADV_WILLNEED);
+        }
+        res = check (base + done * elsize, start + done, n);
+    }
+
+    munmap (map, len);
+    return res;
+}
+
+// Verify count elements of size elsize of a file, starting at element
+// start, without reading the whole region into memory at once. The
+// region is processed in chunks of HIP_MPITEST_FILE_CHUNK bytes, either
+// read into a bounded buffer or accessed through a memory mapping,
+// depending on hip_mpitest_file_verify_mode.
+static inline bool hip_mpitest_file_verify (int fd, long start, long count, size_t elsize,
+                                            hip_mpitest_file_check_fn check)
+{
+    struct stat sbuf;
+
+    if (count == 0) {
+        return true;
+    }
+    if (fstat (fd, &sbuf) != 0 || sbuf.st_size < (off_t)((start + count) * elsize)) {
+        printf("hip_mpitest_file_verify: file is shorter than expected\n");
+        return false;
+    }
+    if (hip_mpitest_file_verify_mode == HIP_MPITEST_FILE_VERIFY_MMAP) {
+        return hip_mpitest_file_verify_mmap (fd, start, count, elsize, check);
+    }
+    return hip_mpitest_file_verify_stream (fd, start, count, elsize, check);
+}
+
+#endif // __HIP_MPITEST_FILE__
@@ -0,0 +1,208 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef __HIP_MPITEST_FIT__
+#define __HIP_MPITEST_FIT__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+// Maximum number of linear segments and minimum number of points per segment
+#define HIP_MPITEST_FIT_MAXSEG   6
+#define HIP_MPITEST_FIT_MINPTS   3
+// Relative change of the latency at a switch point above which the
+// switch is reported as a step rather than as a change of the slope
+#define HIP_MPITEST_FIT_STEP     0.1
+
+struct hip_mpitest_fit_segment {
+    int    first, last;   // indices of the first and last point
+    double a, b;          // latency = a + b * bytes
+};
+
+// Weighted least squares fit of the points [first, last] to a line. The
+// weights are 1/y^2, i.e. the relative error is minimized, such that the
+// small messages are not dominated by the absolute errors of the large ones.
+// The latency can not decrease with the message size, hence a negative
+// slope is replaced by a constant.
+static double hip_mpitest_fit_line (const double *x, const double *y, int first, int last,
+                                    double *a, double *b)
+{
+    double sw=0.0, mx=0.0, my=0.0, sxx=0.0, sxy=0.0, err=0.0;
+
+    for (int i=first; i<=last; i++) {
+        double w = 1.0 / (y[i] * y[i]);
+        sw += w;
+        mx += w * x[i];
+        my += w * y[i];
+    }
+    mx /= sw;
+    my /= sw;
+    for (int i=first; i<=last; i++) {
+        double w = 1.0 / (y[i] * y[i]);
+        sxx += w * (x[i] - mx) * (x[i] - mx);
+        sxy += w * (x[i] - mx) * (y[i] - my);
+    }
+    *b = sxx > 0.0 && sxy > 0.0 ? sxy / sxx : 0.0;
+    *a = my - *b * mx;
+    for (int i=first; i<=last; i++) {
+        double r = (y[i] - *a - *b * x[i]) / y[i];
+        err += r * r;
+    }
+    return err;
+}
+
+// Split the n points (x[i], y[i]), sorted by x, into the linear segments
+// of at least minpts points minimizing the squared relative error by
+// dynamic programming. The number of segments is chosen by the Bayesian
+// information criterion, which weighs the error against the 3 parameters
+// added per segment (intercept, slope, switch point). Returns the number
+// of segments.
+static int hip_mpitest_fit_segments (const double *x, const double *y, int n, int minpts,
+                                     hip_mpitest_fit_segment *seg)
+{
+    int maxseg;
+    int nseg=0;
+    double best=DBL_MAX;
+    double *cost=NULL, *err=NULL;
+    int *from=NULL;
+
+    if (minpts < HIP_MPITEST_FIT_MINPTS) {
+        minpts = HIP_MPITEST_FIT_MINPTS;
+    }
+    maxseg = n / minpts;
+    if (maxseg > HIP_MPITEST_FIT_MAXSEG) {
+        maxseg = HIP_MPITEST_FIT_MAXSEG;
+    }
+    if (maxseg < 1) {
+        return 0;
+    }
+    cost = (double *) malloc (n * n * sizeof(double));
+    err  = (double *) malloc ((maxseg + 1) * (n + 1) * sizeof(double));
+    from = (int *) malloc ((maxseg + 1) * (n + 1) * sizeof(int));
+    if (NULL == cost || NULL == err || NULL == from) {
+        goto out;
+    }
+
+    // cost[i*n+j]: error of a single line through the points [i, j]
+    for (int i=0; i<n; i++) {
+        for (int j=i+minpts-1; j<n; j++) {
+            double a, b;
+            cost[i*n+j] = hip_mpitest_fit_line (x, y, i, j, &a, &b);
+        }
+    }
+
+    // err[k*(n+1)+j]: minimum error of k segments covering the first j points,
+    // from[k*(n+1)+j]: first point of the last of these segments
+    for (int k=0; k<=maxseg; k++) {
+        for (int j=0; j<=n; j++) {
+            err[k*(n+1)+j] = DBL_MAX;
+        }
+    }
+    err[0] = 0.0;
+    for (int k=1; k<=maxseg; k++) {
+        for (int j=k*minpts; j<=n; j++) {
+            for (int i=(k-1)*minpts; i<=j-minpts; i++) {
+                double e = err[(k-1)*(n+1)+i];
+                if (e == DBL_MAX) {
+                    continue;
+                }
+                e += cost[i*n+j-1];
+                if (e < err[k*(n+1)+j]) {
+                    err[k*(n+1)+j]  = e;
+                    from[k*(n+1)+j] = i;
+                }
+            }
+        }
+    }
+
+    for (int k=1; k<=maxseg; k++) {
+        double e = err[k*(n+1)+n];
+        double bic;
+        if (e == DBL_MAX) {
+            continue;
+        }
+        bic = n * log(e / n + 1e-12) + (3 * k - 1) * log((double)n);
+        if (bic < best) {
+            best = bic;
+            nseg = k;
+        }
+    }
+
+    for (int k=nseg, j=n; k>0; k--) {
+        int i = from[k*(n+1)+j];
+        seg[k-1].first = i;
+        seg[k-1].last  = j - 1;
+        hip_mpitest_fit_line (x, y, i, j - 1, &seg[k-1].a, &seg[k-1].b);
+        j = i;
+    }
+
+ out:
+    free (cost);
+    free (err);
+    free (from);
+    return nseg;
+}
+
+// Print the segments of a latency curve with x in bytes and y in usec,
+// and classify the switch points between them.
+static void hip_mpitest_fit_report (const double *x, const double *y, int n,
+                                    const hip_mpitest_fit_segment *seg, int nseg)
+{
+    printf("\nDetected %d regime(s):\n", nseg);
+    printf("regime \t first size \t last size \t latency (usec) \t cost per byte (nsec) \t bandwidth (MB/s)\n");
+    for (int k=0; k<nseg; k++) {
+        const hip_mpitest_fit_segment *s = &seg[k];
+        printf("%6d \t %10.0lf \t %9.0lf \t %14.3lf \t %20.6lf \t ", k + 1, x[s->first],
+               x[s->last], s->a + s->b * x[s->first], s->b * 1e3);
+        if (s->b > 0.0) {
+            printf("%16.1lf\n", 1.0 / s->b);
+        }
+        else {
+            printf("%16s\n", "-");
+        }
+    }
+    for (int k=1; k<nseg; k++) {
+        // latency at the first size of the new regime by both regimes
+        double xs  = x[seg[k].first];
+        double yo  = seg[k-1].a + seg[k-1].b * xs;
+        double yn  = seg[k].a + seg[k].b * xs;
+        double rel = (yn - yo) / y[seg[k].first];
+
+        printf("Switch %d at %.0lf bytes: ", k, xs);
+        if (rel > HIP_MPITEST_FIT_STEP) {
+            printf("step of %+.3lf usec (%+.0lf%%), e.g. eager/rendezvous protocol switch\n",
+                   yn - yo, rel * 100.0);
+        }
+        else if (rel < -HIP_MPITEST_FIT_STEP) {
+            printf("step of %+.3lf usec (%+.0lf%%), e.g. switch to a zero-copy protocol\n",
+                   yn - yo, rel * 100.0);
+        }
+        else {
+            printf("change of the cost per byte from %.6lf to %.6lf nsec, e.g. pipelining "
+                   "or fragmentation\n", seg[k-1].b * 1e3, seg[k].b * 1e3);
+        }
+    }
+}
+
+#endif // __HIP_MPITEST_FIT__
@@ -0,0 +1,263 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef __HIP_MPITEST_LARGECOUNT__
+#define __HIP_MPITEST_LARGECOUNT__
+
+#include <limits.h>
+#include "mpi.h"
+
+// The MPI-4 large-count (_c) variants take the counts as MPI_Count.
+// Without them, messages of more than INT_MAX elements are described by
+// a derived datatype, and reductions are split into several operations.
+// Defining HIP_MPITEST_NO_MPI_COUNT forces the fallback.
+#if MPI_VERSION >= 4 && !defined(HIP_MPITEST_NO_MPI_COUNT)
+#define HIP_MPITEST_HAVE_MPI_COUNT 1
+#endif
+
+// Number of elements of the contiguous blocks of the derived datatypes
+#define HIP_MPITEST_LARGECOUNT_CHUNK (1L << 30)
+
+// Largest number of elements accepted by -n. Tests passing their counts
+// through the functions of this file raise it before parse_args().
+static long hip_mpitest_max_elements = INT_MAX;
+
+// Describe count elements of type by newcount elements of newtype, with
+// newcount fitting into an int. newtype is type itself if count does, and
+// has to be released with hip_mpitest_largecount_free() otherwise.
+static inline int hip_mpitest_largecount_type (long count, MPI_Datatype type, MPI_Datatype *newtype,
+                                               int *newcount)
+{
+    MPI_Datatype chunk;
+    MPI_Aint lb, extent;
+    long nchunks = count / HIP_MPITEST_LARGECOUNT_CHUNK;
+    long rest    = count % HIP_MPITEST_LARGECOUNT_CHUNK;
+    int ret;
+
+    if (count <= INT_MAX) {
+        *newtype  = type;
+        *newcount = (int)count;
+        return MPI_SUCCESS;
+    }
+
+    ret = MPI_Type_contiguous ((int)HIP_MPITEST_LARGECOUNT_CHUNK, type, &chunk);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    if (rest == 0) {
+        ret = MPI_Type_contiguous ((int)nchunks, chunk, newtype);
+    }
+    else {
+        // nchunks blocks followed by the remaining elements
+        int blocklens[2] = {(int)nchunks, (int)rest};
+        MPI_Aint displs[2];
+        MPI_Datatype types[2] = {chunk, type};
+
+        MPI_Type_get_extent (type, &lb, &extent);
+        displs[0] = 0;
+        displs[1] = (MPI_Aint)(nchunks * HIP_MPITEST_LARGECOUNT_CHUNK) * extent;
+        ret = MPI_Type_create_struct (2, blocklens, displs, types, newtype);
+    }
+    MPI_Type_free (&chunk);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    ret = MPI_Type_commit (newtype);
+    if (MPI_SUCCESS != ret) {
+        MPI_Type_free (newtype);
+        return ret;
+    }
+    *newcount = 1;
+    return MPI_SUCCESS;
+}
+
+static inline void hip_mpitest_largecount_free (MPI_Datatype *newtype, MPI_Datatype type)
+{
+    if (*newtype != type) {
+        MPI_Type_free (newtype);
+    }
+}
+
+// Point-to-point and broadcast. A derived datatype may be released as
+// soon as the operation using it has been started.
+#ifdef HIP_MPITEST_HAVE_MPI_COUNT
+#define HIP_MPITEST_LARGECOUNT_CALL(_fn, _buf, _count, _type, ...)                  \
+    return _fn##_c (_buf, (MPI_Count)(_count), _type, __VA_ARGS__);
+#else
+#define HIP_MPITEST_LARGECOUNT_CALL(_fn, _buf, _count, _type, ...) {                \
+    MPI_Datatype _ltype;                                                             \
+    int _lcount, _ret;                                                               \
+    _ret = hip_mpitest_largecount_type (_count, _type, &_ltype, &_lcount);           \
+    if (MPI_SUCCESS != _ret) {                                                       \
+        return _ret;                                                                 \
+    }                                                                                \
+    _ret = _fn (_buf, _lcount, _ltype, __VA_ARGS__);                                 \
+    hip_mpitest_largecount_free (&_ltype, _type);                                    \
+    return _ret;                                                                     \
+}
+#endif
+
+static inline int hip_mpitest_send (const void *buf, long count, MPI_Datatype type, int dest,
+                                    int tag, MPI_Comm comm)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Send, buf, count, type, dest, tag, comm);
+}
+
+static inline int hip_mpitest_ssend (const void *buf, long count, MPI_Datatype type, int dest,
+                                     int tag, MPI_Comm comm)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Ssend, buf, count, type, dest, tag, comm);
+}
+
+static inline int hip_mpitest_bsend (const void *buf, long count, MPI_Datatype type, int dest,
+                                     int tag, MPI_Comm comm)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Bsend, buf, count, type, dest, tag, comm);
+}
+
+static inline int hip_mpitest_recv (void *buf, long count, MPI_Datatype type, int source, int tag,
+                                    MPI_Comm comm, MPI_Status *status)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Recv, buf, count, type, source, tag, comm, status);
+}
+
+static inline int hip_mpitest_isend (const void *buf, long count, MPI_Datatype type, int dest,
+                                     int tag, MPI_Comm comm, MPI_Request *req)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Isend, buf, count, type, dest, tag, comm, req);
+}
+
+static inline int hip_mpitest_irecv (void *buf, long count, MPI_Datatype type, int source, int tag,
+                                     MPI_Comm comm, MPI_Request *req)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Irecv, buf, count, type, source, tag, comm, req);
+}
+
+static inline int hip_mpitest_send_init (const void *buf, long count, MPI_Datatype type, int dest,
+                                         int tag, MPI_Comm comm, MPI_Request *req)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Send_init, buf, count, type, dest, tag, comm, req);
+}
+
+static inline int hip_mpitest_recv_init (void *buf, long count, MPI_Datatype type, int source,
+                                         int tag, MPI_Comm comm, MPI_Request *req)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Recv_init, buf, count, type, source, tag, comm, req);
+}
+
+static inline int hip_mpitest_bcast (void *buf, long count, MPI_Datatype type, int root,
+                                     MPI_Comm comm)
+{
+    HIP_MPITEST_LARGECOUNT_CALL(MPI_Bcast, buf, count, type, root, comm);
+}
+
+// Size of the buffer to attach for a buffered send of count elements.
+// Without the large-count variants the buffer is limited to INT_MAX bytes.
+static inline int hip_mpitest_bsend_size (long count, MPI_Datatype type, MPI_Comm comm, long *size)
+{
+#ifdef HIP_MPITEST_HAVE_MPI_COUNT
+    MPI_Count psize;
+    int ret = MPI_Pack_size_c ((MPI_Count)count, type, comm, &psize);
+#else
+    int psize;
+    int ret;
+
+    if (count > INT_MAX) {
+        return MPI_ERR_COUNT;
+    }
+    ret = MPI_Pack_size ((int)count, type, comm, &psize);
+#endif
+    *size = (long)psize + MPI_BSEND_OVERHEAD;
+    return ret;
+}
+
+static inline int hip_mpitest_buffer_attach (void *buf, long size)
+{
+#ifdef HIP_MPITEST_HAVE_MPI_COUNT
+    return MPI_Buffer_attach_c (buf, (MPI_Count)size);
+#else
+    if (size > INT_MAX) {
+        return MPI_ERR_BUFFER;
+    }
+    return MPI_Buffer_attach (buf, (int)size);
+#endif
+}
+
+static inline int hip_mpitest_buffer_detach ()
+{
+    void *buf;
+#ifdef HIP_MPITEST_HAVE_MPI_COUNT
+    MPI_Count size;
+    return MPI_Buffer_detach_c (&buf, &size);
+#else
+    int size;
+    return MPI_Buffer_detach (&buf, &size);
+#endif
+}
+
+// Predefined reduction operations are not defined on derived datatypes,
+// hence the fallback reduces at most INT_MAX elements at a time.
+static inline int hip_mpitest_reduce_op (const void *sbuf, void *rbuf, long count,
+                                         MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm,
+                                         bool all)
+{
+#ifdef HIP_MPITEST_HAVE_MPI_COUNT
+    if (all) {
+        return MPI_Allreduce_c (sbuf, rbuf, (MPI_Count)count, type, op, comm);
+    }
+    return MPI_Reduce_c (sbuf, rbuf, (MPI_Count)count, type, op, root, comm);
+#else
+    MPI_Aint lb, extent;
+    long done=0;
+    int ret=MPI_SUCCESS;
+
+    MPI_Type_get_extent (type, &lb, &extent);
+    do {
+        int n = (count - done) < INT_MAX ? (int)(count - done) : INT_MAX;
+        const void *s = sbuf == MPI_IN_PLACE ? sbuf : (const char *)sbuf + done * extent;
+        void *r = rbuf == NULL ? rbuf : (char *)rbuf + done * extent;
+
+        if (all) {
+            ret = MPI_Allreduce (s, r, n, type, op, comm);
+        }
+        else {
+            ret = MPI_Reduce (s, r, n, type, op, root, comm);
+        }
+        done += n;
+    } while (MPI_SUCCESS == ret && done < count);
+    return ret;
+#endif
+}
+
+static inline int hip_mpitest_allreduce (const void *sbuf, void *rbuf, long count,
+                                         MPI_Datatype type, MPI_Op op, MPI_Comm comm)
+{
+    return hip_mpitest_reduce_op (sbuf, rbuf, count, type, op, 0, comm, true);
+}
+
+static inline int hip_mpitest_reduce (const void *sbuf, void *rbuf, long count, MPI_Datatype type,
+                                      MPI_Op op, int root, MPI_Comm comm)
+{
+    return hip_mpitest_reduce_op (sbuf, rbuf, count, type, op, root, comm, false);
+}
+
+#endif // __HIP_MPITEST_LARGECOUNT__
@@ -0,0 +1,277 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_LAYOUT__
+#define __HIP_MPITEST_LAYOUT__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <hip/hip_runtime.h>
+#include "mpi.h"
+#include "hip_mpitest_buffer.h"
+
+// Placement of the data exchanged with each peer in the multi-peer tests
+//    slab:     consecutive slices of one allocation
+//    per-peer: one allocation per peer, scattered across memory
+//    region:   slices separated by at least one page within one allocation
+enum HIP_MPITEST_LAYOUT {
+      HIP_MPITEST_LAYOUT_SLAB=0,
+      HIP_MPITEST_LAYOUT_PEER,
+      HIP_MPITEST_LAYOUT_REGION,
+      HIP_MPITEST_LAYOUT_LAST
+};
+
+const char *const hip_mpitest_layout_names[HIP_MPITEST_LAYOUT_LAST] = {
+    "slab", "per-peer", "region"};
+
+// Set through the --layout option
+static int  hip_mpitest_layout        = HIP_MPITEST_LAYOUT_SLAB;
+static bool hip_mpitest_layout_report = false;
+
+static bool hip_mpitest_layout_parse (const char *arg)
+{
+    for (int i=0; i<HIP_MPITEST_LAYOUT_LAST; i++) {
+        if (strcmp(arg, hip_mpitest_layout_names[i]) == 0) {
+            hip_mpitest_layout        = i;
+            hip_mpitest_layout_report = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+// count elements of type T for each of npeers peers, placed according
+// to a layout. The generation and verification hooks have the same form
+// as the ones of hip_mpitest_typed_buffer, with the elements of peer p
+// starting at element p*count.
+template <typename T>
+class hip_mpitest_peer_buffer {
+ private:
+    hip_mpitest_buffer  *membuf;
+    hip_mpitest_buffer **peers;    // per-peer layout only, peers[0] is membuf
+    int                  layout;
+    int                  npeers;
+    long                 count;
+    size_t               stride;   // distance of the slices in bytes
+
+    template <typename Gen>
+    struct fill_arg {
+        Gen  *gen;
+        long  first;
+    };
+
+    template <typename Gen>
+    static void FillSlice (void *chunk, size_t offset, size_t nBytes, void *arg) {
+        fill_arg<Gen> *farg = (fill_arg<Gen> *)arg;
+        (*farg->gen)((T *)chunk, farg->first + (long)(offset / sizeof(T)),
+                     (long)(nBytes / sizeof(T)));
+    }
+
+    hip_mpitest_buffer *get_peer_membuf (int peer) {
+        return (HIP_MPITEST_LAYOUT_PEER == layout) ? peers[peer] : membuf;
+    }
+    size_t get_peer_offset (int peer) {
+        return (HIP_MPITEST_LAYOUT_PEER == layout) ? 0 : peer * stride;
+    }
+
+ public:
+    hip_mpitest_peer_buffer () : membuf(NULL), peers(NULL), layout(HIP_MPITEST_LAYOUT_SLAB),
+                                 npeers(0), count(0), stride(0) {}
+
+    hip_mpitest_peer_buffer (const hip_mpitest_peer_buffer &) = delete;
+    hip_mpitest_peer_buffer &operator= (const hip_mpitest_peer_buffer &) = delete;
+
+    ~hip_mpitest_peer_buffer () {
+        Free();
+    }
+
+    // Buffers of the other peers in the per-peer layout are of the
+    // memory type and placement of buf
+    hipError_t Allocate (hip_mpitest_buffer *buf, int num_peers, long nelems, int buf_layout) {
+        long   pagesize = sysconf(_SC_PAGESIZE);
+        size_t bytes    = nelems * sizeof(T);
+        hipError_t err;
+
+        Free();
+        if (NULL == buf) {
+            return hipErrorInvalidValue;
+        }
+        membuf = buf;
+        layout = buf_layout;
+        npeers = num_peers;
+        count  = nelems;
+        stride = bytes;
+        if (HIP_MPITEST_LAYOUT_REGION == layout) {
+            stride = ((bytes + pagesize - 1) / pagesize + 1) * pagesize;
+        }
+        if (HIP_MPITEST_LAYOUT_PEER != layout) {
+            return membuf->Allocate(npeers * stride);
+        }
+
+        peers = (hip_mpitest_buffer **) calloc (npeers, sizeof(hip_mpitest_buffer *));
+        if (NULL == peers) {
+            return hipErrorMemoryAllocation;
+        }
+        peers[0] = membuf;
+        for (int i=1; i<npeers; i++) {
+            peers[i] = hip_mpitest_buffer_create(membuf->get_memchar());
+            if (NULL == peers[i]) {
+                return hipErrorInvalidValue;
+            }
+            peers[i]->set_offset(membuf->get_offset(), membuf->get_align());
+        }
+        for (int i=0; i<npeers; i++) {
+            err = peers[i]->Allocate(bytes);
+            if (hipSuccess != err) {
+                return err;
+            }
+        }
+        return hipSuccess;
+    }
+
+    hipError_t Free () {
+        hipError_t err = hipSuccess, lerr;
+
+        if (NULL != peers) {
+            for (int i=0; i<npeers; i++) {
+                if (NULL == peers[i]) {
+                    continue;
+                }
+                lerr = peers[i]->Free();
+                if (hipSuccess != lerr) {
+                    err = lerr;
+                }
+                if (i > 0) {
+                    delete (peers[i]);
+                }
+            }
+            free(peers);
+        }
+        else if (NULL != membuf) {
+            err = membuf->Free();
+        }
+        membuf = NULL;
+        peers  = NULL;
+        npeers = 0;
+        count  = 0;
+        return err;
+    }
+
+    T *get_slice (int peer) {
+        return (T *)((char *)get_peer_membuf(peer)->get_buffer() + get_peer_offset(peer));
+    }
+    int get_layout () {
+        return layout;
+    }
+
+    template <typename Gen>
+    hipError_t Generate (Gen gen) {
+        hipError_t err = hipSuccess;
+
+        for (int p=0; p<npeers && hipSuccess == err; p++) {
+            fill_arg<Gen> farg = {&gen, p * count};
+            err = get_peer_membuf(p)->Fill(FillSlice<Gen>, &farg, count * sizeof(T),
+                                           get_peer_offset(p));
+        }
+        return err;
+    }
+
+    template <typename Check>
+    bool Verify (Check check) {
+        bool res = true;
+        T *host;
+
+        if (!membuf->NeedsStagingBuffer()) {
+            for (int p=0; p<npeers; p++) {
+                res &= check(get_slice(p), p * count, count);
+            }
+            return res;
+        }
+        host = (T *) malloc (count * sizeof(T));
+        if (NULL == host) {
+            return false;
+        }
+        for (int p=0; p<npeers && res; p++) {
+            if (hipSuccess != get_peer_membuf(p)->CopyFrom(host, count * sizeof(T),
+                                                           get_peer_offset(p))) {
+                res = false;
+                break;
+            }
+            res &= check(host, p * count, count);
+        }
+        free(host);
+        return res;
+    }
+
+    // Datatypes describing the slice of each peer by its absolute address,
+    // for collective operations on MPI_BOTTOM
+    int CreateTypes (MPI_Datatype datatype, MPI_Datatype *types) {
+        int blen = (int)count;
+        int ret = MPI_SUCCESS;
+        MPI_Aint addr;
+
+        for (int p=0; p<npeers && MPI_SUCCESS == ret; p++) {
+            ret = MPI_Get_address (get_slice(p), &addr);
+            if (MPI_SUCCESS == ret) {
+                ret = MPI_Type_create_hindexed (1, &blen, &addr, datatype, &types[p]);
+            }
+            if (MPI_SUCCESS == ret) {
+                ret = MPI_Type_commit (&types[p]);
+            }
+        }
+        return ret;
+    }
+};
+
+static inline void hip_mpitest_free_types (MPI_Datatype *types, int ntypes)
+{
+    for (int i=0; i<ntypes; i++) {
+        if (MPI_DATATYPE_NULL != types[i]) {
+            MPI_Type_free (&types[i]);
+        }
+    }
+}
+
+// Reports the time of the first operation, which includes registering
+// the buffers, and the average time of the subsequent operations
+static inline void hip_mpitest_layout_report_time (MPI_Comm comm, int npeers, double tfirst,
+                                                   double tavg)
+{
+    double t[2] = {tfirst, tavg}, tmax[2];
+    int rank;
+
+    if (!hip_mpitest_layout_report) {
+        return;
+    }
+    MPI_Comm_rank (comm, &rank);
+    MPI_Reduce (t, tmax, 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (rank == 0) {
+        printf("   Layout %s with %d peers: first operation %lf usec, subsequent operations "
+               "%lf usec\n", hip_mpitest_layout_names[hip_mpitest_layout], npeers,
+               tmax[0] * 1e6, tmax[1] * 1e6);
+    }
+}
+
+#endif // __HIP_MPITEST_LAYOUT__
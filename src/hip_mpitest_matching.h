@@ -0,0 +1,221 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_MATCHING__
+#define __HIP_MPITEST_MATCHING__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "mpi.h"
+
+// Ways the receiver drains the unexpected messages
+//    specific:   source and tag given, tags and sources in reverse order
+//    any-source: MPI_ANY_SOURCE, tags in reverse order
+//    any-tag:    MPI_ANY_TAG, sources in reverse order
+//    any:        MPI_ANY_SOURCE and MPI_ANY_TAG
+//    mprobe:     MPI_Mprobe with MPI_ANY_SOURCE and MPI_ANY_TAG, MPI_Mrecv
+//    improbe:    MPI_Improbe polled with MPI_ANY_SOURCE, tags in reverse
+//                order, MPI_Imrecv
+enum HIP_MPITEST_MATCH {
+      HIP_MPITEST_MATCH_SPECIFIC=0,
+      HIP_MPITEST_MATCH_ANY_SOURCE,
+      HIP_MPITEST_MATCH_ANY_TAG,
+      HIP_MPITEST_MATCH_ANY,
+      HIP_MPITEST_MATCH_MPROBE,
+      HIP_MPITEST_MATCH_IMPROBE,
+      HIP_MPITEST_MATCH_LAST
+};
+
+const char *const hip_mpitest_match_names[HIP_MPITEST_MATCH_LAST] = {
+    "specific", "any-source", "any-tag", "any", "mprobe", "improbe"};
+
+// Every sender sends depth messages, message j with tag j % ntags. The
+// elements of a message hold a value unique to the sender, tag and the
+// sequence number of the message among the ones with that tag.
+static int hip_mpitest_match_value (int src, int tag, int seq, int depth, int ntags)
+{
+    return src * depth + seq * ntags + tag + 1;
+}
+
+// Number of messages with tag among depth messages of a sender
+static int hip_mpitest_match_pertag (int tag, int depth, int ntags)
+{
+    return (depth - tag + ntags - 1) / ntags;
+}
+
+// Posts the depth messages of count elements of a sender, message j
+// starting at element j*count of sbuf
+static int hip_mpitest_match_flood (int *sbuf, long count, int root, int depth, int ntags,
+                                    MPI_Comm comm, MPI_Request *reqs)
+{
+    int ret = MPI_SUCCESS;
+
+    for (int j=0; j<depth && MPI_SUCCESS == ret; j++) {
+        ret = MPI_Isend (sbuf + j * count, count, MPI_INT, root, j % ntags, comm, &reqs[j]);
+    }
+    return ret;
+}
+
+// Receives the depth messages of every other process in the given mode,
+// message i into element i*count of rbuf. The source and tag of message
+// i are returned in sources[i] and tags[i].
+static int hip_mpitest_match_drain (int mode, int *rbuf, long count, int root, int depth,
+                                    int ntags, MPI_Comm comm, int *sources, int *tags)
+{
+    int nprocs, ret=MPI_SUCCESS;
+    long i=0;
+    MPI_Status status;
+    MPI_Message msg;
+    MPI_Request req;
+    int flag;
+
+    MPI_Comm_size (comm, &nprocs);
+
+    // receives one message into slot i and records its envelope
+    auto recv = [&](int src, int tag) {
+        ret = MPI_Recv (rbuf + i * count, count, MPI_INT, src, tag, comm, &status);
+        sources[i] = status.MPI_SOURCE;
+        tags[i++]  = status.MPI_TAG;
+    };
+
+    switch (mode) {
+    case HIP_MPITEST_MATCH_SPECIFIC :
+        for (int tag=ntags-1; tag>=0 && MPI_SUCCESS == ret; tag--) {
+            for (int src=nprocs-1; src>=0 && MPI_SUCCESS == ret; src--) {
+                for (int k=0; src != root && k<hip_mpitest_match_pertag(tag, depth, ntags) &&
+                         MPI_SUCCESS == ret; k++) {
+                    recv (src, tag);
+                }
+            }
+        }
+        break;
+    case HIP_MPITEST_MATCH_ANY_SOURCE :
+        for (int tag=ntags-1; tag>=0 && MPI_SUCCESS == ret; tag--) {
+            for (int k=0; k<(nprocs-1)*hip_mpitest_match_pertag(tag, depth, ntags) &&
+                     MPI_SUCCESS == ret; k++) {
+                recv (MPI_ANY_SOURCE, tag);
+            }
+        }
+        break;
+    case HIP_MPITEST_MATCH_ANY_TAG :
+        for (int src=nprocs-1; src>=0 && MPI_SUCCESS == ret; src--) {
+            for (int k=0; src != root && k<depth && MPI_SUCCESS == ret; k++) {
+                recv (src, MPI_ANY_TAG);
+            }
+        }
+        break;
+    case HIP_MPITEST_MATCH_ANY :
+        for (long k=0; k<(long)(nprocs-1)*depth && MPI_SUCCESS == ret; k++) {
+            recv (MPI_ANY_SOURCE, MPI_ANY_TAG);
+        }
+        break;
+    case HIP_MPITEST_MATCH_MPROBE :
+        for (long k=0; k<(long)(nprocs-1)*depth && MPI_SUCCESS == ret; k++) {
+            ret = MPI_Mprobe (MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &msg, &status);
+            if (MPI_SUCCESS == ret) {
+                sources[i] = status.MPI_SOURCE;
+                tags[i]    = status.MPI_TAG;
+                ret = MPI_Mrecv (rbuf + i * count, count, MPI_INT, &msg, MPI_STATUS_IGNORE);
+                i++;
+            }
+        }
+        break;
+    case HIP_MPITEST_MATCH_IMPROBE :
+        for (int tag=ntags-1; tag>=0 && MPI_SUCCESS == ret; tag--) {
+            for (int k=0; k<(nprocs-1)*hip_mpitest_match_pertag(tag, depth, ntags) &&
+                     MPI_SUCCESS == ret; k++) {
+                flag = 0;
+                while (!flag && MPI_SUCCESS == ret) {
+                    ret = MPI_Improbe (MPI_ANY_SOURCE, tag, comm, &flag, &msg, &status);
+                }
+                if (MPI_SUCCESS == ret) {
+                    sources[i] = status.MPI_SOURCE;
+                    tags[i]    = status.MPI_TAG;
+                    ret = MPI_Imrecv (rbuf + i * count, count, MPI_INT, &msg, &req);
+                    i++;
+                }
+                if (MPI_SUCCESS == ret) {
+                    ret = MPI_Wait (&req, MPI_STATUS_IGNORE);
+                }
+            }
+        }
+        break;
+    }
+    return ret;
+}
+
+// Expected value of every message received, derived from the envelopes
+// in the order of reception. Messages of the same sender and tag have to
+// arrive in the order they were sent.
+static void hip_mpitest_match_expected (int nmsgs, const int *sources, const int *tags,
+                                        int nprocs, int depth, int ntags, int *expected)
+{
+    std::vector<int> seq((size_t)nprocs * ntags, 0);
+
+    for (int i=0; i<nmsgs; i++) {
+        if (sources[i] < 0 || sources[i] >= nprocs || tags[i] < 0 || tags[i] >= ntags) {
+            expected[i] = -1;
+            continue;
+        }
+        expected[i] = hip_mpitest_match_value(sources[i], tags[i],
+                                              seq[(size_t)sources[i] * ntags + tags[i]]++,
+                                              depth, ntags);
+    }
+}
+
+// Message j of count elements carries the value of tag j % ntags and
+// sequence number j / ntags of process rank
+static void hip_mpitest_match_init_sendbuf (int *sendbuf, long first, long n, int rank,
+                                            long count, int depth, int ntags)
+{
+    for (long i = 0; i < n; i++) {
+        int j = (int)((first + i) / count);
+        sendbuf[i] = hip_mpitest_match_value(rank, j % ntags, j / ntags, depth, ntags);
+    }
+}
+
+static void hip_mpitest_match_init_recvbuf (int *recvbuf, long first, long n)
+{
+    for (long i = 0; i < n; i++) {
+        recvbuf[i] = 0;
+    }
+}
+
+// Message i of count elements has to hold expected[i]
+static bool hip_mpitest_match_check_recvbuf (const int *recvbuf, long first, long n, long count,
+                                             const int *expected)
+{
+    for (long i = 0; i < n; i++) {
+        if (recvbuf[i] != expected[(first + i) / count]) {
+#ifdef VERBOSE
+            printf("recvbuf[%ld] = %d expected %d\n", first + i, recvbuf[i],
+                   expected[(first + i) / count]);
+#endif
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // __HIP_MPITEST_MATCHING__
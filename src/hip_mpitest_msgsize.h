@@ -0,0 +1,214 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_MSGSIZE__
+#define __HIP_MPITEST_MSGSIZE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+// Distribution of the number of elements of each message of the
+// randomized stress tests, between 1 and the number of elements given
+// with -n
+//    fixed:      every message has -n elements
+//    loguniform: the logarithm of the size is uniformly distributed
+//    bimodal:    small control messages of up to HIP_MPITEST_MSGSIZE_SMALL
+//                elements mixed with payloads of -n/2 to -n elements
+//    trace:      sizes drawn from a file, one size per line
+enum HIP_MPITEST_MSGSIZE {
+      HIP_MPITEST_MSGSIZE_FIXED=0,
+      HIP_MPITEST_MSGSIZE_LOGUNIFORM,
+      HIP_MPITEST_MSGSIZE_BIMODAL,
+      HIP_MPITEST_MSGSIZE_TRACE,
+      HIP_MPITEST_MSGSIZE_LAST
+};
+
+const char *const hip_mpitest_msgsize_names[HIP_MPITEST_MSGSIZE_LAST] = {
+    "fixed", "loguniform", "bimodal", "trace"};
+
+#define HIP_MPITEST_MSGSIZE_SMALL 16
+
+// Set through the --msg-sizes and --msg-size-seed options
+static int      hip_mpitest_msgsize_dist  = HIP_MPITEST_MSGSIZE_FIXED;
+static int      hip_mpitest_msgsize_small = 90;    // bimodal: percentage of small messages
+static unsigned hip_mpitest_msgsize_seed  = 1;
+static long    *hip_mpitest_msgsize_trace = NULL;
+static long     hip_mpitest_msgsize_ntrace = 0;
+static char     hip_mpitest_msgsize_file[256];
+
+// Sizes of a trace file in elements, one per line. Empty lines and lines
+// starting with # are skipped.
+static inline bool hip_mpitest_msgsize_read_trace (const char *path)
+{
+    char line[256];
+    long n=0, max=0;
+    FILE *fp = fopen(path, "r");
+
+    if (NULL == fp) {
+        printf("hip_mpitest_msgsize: could not open %s\n", path);
+        return false;
+    }
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        char *end;
+        long val;
+
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        val = strtol(line, &end, 10);
+        if (end == line || val < 0 || end[strspn(end, " \t\r\n")] != '\0') {
+            printf("hip_mpitest_msgsize: invalid size %s in %s\n", line, path);
+            fclose(fp);
+            return false;
+        }
+        if (n == max) {
+            long *tmp;
+            max = max > 0 ? 2 * max : 1024;
+            tmp = (long *) realloc (hip_mpitest_msgsize_trace, max * sizeof(long));
+            if (NULL == tmp) {
+                fclose(fp);
+                return false;
+            }
+            hip_mpitest_msgsize_trace = tmp;
+        }
+        hip_mpitest_msgsize_trace[n++] = val;
+    }
+    fclose(fp);
+    if (n == 0) {
+        printf("hip_mpitest_msgsize: no sizes in %s\n", path);
+        return false;
+    }
+    hip_mpitest_msgsize_ntrace = n;
+    return true;
+}
+
+// fixed, loguniform, bimodal[:percent] or trace:file
+static inline bool hip_mpitest_msgsize_parse (const char *arg)
+{
+    if (strcmp(arg, "fixed") == 0) {
+        hip_mpitest_msgsize_dist = HIP_MPITEST_MSGSIZE_FIXED;
+    }
+    else if (strcmp(arg, "loguniform") == 0) {
+        hip_mpitest_msgsize_dist = HIP_MPITEST_MSGSIZE_LOGUNIFORM;
+    }
+    else if (strncmp(arg, "bimodal", 7) == 0 && (arg[7] == '\0' || arg[7] == ':')) {
+        if (arg[7] == ':') {
+            char *end;
+            long val = strtol(arg+8, &end, 10);
+            if (arg[8] == '\0' || *end != '\0' || val < 0 || val > 100) {
+                return false;
+            }
+            hip_mpitest_msgsize_small = (int)val;
+        }
+        hip_mpitest_msgsize_dist = HIP_MPITEST_MSGSIZE_BIMODAL;
+    }
+    else if (strncmp(arg, "trace:", 6) == 0 && arg[6] != '\0') {
+        if (!hip_mpitest_msgsize_read_trace(arg+6)) {
+            return false;
+        }
+        snprintf(hip_mpitest_msgsize_file, sizeof(hip_mpitest_msgsize_file), "%s", arg+6);
+        hip_mpitest_msgsize_dist = HIP_MPITEST_MSGSIZE_TRACE;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+static inline void hip_mpitest_msgsize_print (void)
+{
+    switch (hip_mpitest_msgsize_dist) {
+    case HIP_MPITEST_MSGSIZE_BIMODAL:
+        printf("   Message sizes bimodal, %d%% of up to %d elements", hip_mpitest_msgsize_small,
+               HIP_MPITEST_MSGSIZE_SMALL);
+        break;
+    case HIP_MPITEST_MSGSIZE_TRACE:
+        printf("   Message sizes from %s, %ld entries", hip_mpitest_msgsize_file,
+               hip_mpitest_msgsize_ntrace);
+        break;
+    default:
+        printf("   Message sizes %s", hip_mpitest_msgsize_names[hip_mpitest_msgsize_dist]);
+        break;
+    }
+    printf(", seed %u\n", hip_mpitest_msgsize_seed);
+}
+
+// splitmix64, a cheap generator of well mixed 64 bit values
+static inline uint64_t hip_mpitest_msgsize_mix (uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x  = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x  = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Number of elements of the message sent from src to dst in iteration,
+// at most max. Computed from the arguments and the seed only, such that
+// sender and receiver agree on the size without communicating.
+static inline long hip_mpitest_msgsize_get (long max, long iteration, int src, int dst)
+{
+    uint64_t r;
+    double u;
+    long n;
+
+    if (HIP_MPITEST_MSGSIZE_FIXED == hip_mpitest_msgsize_dist || max <= 1) {
+        return max;
+    }
+    r = hip_mpitest_msgsize_mix (hip_mpitest_msgsize_seed);
+    r = hip_mpitest_msgsize_mix (r ^ (uint64_t)iteration);
+    r = hip_mpitest_msgsize_mix (r ^ (((uint64_t)(unsigned)src << 32) | (unsigned)dst));
+    // uniform in [0,1) from the upper 53 bits
+    u = (double)(r >> 11) / (double)(1ULL << 53);
+
+    switch (hip_mpitest_msgsize_dist) {
+    case HIP_MPITEST_MSGSIZE_LOGUNIFORM:
+        n = (long)exp(u * log((double)max + 1.0));
+        break;
+    case HIP_MPITEST_MSGSIZE_BIMODAL: {
+        long small = max < HIP_MPITEST_MSGSIZE_SMALL ? max : HIP_MPITEST_MSGSIZE_SMALL;
+        uint64_t r2 = hip_mpitest_msgsize_mix (r);
+        if ((long)(r2 % 100) < hip_mpitest_msgsize_small) {
+            n = 1 + (long)(u * small);
+        }
+        else {
+            n = max / 2 + (long)(u * (max - max / 2 + 1));
+        }
+        break;
+    }
+    case HIP_MPITEST_MSGSIZE_TRACE:
+        n = hip_mpitest_msgsize_trace[(long)(u * hip_mpitest_msgsize_ntrace)];
+        break;
+    default:
+        n = max;
+        break;
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    return n > max ? max : n;
+}
+
+#endif // __HIP_MPITEST_MSGSIZE__
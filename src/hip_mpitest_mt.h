@@ -0,0 +1,136 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_MT__
+#define __HIP_MPITEST_MT__
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include "mpi.h"
+
+// Separation of the traffic of the threads: an own tag on a shared
+// communicator or an own duplicate of the communicator
+enum HIP_MPITEST_MT_MODE {
+      HIP_MPITEST_MT_TAG=0,
+      HIP_MPITEST_MT_COMM,
+      HIP_MPITEST_MT_LAST
+};
+
+const char *const hip_mpitest_mt_names[HIP_MPITEST_MT_LAST] = {"tag", "comm"};
+
+// Work of one thread: niter exchanges of window messages of count
+// elements each with the thread of the same index on process peer.
+// Message w is sent from and received into element w*count of the
+// thread's buffers.
+struct hip_mpitest_mt_ctx {
+    int          thread;
+    int          peer;
+    MPI_Comm     comm;
+    int          tag;
+    void        *sbuf;
+    void        *rbuf;
+    MPI_Datatype datatype;
+    long         count;
+    int          window;
+    int          niter;
+    int          ret;
+    double       time;
+};
+
+// Initializes MPI with MPI_THREAD_MULTIPLE, returns false if the library
+// provides a lower thread level
+static bool hip_mpitest_mt_init (int *argc, char ***argv)
+{
+    int provided;
+
+    MPI_Init_thread (argc, argv, MPI_THREAD_MULTIPLE, &provided);
+    return MPI_THREAD_MULTIPLE == provided;
+}
+
+// Communicator and tag of thread t. In comm mode, comms[t] has to be
+// a duplicate of comm created by MPI_Comm_dup on all processes.
+static void hip_mpitest_mt_setup (hip_mpitest_mt_ctx *ctx, int t, int mode, MPI_Comm comm,
+                                  MPI_Comm *comms, int basetag)
+{
+    ctx->thread = t;
+    ctx->comm   = (HIP_MPITEST_MT_COMM == mode) ? comms[t] : comm;
+    ctx->tag    = (HIP_MPITEST_MT_COMM == mode) ? basetag : basetag + t;
+    ctx->ret    = MPI_SUCCESS;
+    ctx->time   = 0.0;
+}
+
+static void hip_mpitest_mt_exchange (hip_mpitest_mt_ctx *ctx)
+{
+    std::chrono::high_resolution_clock::time_point ts, te;
+    std::vector<MPI_Request> reqs(2 * ctx->window);
+    MPI_Aint lb, extent;
+    int ret;
+
+    MPI_Type_get_extent (ctx->datatype, &lb, &extent);
+    // Start at the same time as the peer thread
+    ret = MPI_Sendrecv (NULL, 0, MPI_CHAR, ctx->peer, ctx->tag, NULL, 0, MPI_CHAR, ctx->peer,
+                        ctx->tag, ctx->comm, MPI_STATUS_IGNORE);
+
+    ts = std::chrono::high_resolution_clock::now();
+    for (int iter=0; iter<ctx->niter && MPI_SUCCESS == ret; iter++) {
+        for (int w=0; w<ctx->window && MPI_SUCCESS == ret; w++) {
+            char *rbuf = (char *)ctx->rbuf + w * ctx->count * extent;
+            ret = MPI_Irecv (rbuf, ctx->count, ctx->datatype, ctx->peer, ctx->tag, ctx->comm,
+                             &reqs[2*w]);
+            if (MPI_SUCCESS == ret) {
+                char *sbuf = (char *)ctx->sbuf + w * ctx->count * extent;
+                ret = MPI_Isend (sbuf, ctx->count, ctx->datatype, ctx->peer, ctx->tag, ctx->comm,
+                                 &reqs[2*w+1]);
+            }
+        }
+        if (MPI_SUCCESS == ret) {
+            ret = MPI_Waitall (2 * ctx->window, reqs.data(), MPI_STATUSES_IGNORE);
+        }
+    }
+    te = std::chrono::high_resolution_clock::now();
+    ctx->time = std::chrono::duration<double>(te-ts).count();
+    ctx->ret  = ret;
+}
+
+// Executes the exchanges of nthreads threads concurrently and returns
+// the first error encountered
+static int hip_mpitest_mt_run (hip_mpitest_mt_ctx *ctx, int nthreads)
+{
+    std::vector<std::thread> threads;
+    int ret = MPI_SUCCESS;
+
+    for (int t=0; t<nthreads; t++) {
+        threads.push_back(std::thread(hip_mpitest_mt_exchange, &ctx[t]));
+    }
+    for (int t=0; t<nthreads; t++) {
+        threads[t].join();
+        if (MPI_SUCCESS == ret) {
+            ret = ctx[t].ret;
+        }
+    }
+    return ret;
+}
+
+#endif // __HIP_MPITEST_MT__
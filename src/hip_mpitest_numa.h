@@ -0,0 +1,289 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_NUMA__
+#define __HIP_MPITEST_NUMA__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+
+// The memory policy system calls are used directly, such that the
+// testsuite does not depend on libnuma.
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT    0
+#define MPOL_PREFERRED  1
+#define MPOL_BIND       2
+#define MPOL_INTERLEAVE 3
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE    (1<<1)
+#endif
+#ifndef MPOL_F_MEMS_ALLOWED
+#define MPOL_F_MEMS_ALLOWED (1<<2)
+#endif
+
+#define HIP_MPITEST_NUMA_MAXNODE 1024
+#define HIP_MPITEST_NUMA_MASKLEN (HIP_MPITEST_NUMA_MAXNODE / (8*sizeof(unsigned long)))
+
+// Maximum number of pages checked when reporting the placement of a buffer
+#define HIP_MPITEST_NUMA_SAMPLES 4096
+
+enum HIP_MPITEST_NUMA_POLICY {
+      HIP_MPITEST_NUMA_NONE=0,
+      HIP_MPITEST_NUMA_LOCAL,
+      HIP_MPITEST_NUMA_NODE,
+      HIP_MPITEST_NUMA_INTERLEAVE,
+      HIP_MPITEST_NUMA_NICLOCAL,
+      HIP_MPITEST_NUMA_LAST
+};
+
+const char *const hip_mpitest_numa_policy_names[HIP_MPITEST_NUMA_LAST] = {
+    "first-touch", "local", "node", "interleave", "nic-local"};
+
+// Set through the --numa option. Only applies to host memory types. The
+// placement of host buffers is reported whenever the option is given.
+static int  hip_mpitest_numa_policy = HIP_MPITEST_NUMA_NONE;
+static int  hip_mpitest_numa_node   = -1;
+static bool hip_mpitest_numa_report = false;
+
+static bool hip_mpitest_numa_parse (const char *arg)
+{
+    hip_mpitest_numa_report = true;
+    if (strcmp(arg, "first-touch") == 0) {
+        hip_mpitest_numa_policy = HIP_MPITEST_NUMA_NONE;
+    }
+    else if (strcmp(arg, "local") == 0) {
+        hip_mpitest_numa_policy = HIP_MPITEST_NUMA_LOCAL;
+    }
+    else if (strncmp(arg, "node:", 5) == 0 && arg[5] != '\0') {
+        char *end;
+        hip_mpitest_numa_node = (int)strtol(arg+5, &end, 10);
+        if (*end != '\0' || hip_mpitest_numa_node < 0 ||
+            hip_mpitest_numa_node >= HIP_MPITEST_NUMA_MAXNODE) {
+            return false;
+        }
+        hip_mpitest_numa_policy = HIP_MPITEST_NUMA_NODE;
+    }
+    else if (strcmp(arg, "interleave") == 0) {
+        hip_mpitest_numa_policy = HIP_MPITEST_NUMA_INTERLEAVE;
+    }
+    else if (strcmp(arg, "nic-local") == 0) {
+        hip_mpitest_numa_policy = HIP_MPITEST_NUMA_NICLOCAL;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+static int hip_mpitest_numa_read_node (const char *path)
+{
+    int node = -1;
+    FILE *fp = fopen(path, "r");
+    if (NULL != fp) {
+        if (fscanf(fp, "%d", &node) != 1) {
+            node = -1;
+        }
+        fclose(fp);
+    }
+    return node;
+}
+
+// NUMA node of the network device used for communication. The device is
+// taken from UCX_NET_DEVICES if set, otherwise the first InfiniBand
+// device is used.
+static int hip_mpitest_numa_nic_node ()
+{
+    char path[512], dev[256]="";
+    char *env = getenv("UCX_NET_DEVICES");
+
+    if (NULL != env && strcmp(env, "all") != 0) {
+        snprintf(dev, sizeof(dev), "%s", env);
+        dev[strcspn(dev, ":,")] = '\0';
+    }
+    else {
+        DIR *dir = opendir("/sys/class/infiniband");
+        if (NULL != dir) {
+            struct dirent *de;
+            while (NULL != (de = readdir(dir))) {
+                if (de->d_name[0] != '.') {
+                    snprintf(dev, sizeof(dev), "%s", de->d_name);
+                    break;
+                }
+            }
+            closedir(dir);
+        }
+    }
+    if (dev[0] == '\0') {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "/sys/class/infiniband/%s/device/numa_node", dev);
+    int node = hip_mpitest_numa_read_node(path);
+    if (node < 0) {
+        snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", dev);
+        node = hip_mpitest_numa_read_node(path);
+    }
+    return node;
+}
+
+static int hip_mpitest_numa_local_node ()
+{
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return -1;
+    }
+    return (int)node;
+}
+
+// Build the node mask of the selected policy. Returns the mode for
+// mbind/set_mempolicy, or MPOL_DEFAULT if no policy is to be applied.
+static int hip_mpitest_numa_mask (unsigned long *mask)
+{
+    int node = -1;
+    static bool warned = false;
+
+    memset(mask, 0, HIP_MPITEST_NUMA_MASKLEN * sizeof(unsigned long));
+    switch (hip_mpitest_numa_policy) {
+    case HIP_MPITEST_NUMA_INTERLEAVE:
+        if (syscall(SYS_get_mempolicy, NULL, mask, HIP_MPITEST_NUMA_MAXNODE, NULL,
+                    MPOL_F_MEMS_ALLOWED) != 0) {
+            return MPOL_DEFAULT;
+        }
+        return MPOL_INTERLEAVE;
+    case HIP_MPITEST_NUMA_NODE:
+        node = hip_mpitest_numa_node;
+        break;
+    case HIP_MPITEST_NUMA_NICLOCAL:
+        node = hip_mpitest_numa_nic_node();
+        if (node >= 0) {
+            break;
+        }
+        if (!warned) {
+            fprintf(stderr, "hip_mpitest_numa: NUMA node of the network device unknown, "
+                    "using the local node\n");
+            warned = true;
+        }
+        // fall through
+    case HIP_MPITEST_NUMA_LOCAL:
+        node = hip_mpitest_numa_local_node();
+        break;
+    default:
+        return MPOL_DEFAULT;
+    }
+    if (node < 0 || node >= HIP_MPITEST_NUMA_MAXNODE) {
+        return MPOL_DEFAULT;
+    }
+    mask[node / (8*sizeof(unsigned long))] |= 1UL << (node % (8*sizeof(unsigned long)));
+    return MPOL_BIND;
+}
+
+// Apply the policy to the pages of a range of memory, moving pages that
+// have already been touched.
+static int hip_mpitest_numa_bind (void *buf, size_t len)
+{
+    unsigned long mask[HIP_MPITEST_NUMA_MASKLEN];
+    long pagesize = sysconf(_SC_PAGESIZE);
+    int mode = hip_mpitest_numa_mask(mask);
+
+    if (MPOL_DEFAULT == mode || NULL == buf || 0 == len) {
+        return 0;
+    }
+    // only whole pages within the range are bound
+    uintptr_t start = ((uintptr_t)buf + pagesize - 1) & ~(uintptr_t)(pagesize - 1);
+    uintptr_t end   = ((uintptr_t)buf + len) & ~(uintptr_t)(pagesize - 1);
+    if (end <= start) {
+        return 0;
+    }
+    if (syscall(SYS_mbind, start, end - start, mode, mask, HIP_MPITEST_NUMA_MAXNODE + 1,
+                MPOL_MF_MOVE) != 0) {
+        fprintf(stderr, "hip_mpitest_numa: mbind failed %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Apply the policy to all allocations of the calling thread, for memory
+// that is populated by the allocator itself. Undone by numa_unset().
+static void hip_mpitest_numa_set ()
+{
+    unsigned long mask[HIP_MPITEST_NUMA_MASKLEN];
+    int mode = hip_mpitest_numa_mask(mask);
+
+    if (MPOL_DEFAULT != mode) {
+        syscall(SYS_set_mempolicy, mode, mask, HIP_MPITEST_NUMA_MAXNODE + 1);
+    }
+}
+
+static void hip_mpitest_numa_unset ()
+{
+    if (HIP_MPITEST_NUMA_NONE != hip_mpitest_numa_policy) {
+        syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+    }
+}
+
+// Determine the nodes holding the pages of a buffer. Sets a bit in
+// nodemask for each node found among up to HIP_MPITEST_NUMA_SAMPLES
+// pages. Returns the number of pages checked.
+static int hip_mpitest_numa_query (void *buf, size_t len, unsigned long *nodemask)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)buf & ~(uintptr_t)(pagesize - 1);
+    size_t npages = ((uintptr_t)buf + len - start + pagesize - 1) / pagesize;
+    int    nsample = npages < HIP_MPITEST_NUMA_SAMPLES ? (int)npages : HIP_MPITEST_NUMA_SAMPLES;
+    void **pages;
+    int   *status;
+
+    *nodemask = 0;
+    if (NULL == buf || 0 == len) {
+        return 0;
+    }
+    pages  = (void **) malloc (nsample * sizeof(void *));
+    status = (int *) malloc (nsample * sizeof(int));
+    if (NULL == pages || NULL == status) {
+        free (pages);
+        free (status);
+        return 0;
+    }
+    for (int i=0; i<nsample; i++) {
+        pages[i] = (void *)(start + (npages * i / nsample) * pagesize);
+    }
+    if (syscall(SYS_move_pages, 0, nsample, pages, NULL, status, 0) != 0) {
+        nsample = 0;
+    }
+    for (int i=0; i<nsample; i++) {
+        if (status[i] >= 0 && status[i] < (int)(8*sizeof(unsigned long))) {
+            *nodemask |= 1UL << status[i];
+        }
+    }
+    free (pages);
+    free (status);
+    return nsample;
+}
+
+#endif // __HIP_MPITEST_NUMA__
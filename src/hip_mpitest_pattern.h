@@ -0,0 +1,393 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_PATTERN__
+#define __HIP_MPITEST_PATTERN__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <random>
+#include "mpi.h"
+
+// Peers a process sends to and receives from in one iteration of the
+// nonblocking point-to-point tests
+//    all:     every other process
+//    ring:    send to rank+1, receive from rank-1
+//    xor:     pairwise exchange with rank ^ s, s cycling through 1 .. 2^k-1
+//    random:  send to perm[rank] of a new random permutation every iteration
+//    incast:  every process sends to the root
+//    outcast: the root sends to every process
+//    hotspot: random permutation plus every process sending to the root
+//    grid:    exchange with the nearest neighbors of a periodic k-D grid
+enum HIP_MPITEST_PATTERN {
+      HIP_MPITEST_PATTERN_ALL=0,
+      HIP_MPITEST_PATTERN_RING,
+      HIP_MPITEST_PATTERN_XOR,
+      HIP_MPITEST_PATTERN_RANDOM,
+      HIP_MPITEST_PATTERN_INCAST,
+      HIP_MPITEST_PATTERN_OUTCAST,
+      HIP_MPITEST_PATTERN_HOTSPOT,
+      HIP_MPITEST_PATTERN_GRID,
+      HIP_MPITEST_PATTERN_LAST
+};
+
+const char *const hip_mpitest_pattern_names[HIP_MPITEST_PATTERN_LAST] = {
+    "all", "ring", "xor", "random", "incast", "outcast", "hotspot", "grid"};
+
+#define HIP_MPITEST_PATTERN_MAXDIMS 8
+
+// Set through the --pattern and --pattern-seed options. -1 selects the
+// pattern the test has always used.
+static int      hip_mpitest_pattern       = -1;
+static int      hip_mpitest_pattern_root  = 0;
+static int      hip_mpitest_pattern_ndims = 2;
+static unsigned hip_mpitest_pattern_seed  = 1;
+
+// name[:n], n being the root of incast, outcast and hotspot or the
+// number of dimensions of grid
+static bool hip_mpitest_pattern_parse (const char *arg)
+{
+    const char *sep = strchr(arg, ':');
+    size_t len = (NULL != sep) ? (size_t)(sep - arg) : strlen(arg);
+
+    for (int i=0; i<HIP_MPITEST_PATTERN_LAST; i++) {
+        if (strlen(hip_mpitest_pattern_names[i]) != len ||
+            strncmp(arg, hip_mpitest_pattern_names[i], len) != 0) {
+            continue;
+        }
+        if (NULL != sep) {
+            char *end;
+            long val = strtol(sep + 1, &end, 10);
+            if (sep[1] == '\0' || *end != '\0') {
+                return false;
+            }
+            if (HIP_MPITEST_PATTERN_GRID == i) {
+                if (val < 1 || val > HIP_MPITEST_PATTERN_MAXDIMS) {
+                    return false;
+                }
+                hip_mpitest_pattern_ndims = (int)val;
+            }
+            else if (HIP_MPITEST_PATTERN_INCAST  == i || HIP_MPITEST_PATTERN_OUTCAST == i ||
+                     HIP_MPITEST_PATTERN_HOTSPOT == i) {
+                if (val < 0 || val > INT_MAX) {
+                    return false;
+                }
+                hip_mpitest_pattern_root = (int)val;
+            }
+            else {
+                return false;
+            }
+        }
+        hip_mpitest_pattern = i;
+        return true;
+    }
+    return false;
+}
+
+// Pattern selected on the command line, or the default of the test
+static int hip_mpitest_pattern_get (int default_pattern)
+{
+    return (hip_mpitest_pattern >= 0) ? hip_mpitest_pattern : default_pattern;
+}
+
+static void hip_mpitest_pattern_print (void)
+{
+    int pattern = hip_mpitest_pattern;
+
+    if (HIP_MPITEST_PATTERN_INCAST  == pattern || HIP_MPITEST_PATTERN_OUTCAST == pattern ||
+        HIP_MPITEST_PATTERN_HOTSPOT == pattern) {
+        printf("   Communication pattern %s, root %d", hip_mpitest_pattern_names[pattern],
+               hip_mpitest_pattern_root);
+    }
+    else if (HIP_MPITEST_PATTERN_GRID == pattern) {
+        printf("   Communication pattern %s, %d dimensions", hip_mpitest_pattern_names[pattern],
+               hip_mpitest_pattern_ndims);
+    }
+    else {
+        printf("   Communication pattern %s", hip_mpitest_pattern_names[pattern]);
+    }
+    if (HIP_MPITEST_PATTERN_RANDOM == pattern || HIP_MPITEST_PATTERN_HOTSPOT == pattern) {
+        printf(", seed %u", hip_mpitest_pattern_seed);
+    }
+    printf("\n");
+}
+
+// Peer schedule of one process. Generate() computes the peers of an
+// iteration from the rank, the size of the communicator and the
+// iteration number only, such that all processes agree on the schedule
+// without communicating. A process sends at most one message to and
+// receives at most one message from each peer per iteration.
+class hip_mpitest_schedule {
+ private:
+    int   pattern;
+    int   rank;
+    int   size;
+    bool  self;    // all pattern only: include the process itself
+    int   ndims;
+    int   dims[HIP_MPITEST_PATTERN_MAXDIMS];
+    int  *perm;
+    char *sendmask;
+    char *recvmask;
+    int   nsend;
+    int   nrecv;
+
+    void AddSend (int peer) {
+        if (peer != rank && !sendmask[peer]) {
+            sendmask[peer] = 1;
+            nsend++;
+        }
+    }
+    void AddRecv (int peer) {
+        if (peer != rank && !recvmask[peer]) {
+            recvmask[peer] = 1;
+            nrecv++;
+        }
+    }
+
+    // Fisher-Yates shuffle driven by a generator seeded with the
+    // iteration, identical on all processes
+    void Permute (long iteration) {
+        std::seed_seq seq{hip_mpitest_pattern_seed, (unsigned)iteration,
+                          (unsigned)(iteration >> 32)};
+        std::mt19937 gen(seq);
+
+        for (int i=0; i<size; i++) {
+            perm[i] = i;
+        }
+        for (int i=size-1; i>0; i--) {
+            int j = (int)(gen() % (unsigned)(i + 1));
+            int tmp = perm[i];
+            perm[i] = perm[j];
+            perm[j] = tmp;
+        }
+    }
+
+    void GenerateGrid () {
+        int coords[HIP_MPITEST_PATTERN_MAXDIMS];
+        int r = rank;
+
+        // row-major order as used by MPI_Cart_create
+        for (int d=ndims-1; d>=0; d--) {
+            coords[d] = r % dims[d];
+            r /= dims[d];
+        }
+        for (int d=0; d<ndims; d++) {
+            for (int dir=-1; dir<=1; dir+=2) {
+                int peer=0;
+                for (int e=0; e<ndims; e++) {
+                    int c = coords[e];
+                    if (e == d) {
+                        c = (c + dir + dims[e]) % dims[e];
+                    }
+                    peer = peer * dims[e] + c;
+                }
+                AddSend(peer);
+                AddRecv(peer);
+            }
+        }
+    }
+
+ public:
+    hip_mpitest_schedule () : pattern(HIP_MPITEST_PATTERN_ALL), rank(0), size(0), self(false),
+                              ndims(0), perm(NULL), sendmask(NULL), recvmask(NULL),
+                              nsend(0), nrecv(0) {}
+
+    hip_mpitest_schedule (const hip_mpitest_schedule &) = delete;
+    hip_mpitest_schedule &operator= (const hip_mpitest_schedule &) = delete;
+
+    ~hip_mpitest_schedule () {
+        Free();
+    }
+
+    // default_pattern is used if none was selected on the command line.
+    // self only applies to the all pattern.
+    int Init (MPI_Comm comm, int default_pattern, bool include_self=false) {
+        int ret;
+
+        Free();
+        pattern = hip_mpitest_pattern_get(default_pattern);
+        self    = include_self;
+        MPI_Comm_size (comm, &size);
+        MPI_Comm_rank (comm, &rank);
+
+        if ((HIP_MPITEST_PATTERN_INCAST  == pattern || HIP_MPITEST_PATTERN_OUTCAST == pattern ||
+             HIP_MPITEST_PATTERN_HOTSPOT == pattern) && hip_mpitest_pattern_root >= size) {
+            printf("Root %d of pattern %s is not a valid rank\n", hip_mpitest_pattern_root,
+                   hip_mpitest_pattern_names[pattern]);
+            return MPI_ERR_ARG;
+        }
+        if (HIP_MPITEST_PATTERN_GRID == pattern) {
+            ndims = hip_mpitest_pattern_ndims;
+            memset (dims, 0, sizeof(dims));
+            ret = MPI_Dims_create (size, ndims, dims);
+            if (MPI_SUCCESS != ret) {
+                return ret;
+            }
+        }
+
+        perm     = (int *) malloc (size * sizeof(int));
+        sendmask = (char *) malloc (size);
+        recvmask = (char *) malloc (size);
+        if (NULL == perm || NULL == sendmask || NULL == recvmask) {
+            printf("hip_mpitest_schedule: Could not allocate memory\n");
+            Free();
+            return MPI_ERR_NO_MEM;
+        }
+        return MPI_SUCCESS;
+    }
+
+    void Free () {
+        free (perm);
+        free (sendmask);
+        free (recvmask);
+        perm     = NULL;
+        sendmask = NULL;
+        recvmask = NULL;
+    }
+
+    void Generate (long iteration) {
+        int root = hip_mpitest_pattern_root;
+
+        memset (sendmask, 0, size);
+        memset (recvmask, 0, size);
+        nsend = nrecv = 0;
+
+        switch (pattern) {
+        case HIP_MPITEST_PATTERN_ALL :
+            for (int i=0; i<size; i++) {
+                AddSend(i);
+                AddRecv(i);
+            }
+            if (self) {
+                sendmask[rank] = recvmask[rank] = 1;
+                nsend++;
+                nrecv++;
+            }
+            break;
+        case HIP_MPITEST_PATTERN_RING :
+            if (1 == size) {
+                // a ring of one process sends to itself
+                sendmask[0] = recvmask[0] = 1;
+                nsend = nrecv = 1;
+            }
+            AddSend((rank + 1) % size);
+            AddRecv((rank - 1 + size) % size);
+            break;
+        case HIP_MPITEST_PATTERN_XOR : {
+            int npow2 = 1;
+            while (npow2 < size) {
+                npow2 <<= 1;
+            }
+            if (npow2 > 1) {
+                int partner = rank ^ (int)(1 + iteration % (npow2 - 1));
+                if (partner < size) {
+                    AddSend(partner);
+                    AddRecv(partner);
+                }
+            }
+            break;
+        }
+        case HIP_MPITEST_PATTERN_RANDOM :
+        case HIP_MPITEST_PATTERN_HOTSPOT :
+            Permute(iteration);
+            AddSend(perm[rank]);
+            for (int i=0; i<size; i++) {
+                if (perm[i] == rank) {
+                    AddRecv(i);
+                }
+            }
+            if (HIP_MPITEST_PATTERN_HOTSPOT == pattern) {
+                // the root receives from everybody exactly once
+                if (rank == root) {
+                    for (int i=0; i<size; i++) {
+                        AddRecv(i);
+                    }
+                }
+                else {
+                    AddSend(root);
+                }
+            }
+            break;
+        case HIP_MPITEST_PATTERN_INCAST :
+            if (rank == root) {
+                for (int i=0; i<size; i++) {
+                    AddRecv(i);
+                }
+            }
+            else {
+                AddSend(root);
+            }
+            break;
+        case HIP_MPITEST_PATTERN_OUTCAST :
+            if (rank == root) {
+                for (int i=0; i<size; i++) {
+                    AddSend(i);
+                }
+            }
+            else {
+                AddRecv(root);
+            }
+            break;
+        case HIP_MPITEST_PATTERN_GRID :
+            GenerateGrid();
+            break;
+        }
+    }
+
+    bool SendsTo   (int peer) const { return sendmask[peer] != 0; }
+    bool RecvsFrom (int peer) const { return recvmask[peer] != 0; }
+    int  get_nsend   () const { return nsend; }
+    int  get_nrecv   () const { return nrecv; }
+    int  get_pattern () const { return pattern; }
+
+    // First peer sent to or received from in the current iteration,
+    // -1 if none
+    int get_sendpeer () const {
+        for (int i=0; i<size; i++) {
+            if (sendmask[i]) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    int get_recvpeer () const {
+        for (int i=0; i<size; i++) {
+            if (recvmask[i]) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+// Patterns in which a process sends to and receives from at most one
+// peer per iteration, usable by tests with a single receive buffer
+static inline bool hip_mpitest_pattern_single_peer (int pattern)
+{
+    return HIP_MPITEST_PATTERN_RING == pattern || HIP_MPITEST_PATTERN_XOR == pattern ||
+           HIP_MPITEST_PATTERN_RANDOM == pattern;
+}
+
+#endif // __HIP_MPITEST_PATTERN__
@@ -0,0 +1,120 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_PIPELINE__
+#define __HIP_MPITEST_PIPELINE__
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+// Set through the --pipeline and --iterations options. A depth of 0
+// disables the streaming mode, 0 iterations selects the default of a test.
+static int  hip_mpitest_pipeline_depth = 0;
+static long hip_mpitest_iterations     = 0;
+
+// Checks the data of one slot of the ring, received in the given iteration
+typedef bool (*hip_mpitest_pipeline_check_fn)(void *buf, int slot, long iteration);
+
+// Verifies the slots of a ring of buffers on a helper thread. A test
+// submits a slot once the communication of an iteration has completed
+// and waits for the slot before reusing it for a later iteration, such
+// that checking overlaps with the communication in flight.
+class hip_mpitest_pipeline {
+ private:
+    hip_mpitest_pipeline_check_fn check;
+    std::thread                   thread;
+    std::mutex                    lock;
+    std::condition_variable       cond;
+    std::deque<int>               queue;
+    std::vector<void *>           bufs;
+    std::vector<long>             iters;
+    std::vector<bool>             busy;
+    bool                          finished;
+    bool                          res;
+
+    void run() {
+        std::unique_lock<std::mutex> lk(lock);
+        while (true) {
+            cond.wait(lk, [this] { return finished || !queue.empty(); });
+            if (queue.empty()) {
+                break;
+            }
+            int slot = queue.front();
+            queue.pop_front();
+            lk.unlock();
+            bool lres = check(bufs[slot], slot, iters[slot]);
+            lk.lock();
+            res &= lres;
+            busy[slot] = false;
+            cond.notify_all();
+        }
+    }
+
+ public:
+    hip_mpitest_pipeline(int nslots, hip_mpitest_pipeline_check_fn fn) :
+        check(fn), bufs(nslots), iters(nslots), busy(nslots, false), finished(false), res(true) {
+        thread = std::thread(&hip_mpitest_pipeline::run, this);
+    }
+    ~hip_mpitest_pipeline() {
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            finished = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+
+    void submit(int slot, void *buf, long iteration) {
+        std::lock_guard<std::mutex> lk(lock);
+        bufs[slot]  = buf;
+        iters[slot] = iteration;
+        busy[slot]  = true;
+        queue.push_back(slot);
+        cond.notify_all();
+    }
+
+    // Block until the verification of a slot has finished
+    void wait(int slot) {
+        std::unique_lock<std::mutex> lk(lock);
+        cond.wait(lk, [this, slot] { return !busy[slot]; });
+    }
+
+    // Block until all submitted slots are verified, returns the overall result
+    bool wait_all() {
+        std::unique_lock<std::mutex> lk(lock);
+        cond.wait(lk, [this] {
+            for (size_t i=0; i<busy.size(); i++) {
+                if (busy[i]) return false;
+            }
+            return true;
+        });
+        return res;
+    }
+};
+
+#endif // __HIP_MPITEST_PIPELINE__
@@ -0,0 +1,187 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_PREFAULT__
+#define __HIP_MPITEST_PREFAULT__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <thread>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// Maximum number of threads touching the pages of a buffer
+#define HIP_MPITEST_PREFAULT_MAXTHREADS 8
+
+// How the pages of host buffers are faulted in after the allocation
+//    none:     on first access, i.e. possibly inside a timed region
+//    populate: all at once by the kernel (MADV_POPULATE_WRITE, the
+//              equivalent of MAP_POPULATE for existing mappings)
+//    touch:    by writing to every page from several threads
+//    mlock:    by locking the pages into memory
+enum HIP_MPITEST_PREFAULT {
+      HIP_MPITEST_PREFAULT_NONE=0,
+      HIP_MPITEST_PREFAULT_POPULATE,
+      HIP_MPITEST_PREFAULT_TOUCH,
+      HIP_MPITEST_PREFAULT_MLOCK,
+      HIP_MPITEST_PREFAULT_LAST
+};
+
+const char *const hip_mpitest_prefault_names[HIP_MPITEST_PREFAULT_LAST] = {
+    "none", "populate", "touch", "mlock"};
+
+// Set through the --prefault option
+static int  hip_mpitest_prefault_policy = HIP_MPITEST_PREFAULT_NONE;
+static bool hip_mpitest_prefault_report = false;
+
+// Page faults taken inside the timed regions, minor and major
+static long hip_mpitest_pagefaults[2]       = {0, 0};
+static long hip_mpitest_pagefaults_start[2] = {0, 0};
+
+// Set once a timed region of the test has been instrumented
+static bool hip_mpitest_pagefaults_timed = false;
+
+static bool hip_mpitest_prefault_parse (const char *arg)
+{
+    for (int i=0; i<HIP_MPITEST_PREFAULT_LAST; i++) {
+        if (strcmp(arg, hip_mpitest_prefault_names[i]) == 0) {
+            hip_mpitest_prefault_policy = i;
+            hip_mpitest_prefault_report = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void hip_mpitest_prefault_touch (void *buf, size_t len)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    size_t npages = (len + pagesize - 1) / pagesize;
+    size_t nthreads = std::thread::hardware_concurrency();
+    std::thread threads[HIP_MPITEST_PREFAULT_MAXTHREADS];
+
+    if (nthreads > HIP_MPITEST_PREFAULT_MAXTHREADS) {
+        nthreads = HIP_MPITEST_PREFAULT_MAXTHREADS;
+    }
+    if (nthreads > npages / 64) {
+        nthreads = npages / 64;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    // Each thread writes to one byte of every page in a contiguous range
+    for (size_t t=0; t<nthreads; t++) {
+        size_t first = npages * t / nthreads;
+        size_t last  = npages * (t + 1) / nthreads;
+        threads[t] = std::thread([=] () {
+                for (size_t p=first; p<last; p++) {
+                    ((volatile char *)buf)[p * pagesize] = 0;
+                }
+            });
+    }
+    for (size_t t=0; t<nthreads; t++) {
+        threads[t].join();
+    }
+}
+
+// Faults in the pages of a host buffer according to the prefault policy.
+// Returns the policy applied, touch if the requested policy is not
+// supported or not permitted.
+static int hip_mpitest_prefault (void *buf, size_t len)
+{
+    static bool warned=false;
+    int policy = hip_mpitest_prefault_policy;
+
+    if (NULL == buf || 0 == len || HIP_MPITEST_PREFAULT_NONE == policy) {
+        return HIP_MPITEST_PREFAULT_NONE;
+    }
+    if (HIP_MPITEST_PREFAULT_POPULATE == policy) {
+        // madvise requires a page aligned start address
+        long pagesize = sysconf(_SC_PAGESIZE);
+        char *abuf = (char *)buf - ((uintptr_t)buf % pagesize);
+        if (madvise(abuf, len + ((char *)buf - abuf), MADV_POPULATE_WRITE) != 0) {
+            policy = HIP_MPITEST_PREFAULT_TOUCH;
+        }
+    }
+    else if (HIP_MPITEST_PREFAULT_MLOCK == policy) {
+        if (mlock(buf, len) != 0) {
+            policy = HIP_MPITEST_PREFAULT_TOUCH;
+        }
+    }
+    if (policy != hip_mpitest_prefault_policy && !warned) {
+        printf("hip_mpitest_prefault: %s failed %s, touching the pages instead\n",
+               hip_mpitest_prefault_names[hip_mpitest_prefault_policy], strerror(errno));
+        warned = true;
+    }
+    if (HIP_MPITEST_PREFAULT_TOUCH == policy) {
+        hip_mpitest_prefault_touch(buf, len);
+    }
+    return policy;
+}
+
+static void hip_mpitest_prefault_release (void *buf, size_t len, int policy)
+{
+    if (HIP_MPITEST_PREFAULT_MLOCK == policy) {
+        munlock(buf, len);
+    }
+}
+
+// Count the page faults of the process between begin and end, to be
+// called around the timed regions of a test
+static inline void hip_mpitest_pagefaults_begin ()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    hip_mpitest_pagefaults_start[0] = usage.ru_minflt;
+    hip_mpitest_pagefaults_start[1] = usage.ru_majflt;
+    hip_mpitest_pagefaults_timed    = true;
+}
+
+static inline void hip_mpitest_pagefaults_end ()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    hip_mpitest_pagefaults[0] += usage.ru_minflt - hip_mpitest_pagefaults_start[0];
+    hip_mpitest_pagefaults[1] += usage.ru_majflt - hip_mpitest_pagefaults_start[1];
+}
+
+// Returns the faults counted since the last call
+static void hip_mpitest_pagefaults_get (long faults[2])
+{
+    faults[0] = hip_mpitest_pagefaults[0];
+    faults[1] = hip_mpitest_pagefaults[1];
+    hip_mpitest_pagefaults[0] = 0;
+    hip_mpitest_pagefaults[1] = 0;
+}
+
+#endif // __HIP_MPITEST_PREFAULT__
@@ -35,22 +35,24 @@
 
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_typed_buffer.h"
 
-int elements=100;                  //Adjust
+long elements=100;                  //Adjust
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (double *sendbuf, int count, int mynode)
+// The functions work on elements [first, first+count) of the buffers
+static void init_sendbuf (double *sendbuf, long first, long count, int mynode)
 {
     //Implement function
 }
 
-static void init_recvbuf (double *recvbuf, int count)
+static void init_recvbuf (double *recvbuf, long first, long count)
 {
     //Implement function
 }
 
-static bool check_recvbuf(double *recvbuf, int nprocs, int rank, int count)
+static bool check_recvbuf(const double *recvbuf, long first, long count, int nprocs, int rank)
 {
     //Implement function
 }
@@ -67,14 +69,17 @@ int main (int argc, char *argv[])
     bind_device();
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    //Replace type and extent_of_type in the code
-    type *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
+    //Replace type in the code
+    hip_mpitest_typed_buffer<type> sbuf, rbuf;
 
     // Initialise send buffer
-    ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, type, elements, extent_of_type, rank, MPI_COMM_WORLD, init_sendbuf);
+    HIP_CHECK(sbuf.Allocate(sendbuf, elements));
+    HIP_CHECK(sbuf.Generate([rank](type *buf, long first, long n) {
+                                init_sendbuf(buf, first, n, rank); }));
 
     // Initialize recv buffer
-    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, type, elements, extent_of_type, rank, MPI_COMM_WORLD, init_recvbuf);
+    HIP_CHECK(rbuf.Allocate(recvbuf, elements));
+    HIP_CHECK(rbuf.Generate(init_recvbuf));
 
     //Warmup
     //execute warmup function if necessary/desired
@@ -95,22 +100,16 @@ int main (int argc, char *argv[])
     double t1 = std::chrono::duration<double>(t1e-t1s).count();
 
     // verify results
-    bool ret = true;
-    if (recvbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*extent_of_type));
-        ret = check_recvbuf((type*)tmp_recvbuf, size, rank, elements);
-    }
-    else {
-        ret = check_recvbuf((type*) recvbuf->get_buffer(), size, rank, elements);
-    }
+    bool ret = rbuf.Verify([size, rank](const type *buf, long first, long n) {
+                               return check_recvbuf(buf, first, n, size, rank); });
 
     bool fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), ret);
     report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(),
-                        elements, (size_t)(elements * extent_of_type), NITER, t1);
+                        elements, rbuf.get_size(), NITER, t1);
 
     //Free buffers
-    FREE_BUFFER(sendbuf, tmp_sendbuf);
-    FREE_BUFFER(recvbuf, tmp_recvbuf);
+    HIP_CHECK(sbuf.Free());
+    HIP_CHECK(rbuf.Free());
 
     delete (sendbuf);
     delete (recvbuf);
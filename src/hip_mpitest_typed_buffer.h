@@ -0,0 +1,249 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_TYPED_BUFFER__
+#define __HIP_MPITEST_TYPED_BUFFER__
+
+#include <stdlib.h>
+#include <utility>
+#include <hip/hip_runtime.h>
+#include "mpi.h"
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+
+// Allocation of count elements of type T in a memory type buffer. The
+// allocation is owned by the object and released by Free() or when the
+// object is destroyed, hence it can be moved but not copied.
+//
+// The elements are generated and verified through typed hooks working on
+// ranges of elements:
+//    gen   (T *chunk, long first, long n)        sets elements [first, first+n)
+//    check (const T *chunk, long first, long n)  returns false on a mismatch
+// For memory types not accessible by the host, the hooks are applied
+// to chunks passing through the bounce buffers of the memory type. A
+// full size host staging copy is only created on the first call of
+// get_host(), after which Upload() and Download() synchronize it.
+template <typename T>
+class hip_mpitest_typed_buffer {
+ private:
+    hip_mpitest_buffer *buf;
+    T                  *staging;
+    long                count;
+
+    // Chunks of the bounce buffers contain whole elements only
+    static bool Chunked () {
+        return (HIP_MPITEST_COPY_CHUNK % sizeof(T)) == 0;
+    }
+
+    template <typename Gen>
+    static void FillChunk (void *chunk, size_t offset, size_t nBytes, void *arg) {
+        Gen *gen = (Gen *)arg;
+        (*gen)((T *)chunk, (long)(offset / sizeof(T)), (long)(nBytes / sizeof(T)));
+    }
+
+ public:
+    hip_mpitest_typed_buffer () : buf(NULL), staging(NULL), count(0) {}
+
+    hip_mpitest_typed_buffer (const hip_mpitest_typed_buffer &) = delete;
+    hip_mpitest_typed_buffer &operator= (const hip_mpitest_typed_buffer &) = delete;
+
+    hip_mpitest_typed_buffer (hip_mpitest_typed_buffer &&other) :
+        buf(other.buf), staging(other.staging), count(other.count) {
+        other.buf     = NULL;
+        other.staging = NULL;
+        other.count   = 0;
+    }
+
+    hip_mpitest_typed_buffer &operator= (hip_mpitest_typed_buffer &&other) {
+        if (this != &other) {
+            Free();
+            std::swap(buf, other.buf);
+            std::swap(staging, other.staging);
+            std::swap(count, other.count);
+        }
+        return *this;
+    }
+
+    ~hip_mpitest_typed_buffer () {
+        Free();
+    }
+
+    hipError_t Allocate (hip_mpitest_buffer *membuf, long nelems) {
+        hipError_t err;
+
+        Free();
+        if (NULL == membuf) {
+            return hipErrorInvalidValue;
+        }
+        err = membuf->Allocate(nelems * sizeof(T));
+        if (hipSuccess != err) {
+            membuf->Free();
+            return err;
+        }
+        buf   = membuf;
+        count = nelems;
+        return hipSuccess;
+    }
+
+    hipError_t Free () {
+        hipError_t err = hipSuccess;
+
+        if (NULL != buf) {
+            err = buf->Free();
+        }
+        free(staging);
+        buf     = NULL;
+        staging = NULL;
+        count   = 0;
+        return err;
+    }
+
+    // Address of the elements, to be passed to MPI
+    T *get_buffer () {
+        return NULL != buf ? (T *)buf->get_buffer() : NULL;
+    }
+    hip_mpitest_buffer *get_membuf () {
+        return buf;
+    }
+    long get_count () {
+        return count;
+    }
+    size_t get_size () {
+        return count * sizeof(T);
+    }
+
+    // Host view of the elements, the staging copy for memory types not
+    // accessible by the host. NULL if the staging copy can not be allocated.
+    T *get_host () {
+        if (!buf->NeedsStagingBuffer()) {
+            return get_buffer();
+        }
+        if (NULL == staging) {
+            staging = (T *) malloc (get_size());
+        }
+        return staging;
+    }
+
+    // Copy the staging copy into the buffer and vice versa
+    hipError_t Upload () {
+        if (!buf->NeedsStagingBuffer()) {
+            return hipSuccess;
+        }
+        if (NULL == staging) {
+            return hipErrorInvalidValue;
+        }
+        return buf->CopyTo(staging, get_size());
+    }
+
+    hipError_t Download () {
+        T *host;
+        if (!buf->NeedsStagingBuffer()) {
+            return hipSuccess;
+        }
+        host = get_host();
+        if (NULL == host) {
+            return hipErrorMemoryAllocation;
+        }
+        return buf->CopyFrom(host, get_size());
+    }
+
+    template <typename Gen>
+    hipError_t Generate (Gen gen) {
+        T *host;
+
+        if (!buf->NeedsStagingBuffer()) {
+            gen(get_buffer(), 0, count);
+            return hipSuccess;
+        }
+        if (NULL == staging && Chunked()) {
+            return buf->Fill(FillChunk<Gen>, &gen, get_size());
+        }
+        host = get_host();
+        if (NULL == host) {
+            return hipErrorMemoryAllocation;
+        }
+        gen(host, 0, count);
+        return Upload();
+    }
+
+    // Without a staging copy, the next chunk is transferred while the
+    // current one is checked
+    template <typename Check>
+    bool Verify (Check check) {
+        hip_mpitest_copy_handle handle;
+        long chunk = HIP_MPITEST_COPY_CHUNK / sizeof(T);
+        bool res = true;
+        T *host[2];
+
+        if (!buf->NeedsStagingBuffer()) {
+            return check(get_buffer(), 0, count);
+        }
+        if (NULL != staging || !Chunked()) {
+            if (hipSuccess != Download()) {
+                return false;
+            }
+            return check(staging, 0, count);
+        }
+        if (0 == count) {
+            return true;
+        }
+        if (chunk > count) {
+            chunk = count;
+        }
+        host[0] = (T *) malloc (chunk * sizeof(T));
+        host[1] = (T *) malloc (chunk * sizeof(T));
+        if (NULL == host[0] || NULL == host[1] ||
+            hipSuccess != buf->CopyFromAsync(host[0], chunk * sizeof(T), &handle, 0)) {
+            free(host[0]);
+            free(host[1]);
+            return false;
+        }
+        for (long first=0, k=0; first<count; first+=chunk, k++) {
+            long n = (count - first) < chunk ? (count - first) : chunk;
+            long next = first + n;
+            if (hipSuccess != buf->Wait(&handle)) {
+                res = false;
+                break;
+            }
+            if (next < count) {
+                long nn = (count - next) < chunk ? (count - next) : chunk;
+                if (hipSuccess != buf->CopyFromAsync(host[1-k%2], nn * sizeof(T), &handle,
+                                                     next * sizeof(T))) {
+                    res = false;
+                    break;
+                }
+            }
+            res &= check(host[k%2], first, n);
+        }
+        buf->Wait(&handle);
+        free(host[0]);
+        free(host[1]);
+        return res;
+    }
+
+    void Report (MPI_Comm comm, const char *name) {
+        report_buffertype(comm, name, buf);
+    }
+};
+
+#endif // __HIP_MPITEST_TYPED_BUFFER__
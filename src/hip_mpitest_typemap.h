@@ -0,0 +1,421 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_TYPEMAP__
+#define __HIP_MPITEST_TYPEMAP__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <algorithm>
+
+#include "mpi.h"
+
+// Byte values of the gaps of a datatype in the send and receive buffers.
+// Data bytes are set to a pattern depending on the sender and on the
+// position of the byte in the packed representation of the message.
+#define HIP_MPITEST_TYPEMAP_SEND_FILL 0x5A
+#define HIP_MPITEST_TYPEMAP_RECV_FILL 0xFF
+
+// Size of the scratch buffer used to generate expected data
+#define HIP_MPITEST_TYPEMAP_CHUNK (64*1024)
+
+struct hip_mpitest_typemap_run {
+    MPI_Aint disp;  // byte displacement relative to the start of an element
+    MPI_Aint len;   // number of contiguous bytes
+};
+typedef struct hip_mpitest_typemap_run hip_mpitest_typemap_run;
+
+// Flattened representation of one element of a datatype. The runs are
+// stored in typemap order, i.e. in the order in which the bytes appear
+// in the packed representation, adjacent runs being merged.
+struct hip_mpitest_typemap {
+    MPI_Aint lb;
+    MPI_Aint extent;
+    MPI_Aint size;
+    bool     supported;
+    std::vector<hip_mpitest_typemap_run> runs;
+    // Bytes of [lb, lb+extent) not covered by any run, sorted by
+    // displacement. Left empty if elements of the type overlap.
+    std::vector<hip_mpitest_typemap_run> gaps;
+};
+typedef struct hip_mpitest_typemap hip_mpitest_typemap;
+
+static int hip_mpitest_typemap_keyval = MPI_KEYVAL_INVALID;
+
+static void hip_mpitest_typemap_append (std::vector<hip_mpitest_typemap_run> &runs,
+                                        MPI_Aint disp, MPI_Aint len)
+{
+    if (len <= 0) {
+        return;
+    }
+    if (!runs.empty() && runs.back().disp + runs.back().len == disp) {
+        runs.back().len += len;
+        return;
+    }
+    hip_mpitest_typemap_run r = {disp, len};
+    runs.push_back(r);
+}
+
+static void hip_mpitest_typemap_append (std::vector<hip_mpitest_typemap_run> &runs,
+                                        const std::vector<hip_mpitest_typemap_run> &old,
+                                        MPI_Aint shift)
+{
+    for (size_t k=0; k<old.size(); k++) {
+        hip_mpitest_typemap_append(runs, old[k].disp + shift, old[k].len);
+    }
+}
+
+// Predefined pair types are the only named types with gaps.
+template <typename T> struct hip_mpitest_typemap_pair {
+    T   val;
+    int idx;
+};
+
+template <typename T>
+static void hip_mpitest_typemap_append_pair (std::vector<hip_mpitest_typemap_run> &runs)
+{
+    hip_mpitest_typemap_append(runs, offsetof(hip_mpitest_typemap_pair<T>, val), sizeof(T));
+    hip_mpitest_typemap_append(runs, offsetof(hip_mpitest_typemap_pair<T>, idx), sizeof(int));
+}
+
+static bool hip_mpitest_typemap_flatten (MPI_Datatype type,
+                                         std::vector<hip_mpitest_typemap_run> &runs)
+{
+    int nints, naddrs, ntypes, combiner;
+    MPI_Aint lb, ext;
+
+    MPI_Type_get_envelope(type, &nints, &naddrs, &ntypes, &combiner);
+    if (MPI_COMBINER_NAMED == combiner) {
+        int size;
+        MPI_Type_size(type, &size);
+        if (MPI_SHORT_INT == type) {
+            hip_mpitest_typemap_append_pair<short>(runs);
+        } else if (MPI_LONG_INT == type) {
+            hip_mpitest_typemap_append_pair<long>(runs);
+        } else if (MPI_DOUBLE_INT == type) {
+            hip_mpitest_typemap_append_pair<double>(runs);
+        } else if (MPI_LONG_DOUBLE_INT == type) {
+            hip_mpitest_typemap_append_pair<long double>(runs);
+        } else {
+            hip_mpitest_typemap_append(runs, 0, size);
+        }
+        return true;
+    }
+
+    std::vector<int>          ints(nints);
+    std::vector<MPI_Aint>     addrs(naddrs);
+    std::vector<MPI_Datatype> types(ntypes);
+    MPI_Type_get_contents(type, nints, naddrs, ntypes, ints.data(), addrs.data(), types.data());
+
+    // Flatten every distinct sub-type once, then replicate it
+    std::vector<std::vector<hip_mpitest_typemap_run> > old(ntypes);
+    std::vector<MPI_Aint> oldext(ntypes);
+    bool res = true;
+    for (int t=0; t<ntypes && res; t++) {
+        res = hip_mpitest_typemap_flatten(types[t], old[t]);
+        MPI_Type_get_extent(types[t], &lb, &ext);
+        oldext[t] = ext;
+    }
+
+    if (res) {
+        switch (combiner) {
+        case MPI_COMBINER_DUP:
+        case MPI_COMBINER_RESIZED:
+            hip_mpitest_typemap_append(runs, old[0], 0);
+            break;
+        case MPI_COMBINER_CONTIGUOUS:
+            for (int i=0; i<ints[0]; i++) {
+                hip_mpitest_typemap_append(runs, old[0], i*oldext[0]);
+            }
+            break;
+        case MPI_COMBINER_VECTOR:
+        case MPI_COMBINER_HVECTOR: {
+            MPI_Aint stride = (MPI_COMBINER_VECTOR == combiner) ?
+                              (MPI_Aint)ints[2]*oldext[0] : addrs[0];
+            for (int i=0; i<ints[0]; i++) {
+                for (int j=0; j<ints[1]; j++) {
+                    hip_mpitest_typemap_append(runs, old[0], i*stride + j*oldext[0]);
+                }
+            }
+            break;
+        }
+        case MPI_COMBINER_INDEXED:
+        case MPI_COMBINER_HINDEXED:
+            for (int i=0; i<ints[0]; i++) {
+                MPI_Aint disp = (MPI_COMBINER_INDEXED == combiner) ?
+                                (MPI_Aint)ints[ints[0]+1+i]*oldext[0] : addrs[i];
+                for (int j=0; j<ints[1+i]; j++) {
+                    hip_mpitest_typemap_append(runs, old[0], disp + j*oldext[0]);
+                }
+            }
+            break;
+        case MPI_COMBINER_INDEXED_BLOCK:
+        case MPI_COMBINER_HINDEXED_BLOCK:
+            for (int i=0; i<ints[0]; i++) {
+                MPI_Aint disp = (MPI_COMBINER_INDEXED_BLOCK == combiner) ?
+                                (MPI_Aint)ints[2+i]*oldext[0] : addrs[i];
+                for (int j=0; j<ints[1]; j++) {
+                    hip_mpitest_typemap_append(runs, old[0], disp + j*oldext[0]);
+                }
+            }
+            break;
+        case MPI_COMBINER_STRUCT:
+            for (int i=0; i<ints[0]; i++) {
+                for (int j=0; j<ints[1+i]; j++) {
+                    hip_mpitest_typemap_append(runs, old[i], addrs[i] + j*oldext[i]);
+                }
+            }
+            break;
+        case MPI_COMBINER_SUBARRAY: {
+            int ndims  = ints[0];
+            int *sizes = &ints[1], *subsizes = &ints[1+ndims], *starts = &ints[1+2*ndims];
+            bool corder = (MPI_ORDER_C == ints[1+3*ndims]);
+            std::vector<MPI_Aint> stride(ndims);
+            std::vector<int> idx(ndims, 0);
+            MPI_Aint nblocks = 1;
+
+            // Elements are enumerated with the fastest running dimension last
+            for (int d=0; d<ndims; d++) {
+                int dd   = corder ? ndims-1-d : d;
+                int prev = corder ? dd+1 : dd-1;
+                stride[dd] = (0 == d) ? oldext[0] : stride[prev] * sizes[prev];
+                nblocks *= subsizes[d];
+            }
+            for (MPI_Aint b=0; b<nblocks; b++) {
+                MPI_Aint disp = 0;
+                for (int d=0; d<ndims; d++) {
+                    disp += (MPI_Aint)(starts[d] + idx[d]) * stride[d];
+                }
+                hip_mpitest_typemap_append(runs, old[0], disp);
+                for (int d=0; d<ndims; d++) {
+                    int dd = corder ? ndims-1-d : d;
+                    if (++idx[dd] < subsizes[dd]) {
+                        break;
+                    }
+                    idx[dd] = 0;
+                }
+            }
+            break;
+        }
+        default:
+            // darray and Fortran parameterized types are not supported
+            res = false;
+            break;
+        }
+    }
+
+    for (int t=0; t<ntypes; t++) {
+        int ni, na, nt, comb;
+        MPI_Type_get_envelope(types[t], &ni, &na, &nt, &comb);
+        if (MPI_COMBINER_NAMED != comb) {
+            MPI_Type_free(&types[t]);
+        }
+    }
+    return res;
+}
+
+static bool hip_mpitest_typemap_run_less (const hip_mpitest_typemap_run &a,
+                                          const hip_mpitest_typemap_run &b)
+{
+    return a.disp < b.disp;
+}
+
+static hip_mpitest_typemap *hip_mpitest_typemap_create (MPI_Datatype type)
+{
+    hip_mpitest_typemap *tm = new hip_mpitest_typemap;
+    MPI_Aint true_lb, true_extent;
+    int size;
+
+    MPI_Type_get_extent(type, &tm->lb, &tm->extent);
+    MPI_Type_get_true_extent(type, &true_lb, &true_extent);
+    MPI_Type_size(type, &size);
+    tm->size = size;
+    tm->supported = hip_mpitest_typemap_flatten(type, tm->runs);
+    if (!tm->supported) {
+        printf("hip_mpitest_typemap: datatype can not be flattened\n");
+        tm->runs.clear();
+        return tm;
+    }
+
+    // Gaps can only be attributed to a single element if elements don't overlap
+    if (true_lb < tm->lb || true_lb + true_extent > tm->lb + tm->extent) {
+        return tm;
+    }
+    std::vector<hip_mpitest_typemap_run> sorted(tm->runs);
+    std::sort(sorted.begin(), sorted.end(), hip_mpitest_typemap_run_less);
+    MPI_Aint pos = tm->lb;
+    for (size_t k=0; k<sorted.size(); k++) {
+        if (sorted[k].disp > pos) {
+            hip_mpitest_typemap_run g = {pos, sorted[k].disp - pos};
+            tm->gaps.push_back(g);
+        }
+        if (sorted[k].disp + sorted[k].len > pos) {
+            pos = sorted[k].disp + sorted[k].len;
+        }
+    }
+    if (tm->lb + tm->extent > pos) {
+        hip_mpitest_typemap_run g = {pos, tm->lb + tm->extent - pos};
+        tm->gaps.push_back(g);
+    }
+    return tm;
+}
+
+static int hip_mpitest_typemap_delete (MPI_Datatype type, int keyval, void *attr_val,
+                                       void *extra_state)
+{
+    delete (hip_mpitest_typemap *)attr_val;
+    return MPI_SUCCESS;
+}
+
+// Returns the flattened representation of a committed datatype. The
+// result is cached as an attribute on the datatype and released when
+// the datatype is freed.
+static hip_mpitest_typemap *hip_mpitest_typemap_get (MPI_Datatype type)
+{
+    hip_mpitest_typemap *tm;
+    int flag;
+
+    if (MPI_KEYVAL_INVALID == hip_mpitest_typemap_keyval) {
+        MPI_Type_create_keyval(MPI_TYPE_NULL_COPY_FN, hip_mpitest_typemap_delete,
+                               &hip_mpitest_typemap_keyval, NULL);
+    }
+    MPI_Type_get_attr(type, hip_mpitest_typemap_keyval, &tm, &flag);
+    if (!flag) {
+        tm = hip_mpitest_typemap_create(type);
+        MPI_Type_set_attr(type, hip_mpitest_typemap_keyval, tm);
+    }
+    return tm;
+}
+
+static inline uint64_t hip_mpitest_typemap_word (int rank, uint64_t w)
+{
+    uint64_t z = w + ((uint64_t)(rank + 1) << 40) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Bytes [pos, pos+len) of the packed representation of a message of rank
+static void hip_mpitest_typemap_pattern (unsigned char *buf, int rank, uint64_t pos, size_t len)
+{
+    while (len > 0) {
+        uint64_t w = hip_mpitest_typemap_word(rank, pos >> 3);
+        int k = pos & 7;
+        for (; k<8 && len>0; k++, len--, pos++) {
+            *buf++ = (unsigned char)(w >> (8*k));
+        }
+    }
+}
+
+static void hip_mpitest_typemap_init_sendbuf (MPI_Datatype type, void *sbuf, int count, int rank)
+{
+    hip_mpitest_typemap *tm = hip_mpitest_typemap_get(type);
+    char *buf = (char *)sbuf + tm->lb;
+    uint64_t pos = 0;
+
+    memset(buf, HIP_MPITEST_TYPEMAP_SEND_FILL, count * tm->extent);
+    for (int i=0; i<count; i++) {
+        char *base = (char *)sbuf + i * tm->extent;
+        for (size_t k=0; k<tm->runs.size(); k++) {
+            hip_mpitest_typemap_pattern((unsigned char *)base + tm->runs[k].disp, rank, pos,
+                                        tm->runs[k].len);
+            pos += tm->runs[k].len;
+        }
+    }
+}
+
+static void hip_mpitest_typemap_init_recvbuf (MPI_Datatype type, void *rbuf, int count)
+{
+    hip_mpitest_typemap *tm = hip_mpitest_typemap_get(type);
+
+    memset((char *)rbuf + tm->lb, HIP_MPITEST_TYPEMAP_RECV_FILL, count * tm->extent);
+}
+
+// Checks that count elements of type in rbuf contain the data sent by
+// rank sender, and that the gaps in between still hold the fill value.
+static bool hip_mpitest_typemap_check_recvbuf (MPI_Datatype type, void *rbuf, int count,
+                                               int sender)
+{
+    hip_mpitest_typemap *tm = hip_mpitest_typemap_get(type);
+    unsigned char *expected, *fill;
+    uint64_t pos = 0;
+    bool res = true;
+
+    if (!tm->supported) {
+        return false;
+    }
+    expected = (unsigned char *)malloc(2 * HIP_MPITEST_TYPEMAP_CHUNK);
+    if (NULL == expected) {
+        printf("hip_mpitest_typemap: Could not allocate memory\n");
+        return false;
+    }
+    fill = expected + HIP_MPITEST_TYPEMAP_CHUNK;
+    memset(fill, HIP_MPITEST_TYPEMAP_RECV_FILL, HIP_MPITEST_TYPEMAP_CHUNK);
+
+    for (int i=0; i<count && res; i++) {
+        char *base = (char *)rbuf + i * tm->extent;
+        for (size_t k=0; k<tm->runs.size() && res; k++) {
+            for (MPI_Aint off=0; off<tm->runs[k].len; off+=HIP_MPITEST_TYPEMAP_CHUNK) {
+                MPI_Aint n = tm->runs[k].len - off;
+                if (n > HIP_MPITEST_TYPEMAP_CHUNK) {
+                    n = HIP_MPITEST_TYPEMAP_CHUNK;
+                }
+                hip_mpitest_typemap_pattern(expected, sender, pos, n);
+                pos += n;
+                if (memcmp(base + tm->runs[k].disp + off, expected, n) != 0) {
+                    res = false;
+#ifdef VERBOSE
+                    printf("element %d: data mismatch in bytes [%ld, %ld)\n", i,
+                           (long)(tm->runs[k].disp + off), (long)(tm->runs[k].disp + off + n));
+#endif
+                    break;
+                }
+            }
+        }
+        for (size_t k=0; k<tm->gaps.size() && res; k++) {
+            for (MPI_Aint off=0; off<tm->gaps[k].len; off+=HIP_MPITEST_TYPEMAP_CHUNK) {
+                MPI_Aint n = tm->gaps[k].len - off;
+                if (n > HIP_MPITEST_TYPEMAP_CHUNK) {
+                    n = HIP_MPITEST_TYPEMAP_CHUNK;
+                }
+                if (memcmp(base + tm->gaps[k].disp + off, fill, n) != 0) {
+                    res = false;
+#ifdef VERBOSE
+                    printf("element %d: gap bytes [%ld, %ld) have been modified\n", i,
+                           (long)(tm->gaps[k].disp + off), (long)(tm->gaps[k].disp + off + n));
+#endif
+                    break;
+                }
+            }
+        }
+    }
+
+    free(expected);
+    return res;
+}
+
+#endif // __HIP_MPITEST_TYPEMAP__
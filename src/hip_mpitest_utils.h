@@ -30,10 +30,20 @@
 #include <signal.h>
 #include <execinfo.h>
 #include <getopt.h>
+#include <limits.h>
+#include <errno.h>
+#include <ctype.h>
 
 #include <hip/hip_runtime.h>
 #include "hip_mpitest_config.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_file.h"
+#include "hip_mpitest_pipeline.h"
+#include "hip_mpitest_layout.h"
+#include "hip_mpitest_pattern.h"
+#include "hip_mpitest_largecount.h"
+#include "hip_mpitest_msgsize.h"
+#include "hip_mpitest_window.h"
 #include "mpi.h"
 
 #define HIP_CHECK(cond) {                                                 \
@@ -46,28 +56,91 @@
 
 
 #define SET_MEMBUF_TYPE(_bufchar, _membuf, _argc, _argv, _comm) {  \
-   if (strncmp(_bufchar, "D", 1) == 0 ){                     \
-       _membuf = new hip_mpitest_buffer_device;              \
-   }                                                         \
-   else if (strncmp(_bufchar, "H", 1) == 0) {                \
-       _membuf = new hip_mpitest_buffer_host;                \
-   }                                                         \
-   else if (strncmp(_bufchar, "M", 1) == 0) {                \
-       _membuf = new hip_mpitest_buffer_managed;             \
-   }                                                         \
-   else if (strncmp(_bufchar, "O", 1) == 0) {                \
-       _membuf = new hip_mpitest_buffer_hostmalloc;          \
-   }                                                         \
-   else if (strncmp(_bufchar, "R", 1) == 0) {                \
-       _membuf = new hip_mpitest_buffer_hostregister;        \
-   }                                                         \
-   else {                                                    \
+   _membuf = hip_mpitest_buffer_create(_bufchar[0]);         \
+   if (NULL == _membuf) {                                    \
        printf("Invalid input %s\n", _bufchar);               \
        print_help(_argc, _argv);                             \
        MPI_Abort (_comm, 1);                                 \
    }                                                         \
 }
 
+// Options without a short form
+enum HIP_MPITEST_LONGOPT {
+      HIP_MPITEST_OPT_FILE_VERIFY=256,
+      HIP_MPITEST_OPT_KEEP_PAGECACHE,
+      HIP_MPITEST_OPT_PIPELINE,
+      HIP_MPITEST_OPT_ITERATIONS,
+      HIP_MPITEST_OPT_NUMA,
+      HIP_MPITEST_OPT_MMAP_PATH,
+      HIP_MPITEST_OPT_MMAP_POPULATE,
+      HIP_MPITEST_OPT_POOL_THRESHOLD,
+      HIP_MPITEST_OPT_POOL_REUSE,
+      HIP_MPITEST_OPT_SEND_OFFSET,
+      HIP_MPITEST_OPT_RECV_OFFSET,
+      HIP_MPITEST_OPT_ALIGN,
+      HIP_MPITEST_OPT_CHURN_POOL,
+      HIP_MPITEST_OPT_LAYOUT,
+      HIP_MPITEST_OPT_PREFAULT,
+      HIP_MPITEST_OPT_PATTERN,
+      HIP_MPITEST_OPT_PATTERN_SEED,
+      HIP_MPITEST_OPT_PROGRESS_BACKOFF,
+      HIP_MPITEST_OPT_THREADS,
+      HIP_MPITEST_OPT_THREAD_COMM,
+      HIP_MPITEST_OPT_QUEUE_DEPTH,
+      HIP_MPITEST_OPT_TAGS,
+      HIP_MPITEST_OPT_PROTOCOL_FIT,
+      HIP_MPITEST_OPT_BSEND_WINDOW,
+      HIP_MPITEST_OPT_MSG_SIZES,
+      HIP_MPITEST_OPT_MSG_SIZE_SEED,
+      HIP_MPITEST_OPT_WINDOW
+};
+
+// Set through the --progress-backoff option
+static long hip_mpitest_progress_backoff = 1;
+
+// Set through the --bsend-window option
+static int hip_mpitest_bsend_window = 16;
+
+// Set through the --threads and --thread-comm options
+static int  hip_mpitest_threads     = 4;
+static bool hip_mpitest_thread_comm = false;
+
+// Set through the --queue-depth and --tags options
+static int hip_mpitest_queue_depth = 1024;
+static int hip_mpitest_tags        = 16;
+
+// Number of message sizes per power of two of the protocol analysis of
+// the point-to-point benchmark, set through the --protocol-fit option.
+// 0 disables the analysis.
+static int hip_mpitest_protocol_steps = 0;
+#define HIP_MPITEST_FIT_MAXSTEPS 32
+
+// Parse a number of elements with an optional binary suffix, e.g. 4G
+// for 4*2^30. Returns false for malformed input and on overflow.
+static bool hip_mpitest_parse_count (const char *arg, long *count)
+{
+    char *end;
+    long val, mult=1;
+
+    errno = 0;
+    val = strtol (arg, &end, 10);
+    if (end == arg || val < 0 || errno != 0) {
+        return false;
+    }
+    switch (*end) {
+    case 'k': case 'K': mult = 1L << 10; end++; break;
+    case 'm': case 'M': mult = 1L << 20; end++; break;
+    case 'g': case 'G': mult = 1L << 30; end++; break;
+    case 't': case 'T': mult = 1L << 40; end++; break;
+    default: break;
+    }
+    if (*end != '\0' || val > LONG_MAX / mult) {
+        return false;
+    }
+    *count = val * mult;
+    return true;
+}
+
 static void sig_handler(int signum){
   printf("\n [%d] Intercepted signal %d. Aborting test.\n", getpid(), signum);
   exit (1);
@@ -86,14 +159,86 @@ static void print_help (int argc, char **argv)
                "         M      Unified memory (i.e hipMallocManaged)\n"
                "         O      Device accessible page locked host memory (i.e. hipHostMalloc)\n"
                "         R      Registered host memory (i.e. hipHostRegister)\n"
-	       "   elements:  number of elements to send/recv\n"
-               "   sleepTime: time in seconds to sleep (optional)\n");
+               "         P      Huge page host memory (i.e. mmap with MAP_HUGETLB or MADV_HUGEPAGE)\n"
+               "         F      File backed host memory (i.e. mmap of a file)\n"
+               "         A      Device memory from the stream ordered memory pool (i.e. hipMallocAsync)\n"
+	       "   elements:  number of elements to send/recv, optionally with a suffix\n"
+               "              K, M, G or T for multiples of 2^10, 2^20, 2^30 or 2^40\n"
+               "   sleepTime: time in seconds to sleep (optional)\n"
+               "   Buffer placement:\n"
+               "         --send-offset <n>            start the send buffer n bytes past an aligned address\n"
+               "         --recv-offset <n>            start the receive buffer n bytes past an aligned address\n"
+               "         --align <n>                  alignment in bytes the offsets are applied to\n"
+               "                                      (default: alignment of the allocator)\n"
+               "   Multi-peer tests only (hip_pt2pt_nb, hip_alltoall, hip_allgather):\n"
+               "         --layout <layout>            placement of the data of each peer and report of the time\n"
+               "                                      of the first and subsequent operations, with layout being\n"
+               "                                      slab (one allocation, default), per-peer (one allocation\n"
+               "                                      per peer) or region (page separated slices of one allocation)\n"
+               "   Nonblocking point-to-point tests only (hip_pt2pt_nb*, hip_pt2pt_persistent,\n"
+               "   hip_sendtoself_stress, hip_type_*, hip_progress_bench):\n"
+               "         --pattern <pattern>          peers each process exchanges data with, pattern being one of\n"
+               "                                      all, ring, xor, random, incast[:root], outcast[:root],\n"
+               "                                      hotspot[:root], grid[:dims] (default: all, ring for hip_type_*)\n"
+               "         --pattern-seed <n>           seed of the permutations of random and hotspot (default 1)\n"
+               "         --window <num>               keep at most num (>= 2) requests outstanding per process\n"
+               "                                      and refill them with MPI_Waitsome (hip_pt2pt_nb,\n"
+               "                                      hip_pt2pt_nb_testall, hip_pt2pt_nb_stress), the\n"
+               "                                      hip_window_bench scales from 2 to num (default 2*np)\n"
+               "   File I/O tests only:\n"
+               "         --file-verify <stream|mmap>  read the output file in chunks with read-ahead (default)\n"
+               "                                      or through a memory mapping for verification\n"
+               "         --keep-page-cache            do not evict input files from the page cache\n"
+               "                                      before reading them\n"
+               "   Stress tests only:\n"
+               "         --pipeline <depth>           reuse a ring of depth (>= 2) buffers and verify completed\n"
+               "                                      iterations while later ones are in flight\n"
+               "         --iterations <num>           number of iterations to execute\n"
+               "         --msg-sizes <dist>           draw the size of every message of hip_pt2pt_nb_stress from\n"
+               "                                      dist, one of fixed (default), loguniform, bimodal[:percent]\n"
+               "                                      or trace:<file>, and report the throughput\n"
+               "         --msg-size-seed <n>          seed of the message sizes (default 1)\n"
+               "   Multithreaded tests only (hip_pt2pt_mt*, hip_pt2pt_mt_bench):\n"
+               "         --threads <num>              number of communicating threads per process (default 4),\n"
+               "                                      the benchmark scales from 1 to num threads\n"
+               "         --thread-comm                separate the traffic of the threads by a duplicate of the\n"
+               "                                      communicator per thread instead of a tag per thread\n"
+               "   Message matching tests only (hip_pt2pt_matching, hip_matching_bench):\n"
+               "         --queue-depth <num>          number of messages sent by every process to process 0\n"
+               "                                      (default 1024), the benchmark scales from 1 to num\n"
+               "         --tags <num>                 number of tags the messages are spread across (default 16)\n"
+               "   Progress strategy benchmark only:\n"
+               "         --progress-backoff <usec>    maximum sleep between the polls of the testall-backoff\n"
+               "                                      strategy, doubled from 1 usec on (default 1)\n"
+               "   Point-to-point benchmark only:\n"
+               "         --protocol-fit <steps>       sweep steps message sizes per power of two and detect the\n"
+               "                                      protocol switch points from the latency curve\n"
+               "   Buffered send benchmark only:\n"
+               "         --bsend-window <num>         maximum number of outstanding sends, the benchmark\n"
+               "                                      scales from 1 to num by factors of 4 (default 16)\n"
+               "   Registration cache benchmark only:\n"
+               "         --churn-pool <num>           number of buffers cycled through in pool mode (default 8)\n"
+               "   Host memory types only:\n"
+               "         --numa <policy>              place host buffers according to policy and report the\n"
+               "                                      NUMA nodes holding them, with policy being one of\n"
+               "                                      first-touch, local, node:<n>, interleave, nic-local\n"
+               "         --prefault <policy>          fault in the pages of host buffers after allocating them\n"
+               "                                      and report the page faults in timed regions, with policy\n"
+               "                                      being one of none, populate, touch, mlock\n"
+               "   File backed memory type only:\n"
+               "         --mmap-path <dir>            directory of the files backing the buffers\n"
+               "                                      (default $TMPDIR or /tmp)\n"
+               "         --mmap-populate              populate the mappings when creating them (MAP_POPULATE)\n"
+               "   Memory pool type only:\n"
+               "         --pool-release-threshold <n> bytes kept reserved by the pool (default: unchanged)\n"
+               "         --pool-reuse <policies>      allowed reuse policies, none or a comma separated list of\n"
+               "                                      follow-events, opportunistic, internal-deps (default: unchanged)\n");
     }
 }
 
 extern hip_mpitest_buffer *sendbuf;
 extern hip_mpitest_buffer *recvbuf;
-extern int elements;
+extern long elements;
 
 static void parse_args ( int argc, char **argv, MPI_Comm comm )
 {
@@ -102,7 +247,35 @@ static void parse_args ( int argc, char **argv, MPI_Comm comm )
         {"recvbuftype", required_argument, 0, 'r'},
         {"elements",    required_argument, 0, 'n'},
         {"sleeptime",   required_argument, 0, 't'},
-        {"help",        no_argument,       0, 'h'}
+        {"help",        no_argument,       0, 'h'},
+        {"file-verify",     required_argument, 0, HIP_MPITEST_OPT_FILE_VERIFY},
+        {"keep-page-cache", no_argument,       0, HIP_MPITEST_OPT_KEEP_PAGECACHE},
+        {"pipeline",        required_argument, 0, HIP_MPITEST_OPT_PIPELINE},
+        {"iterations",      required_argument, 0, HIP_MPITEST_OPT_ITERATIONS},
+        {"numa",            required_argument, 0, HIP_MPITEST_OPT_NUMA},
+        {"mmap-path",       required_argument, 0, HIP_MPITEST_OPT_MMAP_PATH},
+        {"mmap-populate",   no_argument,       0, HIP_MPITEST_OPT_MMAP_POPULATE},
+        {"pool-release-threshold", required_argument, 0, HIP_MPITEST_OPT_POOL_THRESHOLD},
+        {"pool-reuse",      required_argument, 0, HIP_MPITEST_OPT_POOL_REUSE},
+        {"send-offset",     required_argument, 0, HIP_MPITEST_OPT_SEND_OFFSET},
+        {"recv-offset",     required_argument, 0, HIP_MPITEST_OPT_RECV_OFFSET},
+        {"align",           required_argument, 0, HIP_MPITEST_OPT_ALIGN},
+        {"churn-pool",      required_argument, 0, HIP_MPITEST_OPT_CHURN_POOL},
+        {"layout",          required_argument, 0, HIP_MPITEST_OPT_LAYOUT},
+        {"prefault",        required_argument, 0, HIP_MPITEST_OPT_PREFAULT},
+        {"pattern",         required_argument, 0, HIP_MPITEST_OPT_PATTERN},
+        {"pattern-seed",    required_argument, 0, HIP_MPITEST_OPT_PATTERN_SEED},
+        {"progress-backoff", required_argument, 0, HIP_MPITEST_OPT_PROGRESS_BACKOFF},
+        {"threads",         required_argument, 0, HIP_MPITEST_OPT_THREADS},
+        {"thread-comm",     no_argument,       0, HIP_MPITEST_OPT_THREAD_COMM},
+        {"queue-depth",     required_argument, 0, HIP_MPITEST_OPT_QUEUE_DEPTH},
+        {"tags",            required_argument, 0, HIP_MPITEST_OPT_TAGS},
+        {"protocol-fit",    required_argument, 0, HIP_MPITEST_OPT_PROTOCOL_FIT},
+        {"bsend-window",    required_argument, 0, HIP_MPITEST_OPT_BSEND_WINDOW},
+        {"msg-sizes",       required_argument, 0, HIP_MPITEST_OPT_MSG_SIZES},
+        {"msg-size-seed",   required_argument, 0, HIP_MPITEST_OPT_MSG_SIZE_SEED},
+        {"window",          required_argument, 0, HIP_MPITEST_OPT_WINDOW},
+        {0, 0, 0, 0}
     };
 
     int longindex, stime=0;
@@ -126,7 +299,16 @@ static void parse_args ( int argc, char **argv, MPI_Comm comm )
             SET_MEMBUF_TYPE(optarg, recvbuf, argc, argv, comm);
             break;
         case 'n' :
-            elements = atoi(optarg);
+            if (!hip_mpitest_parse_count(optarg, &elements)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            if (elements > hip_mpitest_max_elements) {
+                printf("Invalid input %s, this test supports at most %ld elements\n", optarg,
+                       hip_mpitest_max_elements);
+                MPI_Abort (comm, 1);
+            }
             break;
         case 't' :
             stime = atoi(optarg);
@@ -135,6 +317,188 @@ static void parse_args ( int argc, char **argv, MPI_Comm comm )
                 sleep (stime);
             }
             break;
+        case HIP_MPITEST_OPT_FILE_VERIFY :
+            if (strcmp(optarg, "stream") == 0) {
+                hip_mpitest_file_verify_mode = HIP_MPITEST_FILE_VERIFY_STREAM;
+            }
+            else if (strcmp(optarg, "mmap") == 0) {
+                hip_mpitest_file_verify_mode = HIP_MPITEST_FILE_VERIFY_MMAP;
+            }
+            else {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_KEEP_PAGECACHE :
+            hip_mpitest_file_dropcache = false;
+            break;
+        case HIP_MPITEST_OPT_PIPELINE :
+            hip_mpitest_pipeline_depth = atoi(optarg);
+            if (hip_mpitest_pipeline_depth < 2) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_NUMA :
+            if (!hip_mpitest_numa_parse(optarg)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_MMAP_PATH :
+            hip_mpitest_mmap_path = optarg;
+            break;
+        case HIP_MPITEST_OPT_MMAP_POPULATE :
+            hip_mpitest_mmap_populate = true;
+            break;
+        case HIP_MPITEST_OPT_POOL_THRESHOLD :
+            hip_mpitest_pool_release_threshold = atoll(optarg);
+            if (hip_mpitest_pool_release_threshold < 0) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_POOL_REUSE :
+            if (!hip_mpitest_pool_reuse_parse(optarg)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_SEND_OFFSET :
+        case HIP_MPITEST_OPT_RECV_OFFSET :
+        case HIP_MPITEST_OPT_ALIGN : {
+            long val = atol(optarg);
+            if (val < 0) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            if (HIP_MPITEST_OPT_SEND_OFFSET == c) {
+                hip_mpitest_send_offset = (size_t)val;
+            }
+            else if (HIP_MPITEST_OPT_RECV_OFFSET == c) {
+                hip_mpitest_recv_offset = (size_t)val;
+            }
+            else {
+                hip_mpitest_align = (size_t)val;
+            }
+            break;
+        }
+        case HIP_MPITEST_OPT_CHURN_POOL :
+            hip_mpitest_churn_pool = atoi(optarg);
+            if (hip_mpitest_churn_pool < 1) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_LAYOUT :
+            if (!hip_mpitest_layout_parse(optarg)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_PREFAULT :
+            if (!hip_mpitest_prefault_parse(optarg)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_PATTERN :
+            if (!hip_mpitest_pattern_parse(optarg)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_PATTERN_SEED :
+            hip_mpitest_pattern_seed = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case HIP_MPITEST_OPT_MSG_SIZES :
+            if (!hip_mpitest_msgsize_parse(optarg)) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_MSG_SIZE_SEED :
+            hip_mpitest_msgsize_seed = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case HIP_MPITEST_OPT_WINDOW :
+            hip_mpitest_window_depth = atoi(optarg);
+            if (hip_mpitest_window_depth < 2) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_PROGRESS_BACKOFF :
+            hip_mpitest_progress_backoff = atol(optarg);
+            if (hip_mpitest_progress_backoff < 1) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_THREADS :
+            hip_mpitest_threads = atoi(optarg);
+            if (hip_mpitest_threads < 1) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_THREAD_COMM :
+            hip_mpitest_thread_comm = true;
+            break;
+        case HIP_MPITEST_OPT_QUEUE_DEPTH :
+        case HIP_MPITEST_OPT_TAGS : {
+            int val = atoi(optarg);
+            if (val < 1) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            if (HIP_MPITEST_OPT_QUEUE_DEPTH == c) {
+                hip_mpitest_queue_depth = val;
+            }
+            else {
+                hip_mpitest_tags = val;
+            }
+            break;
+        }
+        case HIP_MPITEST_OPT_BSEND_WINDOW :
+            hip_mpitest_bsend_window = atoi(optarg);
+            if (hip_mpitest_bsend_window < 1) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_PROTOCOL_FIT :
+            hip_mpitest_protocol_steps = atoi(optarg);
+            if (hip_mpitest_protocol_steps < 1 ||
+                hip_mpitest_protocol_steps > HIP_MPITEST_FIT_MAXSTEPS) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
+        case HIP_MPITEST_OPT_ITERATIONS :
+            hip_mpitest_iterations = atol(optarg);
+            if (hip_mpitest_iterations < 1) {
+                printf("Invalid input %s\n", optarg);
+                print_help(argc, argv);
+                MPI_Abort (comm, 1);
+            }
+            break;
         default :
             print_help(argc, argv);
             MPI_Finalize();
@@ -148,6 +512,8 @@ static void parse_args ( int argc, char **argv, MPI_Comm comm )
     if (recvbuf == NULL) {
         SET_MEMBUF_TYPE("D", recvbuf, argc, argv, comm);
     }
+    sendbuf->set_offset(hip_mpitest_send_offset, hip_mpitest_align);
+    recvbuf->set_offset(hip_mpitest_recv_offset, hip_mpitest_align);
 
     signal(SIGABRT, sig_handler);
     signal(SIGILL,  sig_handler);
@@ -157,6 +523,9 @@ static void parse_args ( int argc, char **argv, MPI_Comm comm )
     return;
 }
 
+// Set by bind_device() if the process was bound by its local rank
+static int hip_mpitest_local_rank = -1;
+
 static void bind_device()
 {
     int num_devices;
@@ -170,12 +539,61 @@ static void bind_device()
         int lrank  = atoi(local_rank);
 	int device = lrank % num_devices;
 	HIP_CHECK(hipSetDevice(device));
+        hip_mpitest_local_rank = lrank;
     }
 
  out:
     return;
 }
 
+// GPU and NUMA placement of a process, exchanged as MPI_BYTE
+struct hip_mpitest_placement {
+    char host[64];
+    char busid[32];   // PCI bus id of the GPU
+    int  local_rank;
+    int  device;
+    int  gpu_numa;    // NUMA node of the GPU
+    int  cpu;         // CPU the process runs on when queried
+    int  cpu_numa;
+};
+
+// Determine the placement of the calling process, after bind_device()
+// and MPI_Init. Unknown entries are -1 or empty.
+static inline void hip_mpitest_get_placement (hip_mpitest_placement *p)
+{
+    char path[128];
+    int len;
+    unsigned cpu, node;
+
+    memset (p, 0, sizeof(hip_mpitest_placement));
+    p->local_rank = hip_mpitest_local_rank;
+    p->device = p->gpu_numa = p->cpu = p->cpu_numa = -1;
+
+    char host[MPI_MAX_PROCESSOR_NAME];
+    MPI_Get_processor_name (host, &len);
+    snprintf(p->host, sizeof(p->host), "%s", host);
+
+    if (hipGetDevice(&p->device) != hipSuccess) {
+        p->device = -1;
+    }
+    else if (hipDeviceGetPCIBusId(p->busid, sizeof(p->busid), p->device) == hipSuccess) {
+        // sysfs uses lower case hex digits
+        for (char *c = p->busid; *c != '\0'; c++) {
+            *c = tolower(*c);
+        }
+        snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/numa_node", p->busid);
+        p->gpu_numa = hip_mpitest_numa_read_node(path);
+    }
+    else {
+        p->busid[0] = '\0';
+    }
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+        p->cpu      = (int)cpu;
+        p->cpu_numa = (int)node;
+    }
+}
+
 static void report_buffertype (MPI_Comm comm, const char *name, hip_mpitest_buffer *buf)
 {
 #ifdef VERBOSE
@@ -189,9 +607,103 @@ static void report_buffertype (MPI_Comm comm, const char *name, hip_mpitest_buff
 #endif
 }
 
+// Determine the range of allocation policies applied to a buffer across
+// all processes, which can differ depending on the resources available
+// on each node. range[0] is -1 if the memory type has no policy.
+static void get_bufferpolicy (MPI_Comm comm, hip_mpitest_buffer *buf, int range[2])
+{
+    int p = (NULL != buf && NULL != buf->get_buffer()) ? buf->get_policy() : -1;
+    int lrange[2] = {p >= 0 ? p : INT_MAX, p >= 0 ? -p : INT_MAX};
+
+    MPI_Allreduce (lrange, range, 2, MPI_INT, MPI_MIN, comm);
+    if (range[0] == INT_MAX) {
+        range[0] = range[1] = -1;
+    }
+    else {
+        range[1] = -range[1];
+    }
+}
+
+static void print_bufferpolicy (const char *name, hip_mpitest_buffer *buf, int range[2])
+{
+    if (range[0] < 0) {
+        return;
+    }
+    if (range[0] == range[1]) {
+        printf("%s %c allocated with %s\n", name, buf->get_memchar(),
+               buf->get_policy_name(range[0]));
+    }
+    else {
+        printf("%s %c allocated with %s to %s\n", name, buf->get_memchar(),
+               buf->get_policy_name(range[0]), buf->get_policy_name(range[1]));
+    }
+}
+
+static void print_bufferoffset (const char *name, hip_mpitest_buffer *buf)
+{
+    if (NULL == buf || (0 == buf->get_offset() && 0 == buf->get_align())) {
+        return;
+    }
+    if (buf->get_align() > 1) {
+        printf("%s %c starts %lu bytes past a %lu byte aligned address\n", name,
+               buf->get_memchar(), buf->get_offset(), buf->get_align());
+    }
+    else {
+        printf("%s %c starts %lu bytes past the allocated address\n", name,
+               buf->get_memchar(), buf->get_offset());
+    }
+}
+
+// Sum and maximum per process of the minor and major page faults taken
+// in the timed regions since the last call
+static void get_pagefaults (MPI_Comm comm, long sum[2], long max[2])
+{
+    long faults[2];
+
+    hip_mpitest_pagefaults_get(faults);
+    MPI_Reduce (faults, sum, 2, MPI_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce (faults, max, 2, MPI_LONG, MPI_MAX, 0, comm);
+}
+
+// Determine the NUMA nodes holding the pages of a host buffer on all
+// processes, and the number of processes whose pages are spread across
+// several nodes.
+static void get_buffernuma (MPI_Comm comm, hip_mpitest_buffer *buf, unsigned long *nodemask,
+                            int *nspread)
+{
+    unsigned long lmask=0;
+    int spread;
+
+    if (NULL != buf && NULL != buf->get_buffer() && buf->IsHostMemory()) {
+        hip_mpitest_numa_query (buf->get_buffer(), buf->get_size(), &lmask);
+    }
+    spread = __builtin_popcountl(lmask) > 1 ? 1 : 0;
+    MPI_Allreduce (&lmask, nodemask, 1, MPI_UNSIGNED_LONG, MPI_BOR, comm);
+    MPI_Allreduce (&spread, nspread, 1, MPI_INT, MPI_SUM, comm);
+}
+
+static void print_buffernuma (const char *name, hip_mpitest_buffer *buf, unsigned long nodemask,
+                              int nspread, int nprocs)
+{
+    char nodes[256]="";
+    int len=0;
+
+    if (0 == nodemask) {
+        return;
+    }
+    for (int i=0; i<(int)(8*sizeof(unsigned long)) && len < (int)sizeof(nodes); i++) {
+        if (nodemask & (1UL << i)) {
+            len += snprintf(nodes+len, sizeof(nodes)-len, "%s%d", len ? "," : "", i);
+        }
+    }
+    printf("%s %c NUMA %s: pages on node(s) %s, spread over several nodes on %d of %d processes\n",
+           name, buf->get_memchar(), hip_mpitest_numa_policy_names[hip_mpitest_numa_policy],
+           nodes, nspread, nprocs);
+}
+
 
 static void report_performance (char *exec, MPI_Comm comm, char sendtype, char recvtype,
-                                int elements, long nBytes, int niter, double time)
+                                long elements, long nBytes, int niter, double time)
 {
 #if HIP_MPITEST_PERFRESULTS
     int rank, size;
@@ -204,15 +716,15 @@ static void report_performance (char *exec, MPI_Comm comm, char sendtype, char r
 
     if (rank == 0) {
         if (nBytesKB == 0) {
-            printf("%s %c %c: No. of elements: %d Msg length: %ld Bytes ",
+            printf("%s %c %c: No. of elements: %ld Msg length: %ld Bytes ",
                    basename(exec), sendtype, recvtype, elements, nBytes);
         }
         else if (nBytesMB < 10) {
-            printf("%s %c %c: No. of elements: %d Msg length: %ld KBytes ",
+            printf("%s %c %c: No. of elements: %ld Msg length: %ld KBytes ",
                    basename(exec), sendtype, recvtype, elements, nBytesKB);
         }
         else {
-            printf("%s %c %c: No. of elements: %d Msg length: %ld MBytes ",
+            printf("%s %c %c: No. of elements: %ld Msg length: %ld MBytes ",
                    basename(exec), sendtype, recvtype, elements, nBytesMB);
         }
     }
@@ -238,11 +750,46 @@ static bool report_testresult (char *exec, MPI_Comm comm, char sendtype, char re
     MPI_Comm_rank (comm, &rank);
     char execname[32];
 
+    int spolicy[2], rpolicy[2];
+    unsigned long snuma, rnuma;
+    int sspread, rspread, nprocs;
+    long fsum[2], fmax[2];
+
+    MPI_Comm_size (comm, &nprocs);
     pret = ret == true ? 1 : 0;
     snprintf(execname, 32, "%s %c %c :", basename(exec), sendtype, recvtype);
     MPI_Reduce(&pret, &gret, 1, MPI_INT, MPI_MIN, 0, comm);
+    get_bufferpolicy (comm, sendbuf, spolicy);
+    get_bufferpolicy (comm, recvbuf, rpolicy);
+    if (hip_mpitest_numa_report) {
+        get_buffernuma (comm, sendbuf, &snuma, &sspread);
+        get_buffernuma (comm, recvbuf, &rnuma, &rspread);
+    }
+    if (hip_mpitest_prefault_report) {
+        get_pagefaults (comm, fsum, fmax);
+    }
     if (rank == 0 ) {
         printf ("%-32s \t [%s]\n", execname, gret != 0 ? "SUCCESS" : "FAILED");
+        print_bufferpolicy ("   Sendbuf", sendbuf, spolicy);
+        print_bufferpolicy ("   Recvbuf", recvbuf, rpolicy);
+        print_bufferoffset ("   Sendbuf", sendbuf);
+        print_bufferoffset ("   Recvbuf", recvbuf);
+        if (hip_mpitest_numa_report) {
+            print_buffernuma ("   Sendbuf", sendbuf, snuma, sspread, nprocs);
+            print_buffernuma ("   Recvbuf", recvbuf, rnuma, rspread, nprocs);
+        }
+        if (hip_mpitest_pattern >= 0) {
+            hip_mpitest_pattern_print();
+        }
+        if (HIP_MPITEST_MSGSIZE_FIXED != hip_mpitest_msgsize_dist) {
+            hip_mpitest_msgsize_print();
+        }
+        if (hip_mpitest_prefault_report && hip_mpitest_pagefaults_timed) {
+            printf("   Page faults in timed regions with prefault policy %s: minor %ld (max. %ld per "
+                   "process), major %ld (max. %ld per process)\n",
+                   hip_mpitest_prefault_names[hip_mpitest_prefault_policy], fsum[0], fmax[0],
+                   fsum[1], fmax[1]);
+        }
     }
     return (bool)gret;
 }
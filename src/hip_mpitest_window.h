@@ -0,0 +1,157 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_MPITEST_WINDOW__
+#define __HIP_MPITEST_WINDOW__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mpi.h"
+
+// Set through the --window option. 0 posts all requests of an exchange
+// at once.
+static int hip_mpitest_window_depth = 0;
+
+// Peer and direction of operation op of an exchange with every process.
+// Operation 2*k receives from rank-k and operation 2*k+1 sends to rank+k,
+// such that the receive matching a send is at the same position on the
+// peer. With at most depth >= 2 operations outstanding, the operations of
+// the lowest position not completed on all processes are always posted,
+// hence the exchange can not deadlock.
+static inline int hip_mpitest_window_peer (int rank, int size, long op, bool *is_send)
+{
+    int k = (int)((op / 2) % size);
+
+    *is_send = (op % 2) == 1;
+    return *is_send ? (rank + k) % size : (rank - k + size) % size;
+}
+
+// Posts a sequence of nonblocking operations keeping at most depth of
+// them outstanding. The slots of completed requests, as reported by
+// MPI_Waitsome, are refilled with the next operations, such that the
+// number of requests is bounded by depth instead of growing with the
+// number of peers.
+class hip_mpitest_window {
+ private:
+    int          depth;
+    bool         poll;      // MPI_Testsome polling instead of MPI_Waitsome
+    MPI_Request *reqs;
+    int         *indices;
+    int         *freeslots;
+    long         nwaits;
+
+    void Free () {
+        free (reqs);
+        free (indices);
+        free (freeslots);
+        reqs      = NULL;
+        indices   = NULL;
+        freeslots = NULL;
+    }
+
+ public:
+    hip_mpitest_window () : depth(0), poll(false), reqs(NULL), indices(NULL), freeslots(NULL),
+                            nwaits(0) {}
+
+    hip_mpitest_window (const hip_mpitest_window &) = delete;
+    hip_mpitest_window &operator= (const hip_mpitest_window &) = delete;
+
+    ~hip_mpitest_window () {
+        Free();
+    }
+
+    int Init (int window_depth, bool use_testsome=false) {
+        Free();
+        depth     = window_depth;
+        poll      = use_testsome;
+        nwaits    = 0;
+        reqs      = (MPI_Request *) malloc (depth * sizeof(MPI_Request));
+        indices   = (int *) malloc (depth * sizeof(int));
+        freeslots = (int *) malloc (depth * sizeof(int));
+        if (NULL == reqs || NULL == indices || NULL == freeslots) {
+            printf("hip_mpitest_window: Could not allocate memory\n");
+            Free();
+            return MPI_ERR_NO_MEM;
+        }
+        for (int i=0; i<depth; i++) {
+            reqs[i] = MPI_REQUEST_NULL;
+        }
+        return MPI_SUCCESS;
+    }
+
+    // Executes operations 0 to nops-1. post(op, &req) starts operation op
+    // and returns an MPI error code, leaving req MPI_REQUEST_NULL if there
+    // is nothing to do for op.
+    template <typename Post>
+    int Run (long nops, Post post) {
+        int ret=MPI_SUCCESS, nfree=depth, outcount;
+        long next=0, done=0;
+
+        for (int i=0; i<depth; i++) {
+            freeslots[i] = depth - 1 - i;
+        }
+        while (done < nops) {
+            while (next < nops && nfree > 0) {
+                int slot = freeslots[--nfree];
+                reqs[slot] = MPI_REQUEST_NULL;
+                ret = post(next++, &reqs[slot]);
+                if (MPI_SUCCESS != ret) {
+                    return ret;
+                }
+                if (MPI_REQUEST_NULL == reqs[slot]) {
+                    freeslots[nfree++] = slot;
+                    done++;
+                }
+            }
+            if (done == nops) {
+                break;
+            }
+            nwaits++;
+            if (poll) {
+                do {
+                    usleep(1);
+                    ret = MPI_Testsome (depth, reqs, &outcount, indices, MPI_STATUSES_IGNORE);
+                } while (MPI_SUCCESS == ret && 0 == outcount);
+            }
+            else {
+                ret = MPI_Waitsome (depth, reqs, &outcount, indices, MPI_STATUSES_IGNORE);
+            }
+            if (MPI_SUCCESS != ret) {
+                return ret;
+            }
+            for (int i=0; i<outcount; i++) {
+                freeslots[nfree++] = indices[i];
+                done++;
+            }
+        }
+        return MPI_SUCCESS;
+    }
+
+    // Number of times Run waited for completions since Init
+    long GetNumWaits () const {
+        return nwaits;
+    }
+};
+
+#endif // __HIP_MPITEST_WINDOW__
@@ -29,34 +29,34 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements=1024;
+long elements=1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (int *sendbuf, int count, int mynode)
+static void init_sendbuf (int *sendbuf, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = mynode;
     }
 }
 
-static void init_recvbuf (int *recvbuf, int count )
+static void init_recvbuf (int *recvbuf, long count )
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0;
     }
 }
 
-static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
+static bool check_recvbuf (int *recvbuf, int nProcs, int rank, long count)
 {
     bool res = true;
-    int k=0;
+    long k=0;
     for (int i=0; i<nProcs; i++) {
-        for (int j=0; j < count; j++, k++) {
+        for (long j=0; j < count; j++, k++) {
             if (recvbuf[k] != i) {
                 res = false;
 #ifdef VERBOSE
-                printf("recvbuf[%d] = %d\n", k, recvbuf[k]);
+                printf("recvbuf[%ld] = %d\n", k, recvbuf[k]);
 #endif
                 break;
             }
@@ -65,7 +65,7 @@ static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
     return res;
 }
 
-static int type_osc_test ( void *sendbuf, void *recvbuf, int count,
+static int type_osc_test ( void *sendbuf, void *recvbuf, long count,
                            MPI_Datatype datatype, int root, MPI_Comm comm, MPI_Win win);
 
 int main (int argc, char *argv[])
@@ -149,7 +149,7 @@ int main (int argc, char *argv[])
 }
 
 
-int type_osc_test (void *sbuf, void *rbuf, int count,
+int type_osc_test (void *sbuf, void *rbuf, long count,
                    MPI_Datatype datatype, int root, MPI_Comm comm, MPI_Win win)
 {
     int size, rank, ret;
@@ -29,33 +29,33 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements=1024;
+long elements=1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (int *sendbuf, int count, int mynode)
+static void init_sendbuf (int *sendbuf, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = mynode;
     }
 }
 
-static void init_recvbuf (int *recvbuf, int count )
+static void init_recvbuf (int *recvbuf, long count )
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0;
     }
 }
 
-static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
+static bool check_recvbuf (int *recvbuf, int nProcs, int rank, long count)
 {
     bool res = true;
     int result = (nProcs * (nProcs - 1)) / 2 ;
-        for (int j=0; j < count; j++) {
+        for (long j=0; j < count; j++) {
             if (recvbuf[j] != result) {
                 res = false;
 #ifdef VERBOSE
-                printf("recvbuf[%d] = %d\n", k, recvbuf[k]);
+                printf("recvbuf[%ld] = %d\n", j, recvbuf[j]);
 #endif
                 break;
             }
@@ -63,7 +63,7 @@ static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
     return res;
 }
 
-static int type_osc_accumulate_test ( void *sendbuf, void *recvbuf, int count,
+static int type_osc_accumulate_test ( void *sendbuf, void *recvbuf, long count,
                            MPI_Datatype datatype, MPI_Comm comm, MPI_Win win);
 
 int main (int argc, char *argv[])
@@ -134,7 +134,7 @@ int main (int argc, char *argv[])
     return fret ? 0 : 1;
 }
 
-int type_osc_accumulate_test (void *sbuf, void *rbuf, int count,
+int type_osc_accumulate_test (void *sbuf, void *rbuf, long count,
                    MPI_Datatype datatype, MPI_Comm comm, MPI_Win win)
 {
     int size, rank, ret;
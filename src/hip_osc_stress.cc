@@ -28,53 +28,75 @@
 
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_pipeline.h"
 #define NUM_NB_ITERATIONS 29
-int elements=1024;
+long elements=1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_buf (int *sendbuf, int count, int mynode)
+// Number of iterations whose buffers are allocated at once. Either all
+// iterations, or the depth of the ring in streaming mode.
+static int num_slots=NUM_NB_ITERATIONS;
+static int test_nprocs, test_rank;
+
+static void init_buf (int *sendbuf, long count, int mynode)
 {
-    int realcount = count / 2;
-    int scount = realcount / NUM_NB_ITERATIONS;
-    int nProcs = scount / elements;
+    long realcount = count / 2;
+    long scount = realcount / num_slots;
+    int nProcs = (int)(scount / elements);
 
     /* first half of the buffer used as result/receive buffer */
-    for (int i = 0; i < realcount; i++) {
+    for (long i = 0; i < realcount; i++) {
         sendbuf[i] = 0;
     }
 
     /* second half contains the actual data that will be fetched/provided */
-    int l=0;
-    for (int iteration=0; iteration < NUM_NB_ITERATIONS; iteration++) {
-        for (int i = 0; i < scount; i++, l++) {
+    long l=0;
+    for (int iteration=0; iteration < num_slots; iteration++) {
+        for (long i = 0; i < scount; i++, l++) {
             sendbuf[realcount+l] = mynode + 1 + iteration * nProcs;
         }
     }
 }
 
-static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
+static bool check_recvbuf_slot (int *recvbuf, int nProcs, int rank, long count, int iteration)
 {
     bool res=true;
-    int  l=0;
-    for (int iteration=0; iteration < NUM_NB_ITERATIONS; iteration++) {
-        for (int recvrank=0; recvrank < nProcs; recvrank++) {
-            for (int i=0; i < count; i++, l++) {
-                if (recvbuf[l] != recvrank + 1 + iteration * nProcs) {
-                    res = false;
+    long l=0;
+    for (int recvrank=0; recvrank < nProcs; recvrank++) {
+        for (long i=0; i < count; i++, l++) {
+            if (recvbuf[l] != recvrank + 1 + iteration * nProcs) {
+                res = false;
 #ifdef VERBOSE
-                    printf("[%d] recvbuf[%d] = %d expected %d\n", rank, l, recvbuf[l],
-                           (recvrank+1 + iteration * nProcs));
+                printf("[%d] recvbuf[%ld] = %d expected %d\n", rank, l, recvbuf[l],
+                       (recvrank+1 + iteration * nProcs));
 #endif
-                    break;
-                }
+                break;
             }
         }
     }
     return res;
 }
 
-int type_osc_stress_test (int *buf, int count,  MPI_Comm comm, MPI_Win win);
+static bool check_recvbuf (int *recvbuf, int nProcs, int rank, long count)
+{
+    bool res=true;
+    for (int iteration=0; iteration < num_slots; iteration++) {
+        res &= check_recvbuf_slot (&recvbuf[(long)iteration*nProcs*count], nProcs, rank, count,
+                                   iteration);
+    }
+    return res;
+}
+
+// Executed on the helper thread of the streaming mode
+static bool check_slot (void *buf, int slot, long iteration)
+{
+    return check_recvbuf_slot ((int *)buf, test_nprocs, test_rank, elements, slot);
+}
+
+int type_osc_stress_test (int *buf, long count,  MPI_Comm comm, MPI_Win win);
+int type_osc_stream_test (hip_mpitest_buffer *buf, int *tmpbuf, long count, MPI_Comm comm,
+                          MPI_Win win, long niterations, bool *res);
 
 int main (int argc, char *argv[])
 {
@@ -90,34 +112,49 @@ int main (int argc, char *argv[])
 
     parse_args(argc, argv, MPI_COMM_WORLD);
 
+    long niterations;
+    bool res, fret;
+    niterations = hip_mpitest_iterations > 0 ? hip_mpitest_iterations : NUM_NB_ITERATIONS;
+    num_slots   = hip_mpitest_pipeline_depth > 0 ? hip_mpitest_pipeline_depth : niterations;
+    test_nprocs = nProcs;
+    test_rank   = rank;
+
     int *tmpbuf=NULL;
     // Initialise global buffer
-    ALLOCATE_SENDBUFFER(sendbuf, tmpbuf, int, 2*nProcs*elements*NUM_NB_ITERATIONS, sizeof(int),
+    ALLOCATE_SENDBUFFER(sendbuf, tmpbuf, int, 2*nProcs*elements*num_slots, sizeof(int),
                         rank, MPI_COMM_WORLD, init_buf, out);
 
     //Create window
-    ret = MPI_Win_create (sendbuf->get_buffer(), 2*nProcs*elements*sizeof(int), sizeof(int), MPI_INFO_NULL,
-                          MPI_COMM_WORLD, &win);
+    ret = MPI_Win_create (sendbuf->get_buffer(), 2*nProcs*elements*num_slots*sizeof(int), sizeof(int),
+                          MPI_INFO_NULL, MPI_COMM_WORLD, &win);
     if (MPI_SUCCESS != ret) {
         goto out;
     }
 
-    //execute osc stress test
-    ret = type_osc_stress_test ((int *)sendbuf->get_buffer(), elements, MPI_COMM_WORLD, win);
-    if (MPI_SUCCESS != ret) {
-        printf("Error in type_osc_stress_test. Aborting\n");
-        goto out;
-    }
-
-    // verify results
-    bool res, fret;
-    res = true;
-    if (sendbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(sendbuf->CopyFrom(tmpbuf, 2*nProcs*elements*NUM_NB_ITERATIONS*sizeof(int)));
-        res = check_recvbuf(tmpbuf, nProcs, rank, elements);
+    if (hip_mpitest_pipeline_depth > 0) {
+        // streaming mode: buffers are verified while later iterations are in flight
+        ret = type_osc_stream_test (sendbuf, tmpbuf, elements, MPI_COMM_WORLD, win, niterations, &res);
+        if (MPI_SUCCESS != ret) {
+            printf("Error in type_osc_stream_test. Aborting\n");
+            goto out;
+        }
     }
     else {
-        res = check_recvbuf((int*) sendbuf->get_buffer(), nProcs, rank, elements);
+        //execute osc stress test
+        ret = type_osc_stress_test ((int *)sendbuf->get_buffer(), elements, MPI_COMM_WORLD, win);
+        if (MPI_SUCCESS != ret) {
+            printf("Error in type_osc_stress_test. Aborting\n");
+            goto out;
+        }
+
+        // verify results
+        if (sendbuf->NeedsStagingBuffer()) {
+            HIP_CHECK(sendbuf->CopyFrom(tmpbuf, 2*nProcs*elements*num_slots*sizeof(int)));
+            res = check_recvbuf(tmpbuf, nProcs, rank, elements);
+        }
+        else {
+            res = check_recvbuf((int*) sendbuf->get_buffer(), nProcs, rank, elements);
+        }
     }
     fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), '-', res);
     report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), '-', elements,
@@ -140,7 +177,7 @@ int main (int argc, char *argv[])
 }
 
 
-int type_osc_stress_test (int *sbuf, int count, MPI_Comm comm, MPI_Win win)
+int type_osc_stress_test (int *sbuf, long count, MPI_Comm comm, MPI_Win win)
 {
     int size, rank, ret;
     MPI_Request *reqs;
@@ -150,25 +187,25 @@ int type_osc_stress_test (int *sbuf, int count, MPI_Comm comm, MPI_Win win)
     MPI_Comm_size (comm, &size);
     MPI_Comm_rank (comm, &rank);
 
-    reqs = (MPI_Request*)malloc (size*NUM_NB_ITERATIONS*sizeof(MPI_Request));
+    reqs = (MPI_Request*)malloc (size*num_slots*sizeof(MPI_Request));
     if (NULL == reqs) {
         printf("4. Could not allocate memory. Aborting\n");
         return MPI_ERR_OTHER;
     }
 
-    int datadisp = count * size * NUM_NB_ITERATIONS;
+    long datadisp = count * size * num_slots;
 
     ret = MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
     if (MPI_SUCCESS != ret) {
         goto out;
     }
-    for (int j=0; j<NUM_NB_ITERATIONS; j++) {
+    for (int j=0; j<num_slots; j++) {
         for (int i=0; i<size; i++) {
 #ifdef HIP_MPITEST_OSC_RGET
             tbuf = &sbuf[i*count+j*count*size];
             rdisp = datadisp + rank*count + j*count*size;
 #ifdef VERBOSE
-            printf("[%d] about to Rget from proc %d local_elem %d disp %lu\n", rank, i,
+            printf("[%d] about to Rget from proc %d local_elem %ld disp %lu\n", rank, i,
                    (i*count+j*count*size), rdisp);
 #endif
             ret = MPI_Rget (tbuf, count, MPI_INT, i, rdisp, count, MPI_INT, win, &reqs[size*j+i]);
@@ -176,7 +213,7 @@ int type_osc_stress_test (int *sbuf, int count, MPI_Comm comm, MPI_Win win)
             tbuf = &sbuf[datadisp+i*count+j*count*size];
             rdisp = rank*count + j*count*size;
 #ifdef VERBOSE
-            printf("[%d] about to Rput to proc %d local_elemt %d [value %d] disp %lu\n", rank, i,
+            printf("[%d] about to Rput to proc %d local_elemt %ld [value %d] disp %lu\n", rank, i,
                    (datadisp+i*count+j*count*size), *tbuf, rdisp);
 #endif
             ret = MPI_Rput (tbuf, count, MPI_INT, i, rdisp, count, MPI_INT, win, &reqs[size*j+i]);
@@ -186,7 +223,7 @@ int type_osc_stress_test (int *sbuf, int count, MPI_Comm comm, MPI_Win win)
             }
         }
     }
-    ret = MPI_Waitall (size*NUM_NB_ITERATIONS, reqs, MPI_STATUSES_IGNORE);
+    ret = MPI_Waitall (size*num_slots, reqs, MPI_STATUSES_IGNORE);
     if (MPI_SUCCESS != ret) {
         goto out;
     }
@@ -200,3 +237,112 @@ int type_osc_stress_test (int *sbuf, int count, MPI_Comm comm, MPI_Win win)
     return ret;
 }
 
+
+
+// Streaming version of the test: iteration it uses slot it % depth of
+// the result and data regions of the window. The data regions are not
+// modified, the result slot of a completed iteration is verified on a
+// helper thread and reset before the slot is reused by iteration
+// it + depth.
+// With Rget the result slots are local and up to depth-2 iterations are
+// in flight while one is being checked. With Rput the result slots are
+// written by the peers, hence every completed iteration is flushed and
+// followed by a barrier, after which the slot of the previous iteration
+// is known to be verified and reset on all processes.
+int type_osc_stream_test (hip_mpitest_buffer *buf, int *tmpbuf, long count, MPI_Comm comm,
+                          MPI_Win win, long niterations, bool *res)
+{
+    int size, rank, ret=MPI_SUCCESS;
+    int nslots = hip_mpitest_pipeline_depth;
+    MPI_Request *reqs;
+    int *sbuf = (int *)buf->get_buffer();
+    int *tbuf;
+    MPI_Aint rdisp;
+    hip_mpitest_pipeline *pipe=NULL;
+
+    MPI_Comm_size (comm, &size);
+    MPI_Comm_rank (comm, &rank);
+
+    size_t slotlen = (size_t)count * size;
+    long datadisp = count * size * nslots;
+    reqs    = (MPI_Request*)malloc (size*nslots*sizeof(MPI_Request));
+    if (NULL == reqs) {
+        printf("4. Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    pipe = new hip_mpitest_pipeline(nslots, check_slot);
+
+    ret = MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+    for (long it=0; it < niterations + nslots - 2; it++) {
+        if (it < niterations) {
+            int s = it % nslots;
+#ifdef HIP_MPITEST_OSC_RGET
+            if (it >= nslots) {
+                // wait until iteration it - nslots has been verified
+                pipe->wait(s);
+                HIP_CHECK(buf->Fill(hip_mpitest_fill_zero, NULL, slotlen*sizeof(int), s*slotlen*sizeof(int)));
+            }
+#endif
+            for (int i=0; i<size; i++) {
+#ifdef HIP_MPITEST_OSC_RGET
+                tbuf = &sbuf[i*count+s*slotlen];
+                rdisp = datadisp + rank*count + s*slotlen;
+                ret = MPI_Rget (tbuf, count, MPI_INT, i, rdisp, count, MPI_INT, win, &reqs[size*s+i]);
+#elif defined HIP_MPITEST_OSC_RPUT
+                tbuf = &sbuf[datadisp+i*count+s*slotlen];
+                rdisp = rank*count + s*slotlen;
+                ret = MPI_Rput (tbuf, count, MPI_INT, i, rdisp, count, MPI_INT, win, &reqs[size*s+i]);
+#endif
+                if (MPI_SUCCESS != ret) {
+                    goto out;
+                }
+            }
+        }
+
+        // complete the oldest iteration in flight and hand it to the helper thread
+        long c = it - (nslots - 2);
+        if (c >= 0 && c < niterations) {
+            int s = c % nslots;
+            void *vbuf = &sbuf[s*slotlen];
+            ret = MPI_Waitall (size, &reqs[size*s], MPI_STATUSES_IGNORE);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+#ifdef HIP_MPITEST_OSC_RPUT
+            ret = MPI_Win_flush_all(win);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+            if (c >= 1) {
+                // the slot of iteration c-1 is the next one to be written by the peers
+                int ps = (c - 1) % nslots;
+                pipe->wait(ps);
+                HIP_CHECK(buf->Fill(hip_mpitest_fill_zero, NULL, slotlen*sizeof(int), ps*slotlen*sizeof(int)));
+            }
+            ret = MPI_Barrier(comm);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+#endif
+            if (buf->NeedsStagingBuffer()) {
+                HIP_CHECK(buf->CopyFrom(&tmpbuf[s*slotlen], slotlen*sizeof(int), s*slotlen*sizeof(int)));
+                vbuf = &tmpbuf[s*slotlen];
+            }
+            pipe->submit(s, vbuf, c);
+        }
+    }
+    *res = pipe->wait_all();
+
+    ret = MPI_Win_unlock_all(win);
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+ out:
+    delete (pipe);
+    free (reqs);
+    return ret;
+}
@@ -33,7 +33,7 @@
 
 
 #define NITER 10
-int  elements=3;
+long elements=3;
 
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
@@ -144,7 +144,7 @@ int main (int argc, char *argv[])
     if (recvbuf->NeedsStagingBuffer()) {
 #ifdef HIP_MPITEST_UNPACK
         HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*dat->get_extent()));
-        res = dat->check_recvbuf(tmp_recvbuf, size, rank+1, elements);
+        res = dat->check_recvbuf(tmp_recvbuf, rank, elements);
 #else
         HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, elements*dat->get_num_elements()*sizeof(int)));
         res = check_contg_recvbuf(tmp_recvbuf, 1, rank, dat->get_num_elements()*elements);
@@ -152,7 +152,7 @@ int main (int argc, char *argv[])
     }
     else {
 #ifdef HIP_MPITEST_UNPACK
-        res = dat->check_recvbuf(recvbuf->get_buffer(), size, rank+1, elements);
+        res = dat->check_recvbuf(recvbuf->get_buffer(), rank, elements);
 #else
         res = check_contg_recvbuf(recvbuf->get_buffer(), 1, rank, dat->get_num_elements()*elements);
 #endif
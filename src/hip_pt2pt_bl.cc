@@ -29,26 +29,26 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements = 1024;
+long elements = 1024;
 hip_mpitest_buffer *sendbuf = NULL;
 hip_mpitest_buffer *recvbuf = NULL;
 
-static void init_sendbuf(int *sendbuf, int count, int mynode)
+static void init_sendbuf(int *sendbuf, long count, int mynode)
 {
     // Rank 0 sends "1" and Rank 1 sends "2"
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = mynode + 1;
     }
 }
 
-static void init_recvbuf(int *recvbuf, int count)
+static void init_recvbuf(int *recvbuf, long count)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0;
     }
 }
 
-static bool check_recvbuf(int *recvbuf, int nProcs, int rank, int count)
+static bool check_recvbuf(int *recvbuf, int nProcs, int rank, long count)
 {
     bool res = true;
     int result = 0;
@@ -60,11 +60,11 @@ static bool check_recvbuf(int *recvbuf, int nProcs, int rank, int count)
         result = 1;
     }
 
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         if (recvbuf[i] != result) {
             res = false;
 #ifdef VERBOSE
-            printf("recvbuf[%d] = %d expected %d\n", i, recvbuf[i], result);
+            printf("recvbuf[%ld] = %d expected %d\n", i, recvbuf[i], result);
 #endif
             break;
         }
@@ -72,9 +72,9 @@ static bool check_recvbuf(int *recvbuf, int nProcs, int rank, int count)
     return res;
 }
 
-int type_p2p_bl_test(int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
-int type_p2p_bsend_test(int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
-int type_p2p_ssend_test(int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
+int type_p2p_bl_test(int *sendbuf, int *recvbuf, long count, MPI_Comm comm);
+int type_p2p_bsend_test(int *sendbuf, int *recvbuf, long count, MPI_Comm comm);
+int type_p2p_ssend_test(int *sendbuf, int *recvbuf, long count, MPI_Comm comm);
 
 int main(int argc, char *argv[])
 {
@@ -93,6 +93,11 @@ int main(int argc, char *argv[])
         MPI_Abort(MPI_COMM_WORLD, 1);
         return 1;
     }
+#if defined HIP_MPITEST_BSEND && !defined HIP_MPITEST_HAVE_MPI_COUNT
+    hip_mpitest_max_elements = (INT_MAX - MPI_BSEND_OVERHEAD) / sizeof(int);
+#else
+    hip_mpitest_max_elements = LONG_MAX;
+#endif
     parse_args(argc, argv, MPI_COMM_WORLD);
 
     int *tmp_sendbuf = NULL, *tmp_recvbuf = NULL;
@@ -156,7 +161,7 @@ out:
     return fret ? 0 : 1;
 }
 
-int type_p2p_bl_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
+int type_p2p_bl_test(int *sbuf, int *rbuf, long count, MPI_Comm comm)
 {
     int size, rank, ret;
     int tag = 251;
@@ -166,21 +171,21 @@ int type_p2p_bl_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
     MPI_Comm_rank(comm, &rank);
 
     if (rank == 0) {
-        ret = MPI_Send(sbuf, count, MPI_INT, 1, tag, comm);
+        ret = hip_mpitest_send(sbuf, count, MPI_INT, 1, tag, comm);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
-        ret = MPI_Recv(rbuf, count, MPI_INT, 1, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 1, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
     }
     if (rank == 1) {
-        ret = MPI_Recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
-        ret = MPI_Send(sbuf, count, MPI_INT, 0, tag, comm);
+        ret = hip_mpitest_send(sbuf, count, MPI_INT, 0, tag, comm);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
@@ -189,46 +194,48 @@ int type_p2p_bl_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
     return MPI_SUCCESS;
 }
 
-int type_p2p_bsend_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
+int type_p2p_bsend_test(int *sbuf, int *rbuf, long count, MPI_Comm comm)
 {
     int size, rank, ret = MPI_SUCCESS;
     int tag = 251;
     MPI_Status status;
     int *buffer;
-    int msg_size, buffersize;
+    long buffersize;
 
     MPI_Comm_size(comm, &size);
     MPI_Comm_rank(comm, &rank);
 
-    MPI_Pack_size(count, MPI_INT, comm, &msg_size);
-    buffersize = MPI_BSEND_OVERHEAD + msg_size;
+    ret = hip_mpitest_bsend_size(count, MPI_INT, comm, &buffersize);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
     buffer = (int *) malloc(buffersize);
     if (NULL == buffer) {
         return MPI_ERR_OTHER;
     }
 
-    ret = MPI_Buffer_attach(buffer, buffersize);
+    ret = hip_mpitest_buffer_attach(buffer, buffersize);
     if (MPI_SUCCESS != ret) {
         free (buffer);
         return ret;
     }
 
     if (rank == 0) {
-        ret = MPI_Bsend(sbuf, count, MPI_INT, 1, tag, comm);
+        ret = hip_mpitest_bsend(sbuf, count, MPI_INT, 1, tag, comm);
         if (MPI_SUCCESS != ret) {
             goto out;
         }
-        ret = MPI_Recv(rbuf, count, MPI_INT, 1, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 1, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             goto out;
         }
     }
     if (rank == 1) {
-        ret = MPI_Recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             goto out;
         }
-        ret = MPI_Bsend(sbuf, count, MPI_INT, 0, tag, comm);
+        ret = hip_mpitest_bsend(sbuf, count, MPI_INT, 0, tag, comm);
         if (MPI_SUCCESS != ret) {
             goto out;
         }
@@ -236,14 +243,14 @@ int type_p2p_bsend_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
 
  out:
     if (NULL != buffer) {
-        MPI_Buffer_detach(&buffer, &buffersize);
+        hip_mpitest_buffer_detach();
         free (buffer);
     }
 
     return ret;
 }
 
-int type_p2p_ssend_test(int *sbuf, int *rbuf, int count, MPI_Comm comm) {
+int type_p2p_ssend_test(int *sbuf, int *rbuf, long count, MPI_Comm comm) {
     int size, rank, ret;
     int tag = 251;
 
@@ -253,20 +260,20 @@ int type_p2p_ssend_test(int *sbuf, int *rbuf, int count, MPI_Comm comm) {
     MPI_Comm_size(comm, &size);
 
     if (rank == 0) {
-        ret = MPI_Ssend(sbuf, count, MPI_INT, 1, tag, comm);
+        ret = hip_mpitest_ssend(sbuf, count, MPI_INT, 1, tag, comm);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
-        ret = MPI_Recv(rbuf, count, MPI_INT, 1, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 1, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
     } else if (rank == 1) {
-        ret = MPI_Recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
-        ret = MPI_Ssend(sbuf, count, MPI_INT, 0, tag, comm);
+        ret = hip_mpitest_ssend(sbuf, count, MPI_INT, 0, tag, comm);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
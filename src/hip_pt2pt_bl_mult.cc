@@ -29,33 +29,33 @@
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
 
-int elements = 1024;
+long elements = 1024;
 hip_mpitest_buffer *sendbuf = NULL;
 hip_mpitest_buffer *recvbuf = NULL;
 
-static void init_sendbuf(int *sendbuf, int count, int val)
+static void init_sendbuf(int *sendbuf, long count, int val)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = val;
     }
 }
 
-static void init_recvbuf(int *recvbuf, int count)
+static void init_recvbuf(int *recvbuf, long count)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0;
     }
 }
 
-static bool check_recvbuf(int *recvbuf, int result, int count)
+static bool check_recvbuf(int *recvbuf, int result, long count)
 {
     bool res = true;
 
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         if (recvbuf[i] != result) {
             res = false;
 #ifdef VERBOSE
-            printf("recvbuf[%d] = %d expected %d\n", i, recvbuf[i], result);
+            printf("recvbuf[%ld] = %d expected %d\n", i, recvbuf[i], result);
 #endif
             break;
         }
@@ -63,7 +63,7 @@ static bool check_recvbuf(int *recvbuf, int result, int count)
     return res;
 }
 
-int type_p2p_bl_mult_test(int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
+int type_p2p_bl_mult_test(int *sendbuf, int *recvbuf, long count, MPI_Comm comm);
 
 /* High level idea of this test is to stress sycnhronization between of buffers
 ** between Sender and Receiver.
@@ -91,6 +91,7 @@ int main(int argc, char *argv[])
         MPI_Abort(MPI_COMM_WORLD, 1);
         return 1;
     }
+    hip_mpitest_max_elements = LONG_MAX;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
     int *tmp_sendbuf = NULL, *tmp_recvbuf = NULL;
@@ -170,7 +171,7 @@ int main(int argc, char *argv[])
     return fret ? 0 : 1;
 }
 
-int type_p2p_bl_mult_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
+int type_p2p_bl_mult_test(int *sbuf, int *rbuf, long count, MPI_Comm comm)
 {
     int size, rank, ret;
     int tag = 251;
@@ -180,13 +181,13 @@ int type_p2p_bl_mult_test(int *sbuf, int *rbuf, int count, MPI_Comm comm)
     MPI_Comm_rank(comm, &rank);
 
     if (rank == 0) {
-        ret = MPI_Ssend(sbuf, count, MPI_INT, 1, tag, comm);
+        ret = hip_mpitest_ssend(sbuf, count, MPI_INT, 1, tag, comm);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
     }
     if (rank == 1) {
-        ret = MPI_Recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
+        ret = hip_mpitest_recv(rbuf, count, MPI_INT, 0, tag, comm, &status);
         if (MPI_SUCCESS != ret) {
             return ret;
         }
@@ -0,0 +1,171 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Stress test of the message matching. Every process floods process 0
+** with --queue-depth messages spread across --tags tags, which are all
+** posted before process 0 starts receiving and hence mostly end up in
+** its unexpected message queue. Process 0 drains them with specific,
+** wildcard and matched probe receives in turn. The data of every message
+** is verified against its envelope and the order of the messages of
+** each sender and tag.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_typed_buffer.h"
+#include "hip_mpitest_matching.h"
+
+long elements=1;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+int main (int argc, char *argv[])
+{
+    int rank, nProcs;
+    int root = 0;
+    int ret = MPI_SUCCESS;
+    int depth, ntags, nmsgs;
+    bool res=true, fret;
+    hip_mpitest_typed_buffer<int> sbuf, rbuf;
+    MPI_Request *reqs=NULL;
+    int *sources=NULL, *tags=NULL, *expected=NULL;
+
+    bind_device();
+
+    MPI_Init      (&argc, &argv);
+    MPI_Comm_size (MPI_COMM_WORLD, &nProcs);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    depth = hip_mpitest_queue_depth;
+    ntags = hip_mpitest_tags;
+    nmsgs = (nProcs - 1) * depth;
+
+    reqs     = (MPI_Request *) malloc (depth * sizeof(MPI_Request));
+    // one more element, such that there is no malloc(0) with one process
+    sources  = (int *) malloc ((nmsgs + 1) * sizeof(int));
+    tags     = (int *) malloc ((nmsgs + 1) * sizeof(int));
+    expected = (int *) malloc ((nmsgs + 1) * sizeof(int));
+    if (NULL == reqs || NULL == sources || NULL == tags || NULL == expected) {
+        printf("Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+
+    // Only process 0 receives, all others only send
+    if (rank == root && nmsgs > 0) {
+        if (rbuf.Allocate(recvbuf, (long)nmsgs * elements) != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+    }
+    else if (rank != root) {
+        if (sbuf.Allocate(sendbuf, (long)depth * elements) != hipSuccess ||
+            sbuf.Generate([rank, depth, ntags](int *buf, long first, long n) {
+                              hip_mpitest_match_init_sendbuf(buf, first, n, rank, elements,
+                                                             depth, ntags); })
+            != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+    }
+    report_buffertype(MPI_COMM_WORLD, "Sendbuf", sendbuf);
+    report_buffertype(MPI_COMM_WORLD, "Recvbuf", recvbuf);
+
+    for (int mode=0; mode<HIP_MPITEST_MATCH_LAST; mode++) {
+        if (rank == root && nmsgs > 0 &&
+            rbuf.Generate(hip_mpitest_match_init_recvbuf) != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        if (rank != root) {
+            ret = hip_mpitest_match_flood (sbuf.get_buffer(), elements, root, depth, ntags,
+                                           MPI_COMM_WORLD, reqs);
+            if (MPI_SUCCESS != ret) {
+                printf("Error in hip_mpitest_match_flood. Aborting\n");
+                goto out;
+            }
+        }
+        // all messages are sent before the receiver starts matching
+        MPI_Barrier (MPI_COMM_WORLD);
+        if (rank == root && nmsgs > 0) {
+            bool mres;
+
+            ret = hip_mpitest_match_drain (mode, rbuf.get_buffer(), elements, root, depth, ntags,
+                                           MPI_COMM_WORLD, sources, tags);
+            if (MPI_SUCCESS != ret) {
+                printf("Error in hip_mpitest_match_drain. Aborting\n");
+                goto out;
+            }
+            hip_mpitest_match_expected (nmsgs, sources, tags, nProcs, depth, ntags, expected);
+            mres = rbuf.Verify([expected](const int *buf, long first, long n) {
+                                   return hip_mpitest_match_check_recvbuf(buf, first, n, elements,
+                                                                          expected); });
+            if (!mres) {
+                printf("Verification of the messages drained in %s mode failed\n",
+                       hip_mpitest_match_names[mode]);
+            }
+            res &= mres;
+        }
+        else if (rank != root) {
+            ret = MPI_Waitall (depth, reqs, MPI_STATUSES_IGNORE);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+        }
+    }
+
+    fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
+    report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), elements,
+                        (size_t)(elements *sizeof(int)), 0, 0.0);
+    if (rank == root) {
+        printf("   %d messages per sender across %d tags\n", depth, ntags);
+    }
+
+ out:
+    //Cleanup dynamic buffers
+    sbuf.Free();
+    rbuf.Free();
+    free (reqs);
+    free (sources);
+    free (tags);
+    free (expected);
+
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
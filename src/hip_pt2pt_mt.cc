@@ -0,0 +1,227 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** Nonblocking exchanges of --threads threads per process executed
+** concurrently under MPI_THREAD_MULTIPLE. Thread t of a process
+** communicates with thread t of its peer, the traffic of the threads
+** being separated by a tag per thread or, for hip_pt2pt_mt_comm and with
+** --thread-comm, by a duplicate of the communicator per thread. Every
+** thread uses its own buffers of the selected memory types.
+*/
+
+#include <stdio.h>
+#include "mpi.h"
+
+#include <hip/hip_runtime.h>
+
+#include "hip_mpitest_utils.h"
+#include "hip_mpitest_buffer.h"
+#include "hip_mpitest_typed_buffer.h"
+#include "hip_mpitest_mt.h"
+
+#define NITER  10
+#define WINDOW 4
+long elements=1024;
+hip_mpitest_buffer *sendbuf=NULL;
+hip_mpitest_buffer *recvbuf=NULL;
+
+// Message w of thread t of process rank
+static int mt_value (int rank, int nthreads, int t, long w)
+{
+    return (int)(((long)rank * nthreads + t) * WINDOW + w) + 1;
+}
+
+static void init_sendbuf (int *sendbuf, long first, long n, int rank, int nthreads, int t,
+                          long count)
+{
+    for (long i = 0; i < n; i++) {
+        sendbuf[i] = mt_value(rank, nthreads, t, (first + i) / count);
+    }
+}
+
+static void init_recvbuf (int *recvbuf, long first, long n)
+{
+    for (long i = 0; i < n; i++) {
+        recvbuf[i] = -1;
+    }
+}
+
+static bool check_recvbuf (const int *recvbuf, long first, long n, int peer, int nthreads,
+                           int t, long count)
+{
+    for (long i = 0; i < n; i++) {
+        int expected = (MPI_PROC_NULL == peer) ? -1 : mt_value(peer, nthreads, t, (first + i) / count);
+        if (recvbuf[i] != expected) {
+#ifdef VERBOSE
+            printf("thread %d recvbuf[%ld] = %d expected %d\n", t, first + i, recvbuf[i], expected);
+#endif
+            return false;
+        }
+    }
+    return true;
+}
+
+int main (int argc, char *argv[])
+{
+    int rank, nProcs, peer;
+    int ret = MPI_SUCCESS;
+    int nthreads, mode;
+    bool res=true, fret=false;
+    hip_mpitest_buffer **smem=NULL, **rmem=NULL;
+    hip_mpitest_typed_buffer<int> *sbuf=NULL, *rbuf=NULL;
+    hip_mpitest_mt_ctx *ctx=NULL;
+    MPI_Comm *comms=NULL;
+
+    bind_device();
+
+    if (!hip_mpitest_mt_init (&argc, &argv)) {
+        MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+        if (0 == rank) {
+            printf("%-32s \t [FAILED] MPI_THREAD_MULTIPLE is not supported\n", argv[0]);
+        }
+        MPI_Finalize ();
+        return 1;
+    }
+    MPI_Comm_size (MPI_COMM_WORLD, &nProcs);
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+
+    parse_args(argc, argv, MPI_COMM_WORLD);
+
+    nthreads = hip_mpitest_threads;
+    mode     = hip_mpitest_thread_comm ? HIP_MPITEST_MT_COMM : HIP_MPITEST_MT_TAG;
+#ifdef HIP_MPITEST_THREAD_COMM
+    mode     = HIP_MPITEST_MT_COMM;
+#endif
+
+    // Processes are paired as 0-1, 2-3, ..., the last one idles for odd sizes
+    peer = rank ^ 1;
+    if (peer >= nProcs) {
+        peer = MPI_PROC_NULL;
+    }
+
+    smem  = (hip_mpitest_buffer **) calloc (nthreads, sizeof(hip_mpitest_buffer *));
+    rmem  = (hip_mpitest_buffer **) calloc (nthreads, sizeof(hip_mpitest_buffer *));
+    ctx   = (hip_mpitest_mt_ctx *) calloc (nthreads, sizeof(hip_mpitest_mt_ctx));
+    comms = (MPI_Comm *) malloc (nthreads * sizeof(MPI_Comm));
+    sbuf  = new hip_mpitest_typed_buffer<int>[nthreads];
+    rbuf  = new hip_mpitest_typed_buffer<int>[nthreads];
+    if (NULL == smem || NULL == rmem || NULL == ctx || NULL == comms) {
+        printf("Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    for (int t=0; t<nthreads; t++) {
+        comms[t] = MPI_COMM_NULL;
+    }
+
+    // Thread 0 uses the buffers created by parse_args, the others ones of
+    // the same memory types and placement. All buffers are set up before
+    // the threads are started.
+    smem[0] = sendbuf;
+    rmem[0] = recvbuf;
+    for (int t=0; t<nthreads; t++) {
+        if (t > 0) {
+            char stype[2] = {sendbuf->get_memchar(), '\0'};
+            char rtype[2] = {recvbuf->get_memchar(), '\0'};
+            SET_MEMBUF_TYPE(stype, smem[t], argc, argv, MPI_COMM_WORLD);
+            SET_MEMBUF_TYPE(rtype, rmem[t], argc, argv, MPI_COMM_WORLD);
+            smem[t]->set_offset(sendbuf->get_offset(), sendbuf->get_align());
+            rmem[t]->set_offset(recvbuf->get_offset(), recvbuf->get_align());
+        }
+        if (sbuf[t].Allocate(smem[t], (long)elements * WINDOW) != hipSuccess ||
+            sbuf[t].Generate([rank, nthreads, t](int *buf, long first, long n) {
+                                 init_sendbuf(buf, first, n, rank, nthreads, t, elements); })
+            != hipSuccess ||
+            rbuf[t].Allocate(rmem[t], (long)elements * WINDOW) != hipSuccess ||
+            rbuf[t].Generate(init_recvbuf) != hipSuccess) {
+            ret = MPI_ERR_OTHER;
+            goto out;
+        }
+        if (HIP_MPITEST_MT_COMM == mode) {
+            ret = MPI_Comm_dup (MPI_COMM_WORLD, &comms[t]);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+        }
+        hip_mpitest_mt_setup (&ctx[t], t, mode, MPI_COMM_WORLD, comms, 251);
+        ctx[t].peer     = peer;
+        ctx[t].sbuf     = sbuf[t].get_buffer();
+        ctx[t].rbuf     = rbuf[t].get_buffer();
+        ctx[t].datatype = MPI_INT;
+        ctx[t].count    = elements;
+        ctx[t].window   = WINDOW;
+        ctx[t].niter    = NITER;
+    }
+
+    //execute point-to-point operations from all threads
+    ret = hip_mpitest_mt_run (ctx, nthreads);
+    if (MPI_SUCCESS != ret) {
+        printf("Error in hip_mpitest_mt_run. Aborting\n");
+        goto out;
+    }
+
+    // verify results
+    for (int t=0; t<nthreads; t++) {
+        res &= rbuf[t].Verify([peer, nthreads, t](const int *buf, long first, long n) {
+                                  return check_recvbuf(buf, first, n, peer, nthreads, t, elements); });
+    }
+    fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
+    report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), elements,
+                        (size_t)(elements *sizeof(int)), 0, 0.0);
+    if (0 == rank) {
+        printf("   %d threads, traffic separated by %s\n", nthreads, hip_mpitest_mt_names[mode]);
+    }
+
+ out:
+    //Cleanup dynamic buffers
+    if (NULL != smem && NULL != rmem && NULL != comms) {
+        for (int t=0; t<nthreads; t++) {
+            sbuf[t].Free();
+            rbuf[t].Free();
+            if (t > 0) {
+                delete (smem[t]);
+                delete (rmem[t]);
+            }
+            if (MPI_COMM_NULL != comms[t]) {
+                MPI_Comm_free (&comms[t]);
+            }
+        }
+    }
+    delete [] sbuf;
+    delete [] rbuf;
+    free (smem);
+    free (rmem);
+    free (ctx);
+    free (comms);
+    delete (sendbuf);
+    delete (recvbuf);
+
+    if (MPI_SUCCESS != ret) {
+        MPI_Abort (MPI_COMM_WORLD, 1);
+        return 1;
+    }
+
+    MPI_Finalize ();
+    return fret ? 0 : 1;
+}
@@ -28,57 +28,71 @@
 
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_layout.h"
+#include <chrono>
 
-int elements=1024;
+#define NITER 25
+long elements=1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (int *sendbuf, int count, int mynode)
+static void init_sendbuf (int *sendbuf, long first, long count, int mynode)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         sendbuf[i] = mynode + 1;
     }
 }
 
-static void init_recvbuf (int *recvbuf, int count )
+static void init_recvbuf (int *recvbuf, long first, long count)
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0;
     }
 }
 
-static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
+// Checks elements [first, first+n) of the receive buffer, which holds
+// count elements from every process. Slices of processes recvd[] does
+// not mark have not been received into.
+static bool check_recvbuf (const int *recvbuf, long first, long n, long count, const char *recvd)
 {
     bool res=true;
-    int  l=0;
 
-    for (int recvrank=0; recvrank < nProcs; recvrank++) {
-        if (recvrank == rank) {
-            l += count;
-            continue; //No send-to-self for right now
-        }
-        for (int i=0; i < count; i++, l++) {
-            if (recvbuf[l] != recvrank + 1) {
-                res = false;
+    for (long l=0; l<n; l++) {
+        int recvrank = (int)((first + l) / count);
+        int expected = recvd[recvrank] ? recvrank + 1 : 0;
+        if (recvbuf[l] != expected) {
+            res = false;
 #ifdef VERBOSE
-                printf("recvbuf[%d] = %d expected %d\n", i, recvbuf[l], recvrank+1);
+            printf("recvbuf[%ld] = %d expected %d\n", first + l, recvbuf[l], expected);
 #endif
-                break;
-            }
+            break;
         }
     }
     return res;
 }
 
-int type_p2p_nb_test (int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
-int type_p2p_nb_mpi_testall_test (int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
-int type_p2p_persistent_test (int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
+int type_p2p_nb_test (hip_mpitest_peer_buffer<int> &sendbuf, hip_mpitest_peer_buffer<int> &recvbuf,
+                      long count, hip_mpitest_schedule &sched, MPI_Comm comm);
+int type_p2p_nb_window_test (hip_mpitest_peer_buffer<int> &sendbuf,
+                             hip_mpitest_peer_buffer<int> &recvbuf, long count,
+                             hip_mpitest_schedule &sched, MPI_Comm comm);
+int type_p2p_persistent_init (hip_mpitest_peer_buffer<int> &sendbuf,
+                              hip_mpitest_peer_buffer<int> &recvbuf, long count,
+                              MPI_Comm comm, MPI_Request *reqs);
+void type_p2p_persistent_free (MPI_Request *reqs, int size);
+int type_p2p_persistent_test (MPI_Request *reqs, hip_mpitest_schedule &sched, MPI_Comm comm);
 
 int main (int argc, char *argv[])
 {
     int rank, nProcs;
     int root = 0;
-    int ret;
+    int ret = MPI_SUCCESS;
+    hip_mpitest_peer_buffer<int> sbuf, rbuf;
+    hip_mpitest_schedule sched;
+    char *recvd=NULL;
+    MPI_Request *preqs=NULL;
+    std::chrono::high_resolution_clock::time_point t1s, t1e;
+    double tfirst, tavg=0.0;
 
     bind_device();
 
@@ -86,51 +100,119 @@ int main (int argc, char *argv[])
     MPI_Comm_size (MPI_COMM_WORLD, &nProcs);
     MPI_Comm_rank (MPI_COMM_WORLD, &rank);
 
+    hip_mpitest_max_elements = LONG_MAX;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
-    int *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
+#if defined HIP_MPITEST_PERSISTENT_P2P
+    ret = sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL, true);
+#else
+    ret = sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL);
+#endif
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+    // processes received from in any iteration
+    recvd = (char *) calloc (nProcs, sizeof(char));
+    if (NULL == recvd) {
+        printf("Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+
     // Initialise send buffer
-    ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, int, nProcs*elements, sizeof(int),
-                        rank, MPI_COMM_WORLD, init_sendbuf, out);
+    if (sbuf.Allocate(sendbuf, nProcs, elements, hip_mpitest_layout) != hipSuccess ||
+        sbuf.Generate([rank](int *buf, long first, long n) {
+                          init_sendbuf(buf, first, n, rank); }) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    report_buffertype(MPI_COMM_WORLD, "Sendbuf", sendbuf);
 
     // Initialize recv buffer
-    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, int, nProcs*elements, sizeof(int),
-                        rank, MPI_COMM_WORLD, init_recvbuf, out);
+    if (rbuf.Allocate(recvbuf, nProcs, elements, hip_mpitest_layout) != hipSuccess ||
+        rbuf.Generate(init_recvbuf) != hipSuccess) {
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    report_buffertype(MPI_COMM_WORLD, "Recvbuf", recvbuf);
 
-    //execute point-to-point operations
 #if defined HIP_MPITEST_PERSISTENT_P2P
-    ret = type_p2p_persistent_test ((int *)sendbuf->get_buffer(), (int *)recvbuf->get_buffer(),
-                                    elements, MPI_COMM_WORLD);
-    if (MPI_SUCCESS != ret) {
-        printf("Error in type_p2p_persistent_test. Aborting\n");
+    preqs = (MPI_Request *) malloc (2*nProcs*sizeof(MPI_Request));
+    if (NULL == preqs) {
+        printf("Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
         goto out;
     }
-#else
-    ret = type_p2p_nb_test ((int *)sendbuf->get_buffer(), (int *)recvbuf->get_buffer(),
-                            elements, MPI_COMM_WORLD);
+    ret = type_p2p_persistent_init (sbuf, rbuf, elements, MPI_COMM_WORLD, preqs);
     if (MPI_SUCCESS != ret) {
-        printf("Error in type_p2p_nb_test. Aborting\n");
+        printf("Error in type_p2p_persistent_init. Aborting\n");
         goto out;
     }
 #endif
 
+    //execute point-to-point operations. The first exchange includes
+    //registering the buffers, subsequent ones are only timed for the
+    //comparison of buffer layouts.
+    for (int iter=0; iter<(hip_mpitest_layout_report ? NITER+1 : 1); iter++) {
+        if (iter == 1) {
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+        sched.Generate(iter);
+        for (int i=0; i<nProcs; i++) {
+            recvd[i] |= sched.RecvsFrom(i);
+        }
+        t1s = std::chrono::high_resolution_clock::now();
+        hip_mpitest_pagefaults_begin();
+#if defined HIP_MPITEST_PERSISTENT_P2P
+        ret = type_p2p_persistent_test (preqs, sched, MPI_COMM_WORLD);
+        if (MPI_SUCCESS != ret) {
+            printf("Error in type_p2p_persistent_test. Aborting\n");
+            goto out;
+        }
+#else
+        if (hip_mpitest_window_depth > 0) {
+            ret = type_p2p_nb_window_test (sbuf, rbuf, elements, sched, MPI_COMM_WORLD);
+            if (MPI_SUCCESS != ret) {
+                printf("Error in type_p2p_nb_window_test. Aborting\n");
+                goto out;
+            }
+        }
+        else {
+            ret = type_p2p_nb_test (sbuf, rbuf, elements, sched, MPI_COMM_WORLD);
+            if (MPI_SUCCESS != ret) {
+                printf("Error in type_p2p_nb_test. Aborting\n");
+                goto out;
+            }
+        }
+#endif
+        hip_mpitest_pagefaults_end();
+        t1e = std::chrono::high_resolution_clock::now();
+        if (iter == 0) {
+            tfirst = std::chrono::duration<double>(t1e-t1s).count();
+        }
+        else {
+            tavg += std::chrono::duration<double>(t1e-t1s).count() / NITER;
+        }
+    }
+
     // verify results
     bool res, fret;
-    if (recvbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, nProcs*elements*sizeof(int)));
-        res = check_recvbuf(tmp_recvbuf, nProcs, rank, elements);
-    }
-    else {
-        res = check_recvbuf((int*) recvbuf->get_buffer(), nProcs, rank, elements);
-    }
+    res = rbuf.Verify([recvd](const int *buf, long first, long n) {
+                          return check_recvbuf(buf, first, n, elements, recvd); });
     fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
     report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), elements,
                         (size_t)(elements *sizeof(int)), 0, 0.0);
+    hip_mpitest_layout_report_time (MPI_COMM_WORLD, nProcs, tfirst, tavg);
 
  out:
+    if (NULL != preqs) {
+        type_p2p_persistent_free (preqs, nProcs);
+        free (preqs);
+    }
     //Cleanup dynamic buffers
-    FREE_BUFFER(sendbuf, tmp_sendbuf);
-    FREE_BUFFER(recvbuf, tmp_recvbuf);
+    HIP_CHECK(sbuf.Free());
+    HIP_CHECK(rbuf.Free());
+    free (recvd);
 
     delete (sendbuf);
     delete (recvbuf);
@@ -145,7 +227,8 @@ int main (int argc, char *argv[])
 }
 
 
-int type_p2p_nb_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
+int type_p2p_nb_test (hip_mpitest_peer_buffer<int> &sbuf, hip_mpitest_peer_buffer<int> &rbuf,
+                      long count, hip_mpitest_schedule &sched, MPI_Comm comm)
 {
     int size, rank, ret, completion_flag = 0;
     int tag=251;
@@ -163,21 +246,22 @@ int type_p2p_nb_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
     }
 
     for (int i=0; i<size; i++) {
-        if (i == rank) {
-            // No send-to-self for the moment
-            reqs[2*i]   = MPI_REQUEST_NULL;
-            reqs[2*i+1] = MPI_REQUEST_NULL;
-            continue;
-        }
-        recvbuf = &rbuf[i*count];
-        ret = MPI_Irecv (recvbuf, count, MPI_INT, i, tag, comm, &reqs[2*i]);
-        if (MPI_SUCCESS != ret) {
-            goto out;
+        // Peers not in the schedule of this iteration keep a null request
+        reqs[2*i]   = MPI_REQUEST_NULL;
+        reqs[2*i+1] = MPI_REQUEST_NULL;
+        if (sched.RecvsFrom(i)) {
+            recvbuf = rbuf.get_slice(i);
+            ret = hip_mpitest_irecv (recvbuf, count, MPI_INT, i, tag, comm, &reqs[2*i]);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
         }
-        sendbuf = &sbuf[i*count];
-        ret = MPI_Isend (sendbuf, count, MPI_INT, i, tag, comm, &reqs[2*i+1]);
-        if (MPI_SUCCESS != ret) {
-            goto out;
+        if (sched.SendsTo(i)) {
+            sendbuf = sbuf.get_slice(i);
+            ret = hip_mpitest_isend (sendbuf, count, MPI_INT, i, tag, comm, &reqs[2*i+1]);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
         }
     }
 #if defined HIP_MPITEST_MPI_TESTALL_P2P
@@ -200,46 +284,105 @@ int type_p2p_nb_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
     return ret;
 }
 
-int type_p2p_persistent_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
+// Same exchange as type_p2p_nb_test with at most hip_mpitest_window_depth
+// requests outstanding instead of 2*size
+int type_p2p_nb_window_test (hip_mpitest_peer_buffer<int> &sbuf,
+                             hip_mpitest_peer_buffer<int> &rbuf, long count,
+                             hip_mpitest_schedule &sched, MPI_Comm comm)
 {
     int size, rank, ret;
     int tag=251;
-    MPI_Request *reqs;
-    int *sendbuf;
-    int *recvbuf;
+    hip_mpitest_window window;
 
     MPI_Comm_size (comm, &size);
     MPI_Comm_rank (comm, &rank);
 
+#if defined HIP_MPITEST_MPI_TESTALL_P2P
+    ret = window.Init (hip_mpitest_window_depth, true);
+#else
+    ret = window.Init (hip_mpitest_window_depth);
+#endif
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    return window.Run (2*(long)size, [&](long op, MPI_Request *req) {
+        bool is_send;
+        int peer = hip_mpitest_window_peer (rank, size, op, &is_send);
+        if (is_send) {
+            if (!sched.SendsTo(peer)) {
+                return MPI_SUCCESS;
+            }
+            return hip_mpitest_isend (sbuf.get_slice(peer), count, MPI_INT, peer, tag, comm, req);
+        }
+        if (!sched.RecvsFrom(peer)) {
+            return MPI_SUCCESS;
+        }
+        return hip_mpitest_irecv (rbuf.get_slice(peer), count, MPI_INT, peer, tag, comm, req);
+    });
+}
+
+// Creates the persistent requests for all peers once, such that the
+// timed iterations only start and complete them. reqs[2*i] receives from
+// and reqs[2*i+1] sends to process i.
+int type_p2p_persistent_init (hip_mpitest_peer_buffer<int> &sbuf,
+                              hip_mpitest_peer_buffer<int> &rbuf, long count,
+                              MPI_Comm comm, MPI_Request *reqs)
+{
+    int size, ret=MPI_SUCCESS;
+    int tag=251;
+
+    MPI_Comm_size (comm, &size);
+    for (int i=0; i<2*size; i++) {
+        reqs[i] = MPI_REQUEST_NULL;
+    }
+    for (int i=0; i<size && MPI_SUCCESS == ret; i++) {
+        ret = hip_mpitest_recv_init (rbuf.get_slice(i), count, MPI_INT, i, tag, comm, &reqs[2*i]);
+        if (MPI_SUCCESS == ret) {
+            ret = hip_mpitest_send_init (sbuf.get_slice(i), count, MPI_INT, i, tag, comm,
+                                         &reqs[2*i+1]);
+        }
+    }
+    return ret;
+}
+
+void type_p2p_persistent_free (MPI_Request *reqs, int size)
+{
+    for (int i=0; i<2*size; i++) {
+        if (MPI_REQUEST_NULL != reqs[i]) {
+            MPI_Request_free (&reqs[i]);
+        }
+    }
+}
+
+int type_p2p_persistent_test (MPI_Request *preqs, hip_mpitest_schedule &sched, MPI_Comm comm)
+{
+    int size, ret, nreqs=0;
+    MPI_Request *reqs;
+
+    MPI_Comm_size (comm, &size);
+
     reqs = (MPI_Request*)malloc (2*size*sizeof(MPI_Request));
     if (NULL == reqs) {
         printf("4. Could not allocate memory. Aborting\n");
         return MPI_ERR_OTHER;
     }
 
+    // Requests of the peers of this iteration are compacted to the front
     for (int i=0; i<size; i++) {
-        recvbuf = &rbuf[i*count];
-        ret = MPI_Recv_init (recvbuf, count, MPI_INT, i, tag, comm, &reqs[2*i]);
-        if (MPI_SUCCESS != ret) {
-            goto out;
+        if (sched.RecvsFrom(i)) {
+            reqs[nreqs++] = preqs[2*i];
         }
-        sendbuf = &sbuf[i*count];
-        ret = MPI_Send_init (sendbuf, count, MPI_INT, i, tag, comm, &reqs[2*i+1]);
-        if (MPI_SUCCESS != ret) {
-            goto out;
+        if (sched.SendsTo(i)) {
+            reqs[nreqs++] = preqs[2*i+1];
         }
     }
-    ret = MPI_Startall (2*size, reqs);
-    if (MPI_SUCCESS != ret) {
-        goto out;
-    }
-    ret = MPI_Waitall (2*size, reqs, MPI_STATUSES_IGNORE);
+    ret = MPI_Startall (nreqs, reqs);
     if (MPI_SUCCESS != ret) {
         goto out;
     }
+    ret = MPI_Waitall (nreqs, reqs, MPI_STATUSES_IGNORE);
 
  out:
     free (reqs);
     return ret;
 }
-
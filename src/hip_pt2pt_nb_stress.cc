@@ -25,64 +25,118 @@
 #include "mpi.h"
 
 #include <hip/hip_runtime.h>
+#include <chrono>
 
 #include "hip_mpitest_utils.h"
 #include "hip_mpitest_buffer.h"
+#include "hip_mpitest_pipeline.h"
+#include "hip_mpitest_pattern.h"
 #define NUM_NB_ITERATIONS 98
-int elements=1024;
+long elements=1024;
 hip_mpitest_buffer *sendbuf=NULL;
 hip_mpitest_buffer *recvbuf=NULL;
 
-static void init_sendbuf (int *sendbuf, int count, int mynode)
+// Number of iterations whose buffers are allocated at once. Either all
+// iterations, or the depth of the ring in streaming mode.
+static int num_slots=NUM_NB_ITERATIONS;
+static int test_nprocs;
+static int test_rank;
+// Schedule used by the helper thread of the streaming mode
+static hip_mpitest_schedule *check_sched;
+
+// Aggregate throughput of all processes, nmsgs and nbytes being the
+// messages and bytes sent by the calling process in time seconds
+static void report_throughput (MPI_Comm comm, long nmsgs, long nbytes, double time)
+{
+    int rank;
+    long sum[2], lsum[2]={nmsgs, nbytes};
+    double tmax=0.0;
+
+    MPI_Comm_rank (comm, &rank);
+    MPI_Reduce(lsum, sum, 2, MPI_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(&time, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (rank == 0) {
+        printf("   Throughput %.1lf MB/s, %ld messages of %.1lf bytes on average in %lf s\n",
+               tmax > 0.0 ? sum[1] / tmax / (1024*1024) : 0.0, sum[0],
+               sum[0] > 0 ? (double)sum[1] / sum[0] : 0.0, tmax);
+    }
+}
+
+static void init_sendbuf (int *sendbuf, long count, int mynode)
 {
-    int  l=0;
-    count = count / NUM_NB_ITERATIONS;
-    int nProcs = count / elements;
-    for (int iteration=0; iteration < NUM_NB_ITERATIONS; iteration++) {
-        for (int i = 0; i < count; i++, l++) {
+    long l=0;
+    count = count / num_slots;
+    int nProcs = (int)(count / elements);
+    for (int iteration=0; iteration < num_slots; iteration++) {
+        for (long i = 0; i < count; i++, l++) {
             sendbuf[l] = mynode + 1 + iteration * nProcs;
         }
     }
 }
 
-static void init_recvbuf (int *recvbuf, int count )
+static void init_recvbuf (int *recvbuf, long count )
 {
-    for (int i = 0; i < count; i++) {
+    for (long i = 0; i < count; i++) {
         recvbuf[i] = 0;
     }
 }
 
-static bool check_recvbuf (int *recvbuf, int nProcs, int rank, int count)
+// sched holds the peers of the iteration that used the slot. Slices of
+// processes not received from in that iteration have to be untouched,
+// as well as the elements past the size of the message of the iteration.
+static bool check_recvbuf_slot (int *recvbuf, int nProcs, long count, int slot, long iteration,
+                                const hip_mpitest_schedule &sched)
 {
     bool res=true;
-    int  l=0;
-    for (int iteration=0; iteration < NUM_NB_ITERATIONS; iteration++) {
-        for (int recvrank=0; recvrank < nProcs; recvrank++) {
-            if (recvrank == rank) {
-                l += count;
-                continue; //No send-to-self for right now
-            }
-            for (int i=0; i < count; i++, l++) {
-                if (recvbuf[l] != recvrank + 1 + iteration * nProcs) {
-                    res = false;
-    #ifdef VERBOSE
-                    printf("recvbuf[%d] = %d expected %d\n", i, recvbuf[l], recvrank+1);
-    #endif
-                    break;
-                }
+    long l=0;
+    for (int recvrank=0; recvrank < nProcs; recvrank++) {
+        int expected = sched.RecvsFrom(recvrank) ? recvrank + 1 + slot * nProcs : 0;
+        long n = hip_mpitest_msgsize_get (count, iteration, recvrank, test_rank);
+        for (long i=0; i < count; i++, l++) {
+            if (recvbuf[l] != (i < n ? expected : 0)) {
+                res = false;
+#ifdef VERBOSE
+                printf("recvbuf[%ld] = %d expected %d\n", i, recvbuf[l], i < n ? expected : 0);
+#endif
+                break;
             }
         }
     }
     return res;
 }
 
-int type_p2p_nb_stress_test (int *sendbuf, int *recvbuf, int count, MPI_Comm comm);
+static bool check_recvbuf (int *recvbuf, int nProcs, long count, hip_mpitest_schedule &sched)
+{
+    bool res=true;
+    for (int iteration=0; iteration < num_slots; iteration++) {
+        sched.Generate(iteration);
+        res &= check_recvbuf_slot (&recvbuf[(long)iteration*nProcs*count], nProcs, count, iteration,
+                                   iteration, sched);
+    }
+    return res;
+}
+
+// Executed on the helper thread of the streaming mode
+static bool check_slot (void *buf, int slot, long iteration)
+{
+    check_sched->Generate(iteration);
+    return check_recvbuf_slot ((int *)buf, test_nprocs, elements, slot, iteration, *check_sched);
+}
+
+int type_p2p_nb_stress_test (int *sendbuf, int *recvbuf, long count, hip_mpitest_schedule &sched,
+                             MPI_Comm comm, long *nmsgs, long *nbytes);
+int type_p2p_nb_window_test (int *sendbuf, int *recvbuf, long count, hip_mpitest_schedule &sched,
+                             MPI_Comm comm, long *nmsgs, long *nbytes);
+int type_p2p_nb_stream_test (int *sbuf, hip_mpitest_buffer *rbuf, int *tmp_rbuf, long count,
+                             hip_mpitest_schedule &sched, MPI_Comm comm, long niterations,
+                             bool *res, long *nmsgs, long *nbytes);
 
 int main (int argc, char *argv[])
 {
     int rank, nProcs;
     int root = 0;
     int ret;
+    hip_mpitest_schedule sched, helper_sched;
 
     bind_device();
 
@@ -90,35 +144,85 @@ int main (int argc, char *argv[])
     MPI_Comm_size (MPI_COMM_WORLD, &nProcs);
     MPI_Comm_rank (MPI_COMM_WORLD, &rank);
 
+    hip_mpitest_max_elements = LONG_MAX;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
+    long niterations;
+    bool res, fret;
+    long nmsgs=0, nbytes=0;
+    std::chrono::high_resolution_clock::time_point ts, te;
+    niterations = hip_mpitest_iterations > 0 ? hip_mpitest_iterations : NUM_NB_ITERATIONS;
+    num_slots   = hip_mpitest_pipeline_depth > 0 ? hip_mpitest_pipeline_depth : niterations;
+    test_nprocs = nProcs;
+    test_rank   = rank;
+
     int *tmp_sendbuf=NULL, *tmp_recvbuf=NULL;
+#ifdef HIP_MPITEST_SENDTOSELF
+    ret = sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL, true);
+    if (MPI_SUCCESS == ret) {
+        ret = helper_sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL, true);
+    }
+#else
+    ret = sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL);
+    if (MPI_SUCCESS == ret) {
+        ret = helper_sched.Init(MPI_COMM_WORLD, HIP_MPITEST_PATTERN_ALL);
+    }
+#endif
+    if (MPI_SUCCESS != ret) {
+        goto out;
+    }
+    check_sched = &helper_sched;
+
     // Initialise send buffer
-    ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, int, nProcs*elements*NUM_NB_ITERATIONS, sizeof(int),
+    ALLOCATE_SENDBUFFER(sendbuf, tmp_sendbuf, int, nProcs*elements*num_slots, sizeof(int),
                         rank, MPI_COMM_WORLD, init_sendbuf, out);
 
     // Initialize recv buffer
-    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, int, nProcs*elements*NUM_NB_ITERATIONS, sizeof(int),
+    ALLOCATE_RECVBUFFER(recvbuf, tmp_recvbuf, int, nProcs*elements*num_slots, sizeof(int),
                         rank, MPI_COMM_WORLD, init_recvbuf, out);
 
-    //execute point-to-point operations
-    ret = type_p2p_nb_stress_test ((int *)sendbuf->get_buffer(), (int *)recvbuf->get_buffer(),
-                                   elements, MPI_COMM_WORLD);
-    if (MPI_SUCCESS != ret) {
-        printf("Error in type_p2p_nb_stress_test. Aborting\n");
-        goto out;
-    }
-
-    // verify results
-    bool res, fret;
-    if (recvbuf->NeedsStagingBuffer()) {
-        HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, nProcs*elements*NUM_NB_ITERATIONS*sizeof(int)));
-        res = check_recvbuf(tmp_recvbuf, nProcs, rank, elements);
+    if (hip_mpitest_pipeline_depth > 0) {
+        // streaming mode: buffers are verified while later iterations are in flight
+        ts = std::chrono::high_resolution_clock::now();
+        ret = type_p2p_nb_stream_test ((int *)sendbuf->get_buffer(), recvbuf, tmp_recvbuf, elements,
+                                       sched, MPI_COMM_WORLD, niterations, &res, &nmsgs, &nbytes);
+        te = std::chrono::high_resolution_clock::now();
+        if (MPI_SUCCESS != ret) {
+            printf("Error in type_p2p_nb_stream_test. Aborting\n");
+            goto out;
+        }
     }
     else {
-        res = check_recvbuf((int*) recvbuf->get_buffer(), nProcs, rank, elements);
+        //execute point-to-point operations
+        ts = std::chrono::high_resolution_clock::now();
+        if (hip_mpitest_window_depth > 0) {
+            ret = type_p2p_nb_window_test ((int *)sendbuf->get_buffer(), (int *)recvbuf->get_buffer(),
+                                           elements, sched, MPI_COMM_WORLD, &nmsgs, &nbytes);
+        }
+        else {
+            ret = type_p2p_nb_stress_test ((int *)sendbuf->get_buffer(), (int *)recvbuf->get_buffer(),
+                                           elements, sched, MPI_COMM_WORLD, &nmsgs, &nbytes);
+        }
+        te = std::chrono::high_resolution_clock::now();
+        if (MPI_SUCCESS != ret) {
+            printf("Error in type_p2p_nb_stress_test. Aborting\n");
+            goto out;
+        }
+
+        // verify results
+        if (recvbuf->NeedsStagingBuffer()) {
+            HIP_CHECK(recvbuf->CopyFrom(tmp_recvbuf, nProcs*elements*num_slots*sizeof(int)));
+            res = check_recvbuf(tmp_recvbuf, nProcs, elements, sched);
+        }
+        else {
+            res = check_recvbuf((int*) recvbuf->get_buffer(), nProcs, elements, sched);
+        }
     }
     fret = report_testresult(argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), res);
+    if (HIP_MPITEST_MSGSIZE_FIXED != hip_mpitest_msgsize_dist) {
+        report_throughput (MPI_COMM_WORLD, nmsgs, nbytes,
+                           std::chrono::duration<double>(te-ts).count());
+    }
     report_performance (argv[0], MPI_COMM_WORLD, sendbuf->get_memchar(), recvbuf->get_memchar(), elements,
                         (size_t)(elements *sizeof(int)), 0, 0.0);
 
@@ -140,7 +244,8 @@ int main (int argc, char *argv[])
 }
 
 
-int type_p2p_nb_stress_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
+int type_p2p_nb_stress_test (int *sbuf, int *rbuf, long count, hip_mpitest_schedule &sched,
+                             MPI_Comm comm, long *nmsgs, long *nbytes)
 {
     int size, rank, ret;
     int tag=251;
@@ -151,34 +256,38 @@ int type_p2p_nb_stress_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
     MPI_Comm_size (comm, &size);
     MPI_Comm_rank (comm, &rank);
 
-    reqs = (MPI_Request*)malloc (2*size*NUM_NB_ITERATIONS*sizeof(MPI_Request));
+    reqs = (MPI_Request*)malloc (2*size*num_slots*sizeof(MPI_Request));
     if (NULL == reqs) {
         printf("4. Could not allocate memory. Aborting\n");
         return MPI_ERR_OTHER;
     }
-    for (int j=0; j<NUM_NB_ITERATIONS; j++) {
+    for (int j=0; j<num_slots; j++) {
+        sched.Generate(j);
         for (int i=0; i<size; i++) {
-#ifndef HIP_MPITEST_SENDTOSELF
-            if (i == rank) {
-                // No send-to-self for the moment
-                reqs[2*i+2*size*j]   = MPI_REQUEST_NULL;
-                reqs[2*i+2*size*j+1] = MPI_REQUEST_NULL;
-                continue;
-            }
-#endif
-            recvbuf = &rbuf[i*count+j*count*size];
-            ret = MPI_Irecv (recvbuf, count, MPI_INT, i, tag, comm, &reqs[2*i+2*size*j]);
-            if (MPI_SUCCESS != ret) {
-                goto out;
+            // Peers not in the schedule of this iteration keep a null request
+            reqs[2*i+2*size*j]   = MPI_REQUEST_NULL;
+            reqs[2*i+2*size*j+1] = MPI_REQUEST_NULL;
+            if (sched.RecvsFrom(i)) {
+                long n = hip_mpitest_msgsize_get (count, j, i, rank);
+                recvbuf = &rbuf[i*count+j*count*size];
+                ret = hip_mpitest_irecv (recvbuf, n, MPI_INT, i, tag, comm, &reqs[2*i+2*size*j]);
+                if (MPI_SUCCESS != ret) {
+                    goto out;
+                }
             }
-            sendbuf = &sbuf[i*count+j*count*size];
-            ret = MPI_Isend (sendbuf, count, MPI_INT, i, tag, comm, &reqs[2*i+2*size*j+1]);
-            if (MPI_SUCCESS != ret) {
-                goto out;
+            if (sched.SendsTo(i)) {
+                long n = hip_mpitest_msgsize_get (count, j, rank, i);
+                sendbuf = &sbuf[i*count+j*count*size];
+                ret = hip_mpitest_isend (sendbuf, n, MPI_INT, i, tag, comm, &reqs[2*i+2*size*j+1]);
+                if (MPI_SUCCESS != ret) {
+                    goto out;
+                }
+                (*nmsgs)++;
+                (*nbytes) += n * sizeof(int);
             }
         }
     }
-    ret = MPI_Waitall (2*size*NUM_NB_ITERATIONS, reqs, MPI_STATUSES_IGNORE);
+    ret = MPI_Waitall (2*size*num_slots, reqs, MPI_STATUSES_IGNORE);
     if (MPI_SUCCESS != ret) {
         goto out;
     }
@@ -187,3 +296,139 @@ int type_p2p_nb_stress_test (int *sbuf, int *rbuf, int count, MPI_Comm comm)
     return ret;
 }
 
+
+// Same exchanges as type_p2p_nb_stress_test with at most
+// hip_mpitest_window_depth requests outstanding instead of
+// 2*size*num_slots. The iterations are posted in order, the requests of
+// the next iteration fill the window while the previous one completes.
+int type_p2p_nb_window_test (int *sbuf, int *rbuf, long count, hip_mpitest_schedule &sched,
+                             MPI_Comm comm, long *nmsgs, long *nbytes)
+{
+    int size, rank, ret;
+    int tag=251;
+    long cur=-1;
+    hip_mpitest_window window;
+
+    MPI_Comm_size (comm, &size);
+    MPI_Comm_rank (comm, &rank);
+
+    ret = window.Init (hip_mpitest_window_depth);
+    if (MPI_SUCCESS != ret) {
+        return ret;
+    }
+    return window.Run (2*(long)size*num_slots, [&](long op, MPI_Request *req) {
+        long j = op / (2*size);
+        bool is_send;
+        int peer = hip_mpitest_window_peer (rank, size, op, &is_send);
+
+        if (j != cur) {
+            sched.Generate(j);
+            cur = j;
+        }
+        if (is_send) {
+            if (!sched.SendsTo(peer)) {
+                return MPI_SUCCESS;
+            }
+            long n = hip_mpitest_msgsize_get (count, j, rank, peer);
+            (*nmsgs)++;
+            (*nbytes) += n * sizeof(int);
+            return hip_mpitest_isend (&sbuf[peer*count+j*count*size], n, MPI_INT, peer, tag, comm,
+                                      req);
+        }
+        if (!sched.RecvsFrom(peer)) {
+            return MPI_SUCCESS;
+        }
+        long n = hip_mpitest_msgsize_get (count, j, peer, rank);
+        return hip_mpitest_irecv (&rbuf[peer*count+j*count*size], n, MPI_INT, peer, tag, comm, req);
+    });
+}
+
+
+// Streaming version of the test: iteration it uses slot it % depth of a
+// ring of buffers. Once an iteration has completed, its receive slot is
+// handed to a helper thread for verification, and the slot is reset and
+// reused by iteration it + depth. Up to depth-2 iterations are in flight
+// while one is being checked.
+int type_p2p_nb_stream_test (int *sbuf, hip_mpitest_buffer *rbuf, int *tmp_rbuf, long count,
+                             hip_mpitest_schedule &sched, MPI_Comm comm, long niterations,
+                             bool *res, long *nmsgs, long *nbytes)
+{
+    int size, rank, ret=MPI_SUCCESS;
+    int tag=251;
+    int nslots = hip_mpitest_pipeline_depth;
+    MPI_Request *reqs;
+    int *sendbuf;
+    int *recvbuf;
+    hip_mpitest_pipeline *pipe=NULL;
+
+    MPI_Comm_size (comm, &size);
+    MPI_Comm_rank (comm, &rank);
+
+    size_t slotlen = (size_t)count * size;
+    reqs    = (MPI_Request*)malloc (2*size*nslots*sizeof(MPI_Request));
+    if (NULL == reqs) {
+        printf("4. Could not allocate memory. Aborting\n");
+        ret = MPI_ERR_OTHER;
+        goto out;
+    }
+    pipe = new hip_mpitest_pipeline(nslots, check_slot);
+
+    for (long it=0; it < niterations + nslots - 2; it++) {
+        if (it < niterations) {
+            int s = it % nslots;
+            if (it >= nslots) {
+                // wait until iteration it - nslots has been verified
+                pipe->wait(s);
+                HIP_CHECK(rbuf->Fill(hip_mpitest_fill_zero, NULL, slotlen*sizeof(int), s*slotlen*sizeof(int)));
+            }
+            sched.Generate(it);
+            for (int i=0; i<size; i++) {
+                // Peers not in the schedule of this iteration keep a null request
+                reqs[2*i+2*size*s]   = MPI_REQUEST_NULL;
+                reqs[2*i+2*size*s+1] = MPI_REQUEST_NULL;
+                if (sched.RecvsFrom(i)) {
+                    long n = hip_mpitest_msgsize_get (count, it, i, rank);
+                    recvbuf = &((int *)rbuf->get_buffer())[i*count+s*slotlen];
+                    ret = hip_mpitest_irecv (recvbuf, n, MPI_INT, i, tag, comm,
+                                             &reqs[2*i+2*size*s]);
+                    if (MPI_SUCCESS != ret) {
+                        goto out;
+                    }
+                }
+                if (sched.SendsTo(i)) {
+                    long n = hip_mpitest_msgsize_get (count, it, rank, i);
+                    sendbuf = &sbuf[i*count+s*slotlen];
+                    ret = hip_mpitest_isend (sendbuf, n, MPI_INT, i, tag, comm,
+                                             &reqs[2*i+2*size*s+1]);
+                    if (MPI_SUCCESS != ret) {
+                        goto out;
+                    }
+                    (*nmsgs)++;
+                    (*nbytes) += n * sizeof(int);
+                }
+            }
+        }
+
+        // complete the oldest iteration in flight and hand it to the helper thread
+        long c = it - (nslots - 2);
+        if (c >= 0 && c < niterations) {
+            int s = c % nslots;
+            void *vbuf = &((int *)rbuf->get_buffer())[s*slotlen];
+            ret = MPI_Waitall (2*size, &reqs[2*size*s], MPI_STATUSES_IGNORE);
+            if (MPI_SUCCESS != ret) {
+                goto out;
+            }
+            if (rbuf->NeedsStagingBuffer()) {
+                HIP_CHECK(rbuf->CopyFrom(&tmp_rbuf[s*slotlen], slotlen*sizeof(int), s*slotlen*sizeof(int)));
+                vbuf = &tmp_rbuf[s*slotlen];
+            }
+            pipe->submit(s, vbuf, c);
+        }
+    }
+    *res = pipe->wait_all();
+
+ out:
+    delete (pipe);
+    free (reqs);
+    return ret;
+}
@@ -31,7 +31,7 @@
 #include "hip_mpitest_buffer.h"
 
 #define NITER 25
-int elements = 100;
+long elements = 100;
 hip_mpitest_buffer *sendbuf = NULL;
 hip_mpitest_buffer *recvbuf = NULL;
 
@@ -95,6 +95,9 @@ int main(int argc, char *argv[])
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
+    // the send buffer holds size*elements elements, which are
+    // initialized with an int count
+    hip_mpitest_max_elements = INT_MAX / size;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
     double *tmp_sendbuf = NULL, *tmp_recvbuf = NULL;
@@ -31,7 +31,7 @@
 #include "hip_mpitest_buffer.h"
 
 #define NITER 25
-int elements = 100;
+long elements = 100;
 hip_mpitest_buffer *sendbuf = NULL;
 hip_mpitest_buffer *recvbuf = NULL;
 
@@ -94,6 +94,9 @@ int main(int argc, char *argv[])
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
+    // the send buffer of size*elements elements is initialized and
+    // scattered with int counts and displacements
+    hip_mpitest_max_elements = INT_MAX / size;
     parse_args(argc, argv, MPI_COMM_WORLD);
 
     double *tmp_sendbuf = NULL, *tmp_recvbuf = NULL;
@@ -0,0 +1,69 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/******************************************************************************
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef __HIP_TYPE_NESTED__
+#define __HIP_TYPE_NESTED__
+
+#include "mpi.h"
+#include "hip_mpitest_datatype.h"
+
+#undef  TEST_DATATYPE
+#define TEST_DATATYPE hip_type_nested
+
+#ifndef A_WIDTH
+#define A_WIDTH 512
+#endif
+#define GAPSIZE 32
+
+// Resized struct of a strided vector (3 out of every 4 ints) and a
+// contiguous block, with gaps in between and at the end of each
+// element. Buffers are initialized and checked through the generic
+// typemap based functions of hip_mpitest_datatype.
+class hip_type_nested: public hip_mpitest_datatype {
+ public:
+    hip_type_nested() {
+        MPI_Datatype vec, str;
+        MPI_Aint displs[2] = {0, (MPI_Aint)(4*A_WIDTH + GAPSIZE) * (MPI_Aint)sizeof(int)};
+        MPI_Aint extent = (MPI_Aint)(5*A_WIDTH + 2*GAPSIZE) * (MPI_Aint)sizeof(int);
+        int blength[2] = {1, A_WIDTH};
+        MPI_Datatype dats[2];
+
+        MPI_Type_vector(A_WIDTH, 3, 4, MPI_INT, &vec);
+        dats[0] = vec;
+        dats[1] = MPI_INT;
+        MPI_Type_create_struct(2, blength, displs, dats, &str);
+        MPI_Type_create_resized(str, 0, extent, &datatype);
+        MPI_Type_commit(&datatype);
+        MPI_Type_free (&str);
+        MPI_Type_free (&vec);
+    }
+    ~hip_type_nested() {
+        MPI_Type_free (&datatype);
+    }
+
+    int get_num_elements() {
+        return 4*A_WIDTH;
+    }
+};
+
+#endif
@@ -94,12 +94,10 @@ class hip_type_resized: public hip_mpitest_datatype {
         }
     }
 
-    bool check_recvbuf (void *rbuf, int numprocs, int rank, int count)
+    bool check_recvbuf (void *rbuf, int recvfrom, int count)
     {
         bool res = true;
         _s2 *recvbuf = (_s2 *) rbuf;
-        int recvfrom = rank - 1;
-        if (recvfrom < 0 ) recvfrom = numprocs -1;
 
         for (int i=0; i<count; i++) {
             for (int l=0; l<A_WIDTH; l++) {